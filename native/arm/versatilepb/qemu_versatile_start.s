@@ -1,32 +1,67 @@
 
 .globl _start
 _start:
-    b reset
-    b hang
-    b hang
-    b hang
-
-    b hang
-    b hang
-    b hang
-    b hang
-
-    b hang
-    b hang
-    b hang
-    b hang
-
-    b hang
-    b hang
-    b hang
-    b hang
+    ldr pc,reset_vector
+    ldr pc,undefined_vector
+    ldr pc,swi_vector
+    ldr pc,prefetch_vector
+    ldr pc,data_vector
+    ldr pc,unused_vector
+    ldr pc,irq_vector
+    ldr pc,fiq_vector
+reset_vector:		.word reset
+undefined_vector:	.word hang
+swi_vector:		.word hang
+prefetch_vector:	.word hang
+data_vector:		.word hang
+unused_vector:		.word hang
+irq_vector:		.word irq
+fiq_vector:		.word hang
 
 reset:
+    ldr r0,=_start		@ the table above goes at 0, where the core looks
+    mov r1,#0x0000
+    ldmia r0!,{r2,r3,r4,r5,r6,r7,r8,r9}
+    stmia r1!,{r2,r3,r4,r5,r6,r7,r8,r9}
+    ldmia r0!,{r2,r3,r4,r5,r6,r7,r8,r9}
+    stmia r1!,{r2,r3,r4,r5,r6,r7,r8,r9}
+
+    mov r0,#0xD2		@ irq mode, interrupts off
+    msr cpsr_c,r0
+    mov sp,#0x1000		@ below the svc stack, above the vectors
+    mov r0,#0xD3		@ and back to svc
+    msr cpsr_c,r0
     mov sp,#0x10000
     bl notmain
 hang:
     b hang
 
+irq:
+    sub lr,lr,#4
+    stmfd sp!,{r0-r3,r12,lr}
+    bl irq_dispatch
+    ldmfd sp!,{r0-r3,r12,pc}^
+
+.globl enable_irq
+enable_irq:
+    mrs r0,cpsr
+    bic r0,r0,#0x80
+    msr cpsr_c,r0
+    bx lr
+
+.globl disable_irq
+disable_irq:
+    mrs r0,cpsr
+    orr r0,r0,#0x80
+    msr cpsr_c,r0
+    bx lr
+
+.globl WFI
+WFI:
+    mov r0,#0
+    mcr p15,0,r0,c7,c0,4
+    bx lr
+
 .globl GETPC
 GETPC:
     mov r0,pc
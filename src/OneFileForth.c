@@ -33,6 +33,30 @@
 
 */
 
+#ifdef OFF_API
+/*
+  -- the embedding interface alone, for a host linking the off.o that
+  'make embed' builds (see off_create()):
+
+	#define OFF_API
+	#include "OneFileForth.c"
+*/
+#include <stdint.h>
+
+typedef struct _vm_	VM_t ;		// opaque to the host
+typedef intptr_t	off_Cell_t ;
+typedef int		off_Err_t ;	// 0 is ok, else one of the err_ codes
+
+VM_t      *off_create( VM_t *shared ) ;
+off_Err_t  off_eval( VM_t *v, char *src, off_Cell_t len ) ;
+off_Err_t  off_load( VM_t *v, char *fn ) ;
+void       off_push( VM_t *v, off_Cell_t x ) ;
+off_Cell_t off_pop( VM_t *v ) ;
+void       off_destroy( VM_t *v ) ;
+int        off_main( int argc, char **argv ) ;
+
+#else // OFF_API, the rest is the interpreter
+
 #define MAJOR		"00"
 #define MINOR		"01"
 #define REVISION	"67"
@@ -107,9 +131,23 @@
 #undef HOSTED
 #define sz_FLASH	8192		// cells
 #define FLASH_INIT_VAL	0xdead
+#define sz_HASH		64		// dictionary buckets
+#define sz_TIMERS	16		// pending at once
+#define TIMERS			/* on the SP804 tick, see tick_isr() */
+#define sz_BUFFERS	2		// block buffers
+#define sz_BLOCKS	4		// blocks kept after flash, see blk_io()
+#endif
+
+// -D TOKENS packs colon words into 16 bit tokens, see tok_pack(), a
+// 16 bit cell is that already, and the classic engine has no opcodes
+// to pack by ...
+#if defined( TOKENS ) && (_WORDSIZE == 2 || defined( CLASSIC ))
+#undef TOKENS
 #endif
 
 #define sz_INBUF		127		// bytes
+#define sz_NARGS		16		// most args to a C function
+#define sz_OUTBUF		4096		// bytes per output file
 #define sz_STACK		32		// cells
 #define sz_ColonDefs 		1024		// # entries
 #define sz_TMPBUFFER		2048		// total buffer queue
@@ -120,6 +158,15 @@
 #define FLASH_INIT_VAL	0xdeadbeef
 #endif
 
+#define blk_Size	1024		// bytes in a block
+#ifndef sz_BUFFERS
+#define sz_BUFFERS	8		// block buffers, see blk_get()
+#endif
+
+#ifndef sz_HASH
+#define sz_HASH		256		// dictionary buckets (power of 2)
+#endif
+
 #ifdef HOSTED
 #include <stdlib.h>
 #include <fcntl.h>
@@ -130,10 +177,48 @@
 #include <signal.h>
 #include <sys/stat.h>
 #include <dlfcn.h>
+#if !defined( __WIN32__ )
+#include <sys/mman.h>
+#define IN_MMAP			/* map infile sources */
+#define ARENA			/* runtime sized memory, see arena_init() */
+#include <pthread.h>
+#define PARDO			/* loops split over worker VMs, see par_do() */
+#if defined( __x86_64__ ) && !defined( CLASSIC ) && !defined( JIT )
+#define JIT			/* native code for colon defs, see jit_compile() */
+#endif
+#define SAMPLER			/* a SIGPROF profiler, see sm_sample() */
+#if !defined( __APPLE__ )
+#include <ucontext.h>
+#include <poll.h>
+#define TASKS			/* round robin tasks, see Pause() */
+#define TIMERS			/* a timer queue, see tm_poll() */
+#endif
+#if defined( __linux__ ) || defined( __FreeBSD__ ) || defined( __APPLE__ )
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#if defined( __linux__ )
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL		0
+#endif
+#define EVENTS			/* epoll/kqueue and sockets, see run_events() */
+#endif
+#endif
 
 volatile sig_atomic_t sigval = 0 ;
 
 #define OFF_PATH	"OFF_PATH"
+#define OFF_FLASH	"OFF_FLASH"
+#define OFF_DEFS	"OFF_DEFS"
+#define OFF_STACK	"OFF_STACK"
+#define OFF_TMP		"OFF_TMP"
 
 #if !defined( __WIN32__ )
 struct termios tty_normal_state ;
@@ -142,10 +227,10 @@ struct termios tty_normal_state ;
 #define sz_FILES		4			/* nfiles */
 #define INPUT			InputStack[ in_This ].file
 #define OUTPUT			out_files[ out_This ]
-jmp_buf env ;
 #endif
 
 #ifdef NATIVE
+typedef int		sig_atomic_t ;
 #define FLAVOUR 		"Native"
 #define sz_FILES		1			/* nfiles */
 #define INPUT			0
@@ -155,9 +240,6 @@ jmp_buf env ;
 #endif
 #endif
 
-int  					in_This = -1, in_files[ sz_FILES ] = { 0 } ;
-int  					out_This = 0, out_files[ sz_FILES ] = { 1 } ;
-
 #if _WORDSIZE == 2
 typedef int16_t		Wrd_t ;
 typedef uint16_t	uWrd_t ;
@@ -200,31 +282,50 @@ typedef void *		Opq_t ;
 typedef Wrd_t		Cell_t ;
 typedef uWrd_t		uCell_t ;
 
-#define StartOf(x)	(&x[0])
-
-//  -- a data stack ...
-Cell_t stack[sz_STACK+1] = { 0 } ;
-Cell_t *tos = (Cell_t *) StartOf( stack ) ;
+// strings and memory go a cell at a time where gcc can be told the
+// loads may alias anything (and be unaligned, for the source side) ...
+#if defined( __GNUC__ )
+#define WIDE
+typedef uCell_t __attribute__(( __may_alias__ )) aCell_t ;
+typedef uCell_t __attribute__(( __may_alias__, __aligned__( 1 ) )) uaCell_t ;
+#define CELL_MASK	((uCell_t) sizeof( uCell_t ) - 1)
+#define CELL_ONES	((uCell_t) -1 / 0xff)		// 0x0101 ...
+#define CELL_HIGHS	(CELL_ONES << 7)		// 0x8080 ...
+#define has_zero( x )	(((x) - CELL_ONES) & ~(x) & CELL_HIGHS)
+#endif
 
-//  -- and a return stack ...
-Cell_t rstack[sz_STACK+1] = { 0 } ;
-Cell_t *rtos = (Cell_t *) StartOf( rstack ) ;
+#define StartOf(x)	(&x[0])
 
-//  -- and a user stack ...
-Cell_t ustack[sz_STACK+1] = { 0 } ;
-Cell_t *utos = (Cell_t *) StartOf( ustack ) ;
+#ifdef ARENA
+// the sizes above are only defaults, chk_args() may change them
+// before arena_init() maps the memory ...
+Cell_t arena_Flash = sz_FLASH ;
+Cell_t arena_Stack = sz_STACK ;
+Cell_t arena_Defs = sz_ColonDefs ;
+Cell_t arena_TmpBuf = sz_TMPBUFFER ;
+#undef sz_FLASH
+#undef sz_STACK
+#undef sz_ColonDefs
+#undef sz_TMPBUFFER
+#define sz_FLASH		arena_Flash
+#define sz_STACK		arena_Stack
+#define sz_ColonDefs		arena_Defs
+#define sz_TMPBUFFER		arena_TmpBuf
+#define ar_MinFlash		256	// the least arena_init() will take
+#define ar_MinDefs		16
+#define ar_MinStack		8
+#define ar_MinTmp		256
+#define ar_Most			((Cell_t) ((uCell_t) -1 >> 4))	// bytes, well short of overflow
+#endif
 
-//  -- some input and scratch buffers ...
-Byt_t  input_buffer[ sz_FILES * sz_INBUF ] = { 0 } ;
-Byt_t *inbuf[] = {
-	(Byt_t *) (input_buffer + (0 * sz_INBUF)),
+//  -- output for each entry in out_files is buffered ...
 #ifdef HOSTED
-	(Byt_t *) (input_buffer + (1 * sz_INBUF)),
-	(Byt_t *) (input_buffer + (2 * sz_INBUF)),
-	(Byt_t *) (input_buffer + (3 * sz_INBUF)),
+typedef enum {
+  buf_None,
+  buf_Line,
+  buf_Full
+} Buf_t ;
 #endif // HOSTED
-	NULL
-} ;
 
 // temp buffer circular queue ... 
 // see implementation below for details.
@@ -247,16 +348,6 @@ int              tb_bufsize( Cir_Queue_t *CQ ) ;
 int            	 tb_nbufs( Cir_Queue_t *CQ ) ;
 void            *tb_get( Cir_Queue_t *CQ ) ;
 
-Cir_Queue_t T ;
-Cir_Queue_t *TB = (Cir_Queue_t *) NULL ;
-Byt_t  tmp_buffer[sz_TMPBUFFER] = { 0 } ;
-
-uCell_t _ops = 0 ; 
-
-#ifdef HOSTED
-Str_t	off_path = (Str_t) NULL ;
-#endif
-
 //  -- useful macros ...
 #define v_Off		0
 #define v_On		1
@@ -279,16 +370,51 @@ Str_t	off_path = (Str_t) NULL ;
 #define Abs( x )	((x < 0) ? (x*-1) : x) 
 #define UNUSED( x )	x __attribute__((unused))
 
+// a jitted word runs its native code unless it is being traced
+// or profiled, or was compiled by another VM sharing the dictionary,
+// when the threaded code is run instead ... words compile-c wrote
+// are built in, and run the same way.
+#ifdef AOT
+#define aot_Mine( dp )	((dp) >= Colon_Defs && (dp) < &Colon_Defs[ aot_Words ] && !isNul( (dp) ->jit ) && (dp) ->jit == aot_Code[ (dp) - Colon_Defs ])
+#else
+#define aot_Mine( dp )	0
+#endif
+#ifdef JIT
+#define jit_Mine( dp )	(aot_Mine( dp ) || ((uByt_t *) (dp) ->jit >= jit_Base && (uByt_t *) (dp) ->jit < jit_Here))
+#else
+#define jit_Mine( dp )	aot_Mine( dp )
+#endif
+#ifdef PROFILE
+#define jit_Ready( dp )	((dp) ->op == op_Jit && !Trace && !Profile && jit_Mine( dp ))
+#else
+#define jit_Ready( dp )	((dp) ->op == op_Jit && !Trace && jit_Mine( dp ))
+#endif
+
 // nocheck determines argument checking at runtime, and also
 // will determine if temporary buffers are cleared 
 #ifdef NOCHECK
 #define chk( x )	{}
 #define dbg		'F'
 #else
+#ifdef CLASSIC
 #define chk( x )	do { if( !checkstack( x, (Str_t) __func__ ) ) return ; } while(0)
+#else
+#define STK_TRUST	// a word checked on the way in runs unchecked, see stk_enter()
+#define chk( x )	do { if( ((x) < 1 || !chk_Ok) && !checkstack( x, (Str_t) __func__ ) ) return ; } while(0)
+#endif
 #define dbg		'D'
 #endif
 
+// profile builds in the per word profiler (see profile-on), without
+// it the hooks disappear just as chk() does under NOCHECK
+#ifdef PROFILE
+#define prof_Enter( x )	prof_enter( x )
+#define prof_Leave()	prof_leave()
+#else
+#define prof_Enter( x )	{}
+#define prof_Leave()	{}
+#endif
+
 
 /*
   -- forth primitives must be pre-declared ...
@@ -296,6 +422,7 @@ Str_t	off_path = (Str_t) NULL ;
 Wrd_t checkstack(); 
 
 void quit(); 
+void q_token();
 void banner(); 
 void add(); 
 void subt(); 
@@ -354,12 +481,35 @@ void here();
 void freespace();
 void comma();
 void doLiteral();
+void lit_add();
+void lit_sub();
+void lit_eq();
+void lit_ne();
+void lit_lt();
+void lit_gt();
+void lit_eq_branch();
+void lit_ne_branch();
+void lit_lt_branch();
+void lit_gt_branch();
+void dup_branch();
+void loop_branch();
+void ploop_branch();
+void var_fetch();
+void var_store();
+void fusion();
+void fused();
+void jit();
+void jit_auto();
 void colon();
-void compile();
+void compile( Wrd_t opened );
 void semicolon();
 void call() ;
 void execute() ;
 void doColon() ;
+#ifdef TOKENS
+void doTokens() ;
+#endif
+void doConstant() ;
 void tick() ;
 void nfa() ;
 void cfa() ;
@@ -371,8 +521,14 @@ void errvar() ;
 void errval() ;
 void errstr() ;
 void errmax() ;
+void errlast() ;
 void base() ;
 void trace() ;
+void ring_on() ;
+void ring_off() ;
+void dotring() ;
+void ring_snap() ;
+void ring_save() ;
 void resetter() ;
 void cold() ;
 void see() ;
@@ -394,6 +550,8 @@ void bkw_mark();
 void bkw_resolve();
 void q_branch();
 void branch();
+void tail();
+void recurse();
 void begin();
 void again();
 void While();
@@ -426,9 +584,21 @@ void count();
 void ssave();
 void unssave();
 void infile();
+void include();
 void filename();
 void outfile();
 void closeout();
+void flush();
+void unbuffered();
+void buffered();
+void block();
+void buffer();
+void update();
+void save_buffers();
+void empty_buffers();
+void load();
+void open_blocks();
+void read_ahead();
 #ifdef HOSTED
 void isfile();
 void sndtty();
@@ -436,21 +606,69 @@ void rcvtty();
 void opentty();
 void closetty();
 void waitrdy();
+#ifdef EVENTS
+void ev_read();
+void ev_write();
+void ev_del();
+void run_events();
+void tcp_listen();
+void tcp_connect();
+void udp_open();
+void unix_listen();
+void unix_connect();
+void sock_accept();
+void sock_recv();
+void sock_send();
+void udp_sendto();
+void sock_close();
+void srv_run( void );
+void srv_take( void );
+#endif
 void qdlopen();
+void native_resolve( Cell_t lib, Str_t name );
 void qdlclose();
 void qdlsym();
 void qdlerror();
+void save_image();
+void compile_c();
 void spinner();
 void path();
 #endif /* HOSTED */
 void last_will();
 void callout();
+void doNative();
+void qbind();
+void bind_map();
+#ifdef HOSTED
+void import();
+#endif
+Cell_t ffi_call( Cptr_t fun, Cell_t *a, Cell_t n );
 void clkspersec();
 void plusplus();
 void minusminus();
 void utime();
+#ifdef NATIVE
+void cycles();
+#endif
+void task();
+void activate();
+void Pause();
+void stop();
 void ops();
 void noops();
+#ifdef PROFILE
+void profile_on();
+void profile_off();
+void profile_reset();
+void dotprofile();
+#endif
+#ifdef SAMPLER
+void sample_on();
+void sample_off();
+void samples();
+void dotsamples();
+void dotfolded();
+#endif
 void qdo();
 void do_do();
 void do_I();
@@ -458,6 +676,14 @@ void loop();
 void do_loop();
 void ploop();
 void do_ploop();
+#ifdef PARDO
+void pardo();
+void par_do();
+void parloop();
+void parreduce();
+void par_workers();
+void par_free( void );
+#endif
 void forget();
 void fmt_start();
 void fmt_digit();
@@ -466,7 +692,7 @@ void fmt_hold();
 void fmt_sign();
 void fmt_end();
 void utf8_encode();
-void accept();
+void qaccept();
 void dump();
 void find();
 void version();
@@ -474,9 +700,54 @@ void code();
 void data();
 void align();
 void fill();
+void move();
+void compare();
+void search();
+void scan();
+void skip();
+void cell_fill();
+void cell_move();
+void read_cells();
+void write_cells();
+void array();
+void array_len();
+void array_fetch();
+void array_store();
+void array_add();
+void array_sub();
+void array_mul();
+void array_and();
+void array_or();
+void array_shift();
+void array_scale();
+void array_sum();
+void array_min();
+void array_max();
+void array_dot();
+void array_scan();
+void array_convert();
+void arena_new();
+void arena_alloc();
+void arena_reset();
+void arena_space();
+void dotarena();
+void pool_new();
+void pool_get();
+void pool_put();
+void pool_space();
+void dotpool();
 void it_set();
 void it_reset();
 void it_doit( int sig );
+#ifdef TIMERS
+void after();
+void every();
+void cancel();
+void dottimers();
+void tm_poll( void );
+Wrd_t tm_wait( Wrd_t fd, Cell_t usecs );
+void tm_reset( void );
+#endif
 
 /*
   -- dictionary is simply an array of struct ...
@@ -495,24 +766,78 @@ typedef struct _inbuf_ {
   Wrd_t in_line ;
   Str_t name ;
   Str_t bytes ;
+  Str_t map ;		// the whole file when mapped, see in_map()
+  Cell_t map_size ;
+  Cell_t map_this ;
 } Input_t ;
 
-Input_t InputStack[sz_FILES] = {
-	{ .file = -1, .bytes_read = -1, .bytes_this = -1, .in_line = 0, .name = (Str_t) NULL, .bytes = (Str_t) &inbuf[0] },
-#ifdef HOSTED
-	{ .file = -1, .bytes_read = -1, .bytes_this = -1, .in_line = 0, .name = (Str_t) NULL, .bytes = (Str_t) &inbuf[1] },
-	{ .file = -1, .bytes_read = -1, .bytes_this = -1, .in_line = 0, .name = (Str_t) NULL, .bytes = (Str_t) &inbuf[2] },
-	{ .file = -1, .bytes_read = -1, .bytes_this = -1, .in_line = 0, .name = (Str_t) NULL, .bytes = (Str_t) &inbuf[3] },
-#endif // HOSTED
-} ;
+// opcodes for the inner interpreter (see doColon()), primitives
+// which are not inlined by the interpreter use op_Call ...
+typedef enum {
+  op_Call = 0,
+  op_Literal,
+  op_Branch,
+  op_QBranch,
+  op_Do,
+  op_Loop,
+  op_PLoop,
+  op_I,
+  op_Leave,
+  op_Execute,
+  op_ToR,
+  op_RFrom,
+  op_Add,
+  op_Sub,
+  op_Dup,
+  op_Drop,
+  op_Swap,
+  op_Over,
+  op_Inc,
+  op_Dec,
+  op_Eq,
+  op_Ne,
+  op_Lt,
+  op_Gt,
+  op_Fetch,
+  op_Store,
+  op_LitAdd,
+  op_LitSub,
+  op_LitEq,
+  op_LitNe,
+  op_LitLt,
+  op_LitGt,
+  op_LitEqBr,
+  op_LitNeBr,
+  op_LitLtBr,
+  op_LitGtBr,
+  op_DupBr,
+  op_LoopBr,
+  op_PLoopBr,
+  op_VarFetch,
+  op_VarStore,
+  op_Tail,
+  op_Jit,			// a colon def with native code, see jit()
+  op_Undefined
+} Op_t ;
 
 typedef struct _dict_ {
   Fptr_t  cfa ;
   Str_t   nfa ;
   Flag_t  flg ;
   Cell_t  *pfa ;
+  struct _dict_ *lnk ;		// next entry in the same hash bucket
+  uByt_t  op ;			// inner interpreter opcode (Op_t)
+  uByt_t  eff_in ;		// stack cells taken plus one, 0 if not known
+  uByt_t  eff_out ;		// and left, see stk_effect()
+  Fptr_t  jit ;			// native code when op is op_Jit
 } Dict_t ;
 
+#define eff_Known( dp )	((dp) ->eff_in != 0)
+#define eff_In( dp )	((dp) ->eff_in - 1)
+#define eff_Out( dp )	((dp) ->eff_out)
+
+Dict_t *dump_word( Cell_t c );
+
 Dict_t Primitives[] = {
   { quit, 	"quit", Normal, NULL },
   { banner,	"banner", Normal, NULL },
@@ -572,11 +897,35 @@ Dict_t Primitives[] = {
   { freespace,	"freespace", Normal, NULL },
   { comma,	",", Normal, NULL },
   { doLiteral,	"(literal)", Normal, NULL },
+  { tail,	"(tail)", Normal, NULL },
+  { recurse,	"recurse", Immediate, NULL },
+  { lit_add,	"(lit+)", Normal, NULL },
+  { lit_sub,	"(lit-)", Normal, NULL },
+  { lit_eq,	"(lit==)", Normal, NULL },
+  { lit_ne,	"(lit!=)", Normal, NULL },
+  { lit_lt,	"(lit<)", Normal, NULL },
+  { lit_gt,	"(lit>)", Normal, NULL },
+  { lit_eq_branch,	"(lit==?branch)", Normal, NULL },
+  { lit_ne_branch,	"(lit!=?branch)", Normal, NULL },
+  { lit_lt_branch,	"(lit<?branch)", Normal, NULL },
+  { lit_gt_branch,	"(lit>?branch)", Normal, NULL },
+  { dup_branch,	"(dup?branch)", Normal, NULL },
+  { loop_branch,	"(loop?branch)", Normal, NULL },
+  { ploop_branch,	"(+loop?branch)", Normal, NULL },
+  { var_fetch,	"(var@)", Normal, NULL },
+  { var_store,	"(var!)", Normal, NULL },
+  { fusion,	"fusion", Normal, NULL },
+  { fused,	".fused", Normal, NULL },
+  { jit,	"jit", Normal, NULL }, // ( xt -- f )
+  { jit_auto,	"jit-auto", Normal, NULL }, // ( -- adr ) jit at ;
   { colon,	":", Normal, NULL },
   { semicolon,	";", Normal, NULL },
   { execute,	"execute", Normal, NULL },
   { call,	"call", Normal, NULL },
   { doColon,	"(colon)", Normal, NULL },
+#ifdef TOKENS
+  { doTokens,	"(tokens)", Normal, NULL },
+#endif
   { tick,	"'", Immediate, NULL },
   { nfa,	">name", Normal, NULL },
   { cfa,	">code", Normal, NULL },
@@ -585,15 +934,24 @@ Dict_t Primitives[] = {
   { hex,	"hex", Normal, NULL },
   { base,	"base", Normal, NULL },
   { trace,	"trace", Normal, NULL },
+  { ring_on,	"ring-on", Normal, NULL },
+  { ring_off,	"ring-off", Normal, NULL },
+  { dotring,	".ring", Normal, NULL }, // ( n -- )
+  { ring_snap,	"ring-snap", Normal, NULL }, // ( addr n -- m )
+#ifdef HOSTED
+  { ring_save,	"ring-save", Normal, NULL }, // ( <file> -- )
+#endif
   { sigvar,	"sigval", Normal, NULL },
   { errvar,	"err_var", Normal, NULL },
   { errval,	"err_val", Normal, NULL },
   { errstr,	"err_str", Normal, NULL },
   { errmax,	"err_max", Normal, NULL },
+  { errlast,	"err_last", Normal, NULL }, // ( -- n )
   { resetter,	"warm", Normal, NULL },
   { cold,	"cold", Normal, NULL },
   { see,	"see", Normal, NULL },
   { pushPfa,	"(variable)", Normal, NULL },
+  { doConstant,	"(constant)", Normal, NULL },
   { allot,	"allot", Normal, NULL },
   { create,	"create", Normal, NULL },
   { lambda,	"lambda", Normal, NULL },  // ( <str> -- ) 
@@ -644,9 +1002,21 @@ Dict_t Primitives[] = {
   { ssave,	"save", Normal, NULL },
   { unssave,	"unsave", Normal, NULL },
   { infile,	"infile", Normal, NULL },
+  { include,	"include", Normal, NULL }, // ( str -- )
   { filename,	"filename", Normal, NULL },
   { outfile,	"outfile", Normal, NULL },
   { closeout,	"closeout", Normal, NULL },
+  { flush,	"flush", Normal, NULL },
+  { unbuffered,	"unbuffered", Normal, NULL },
+  { buffered,	"buffered", Normal, NULL },
+  { block,	"block", Normal, NULL }, // ( n -- addr )
+  { buffer,	"buffer", Normal, NULL }, // ( n -- addr )
+  { update,	"update", Normal, NULL },
+  { save_buffers,	"save-buffers", Normal, NULL },
+  { empty_buffers,	"empty-buffers", Normal, NULL },
+  { load,	"load", Normal, NULL }, // ( n -- )
+  { open_blocks,	"open-blocks", Normal, NULL }, // ( str -- )
+  { read_ahead,	"read-ahead", Normal, NULL }, // ( n -- )
 #ifdef HOSTED
   { isfile,	"isfile", Normal, NULL },
   { opentty,	"opentty", Normal, NULL },
@@ -654,10 +1024,30 @@ Dict_t Primitives[] = {
   { sndtty,	"sndtty", Normal, NULL },
   { waitrdy,	"waitrdy", Normal, NULL },
   { rcvtty,	"rcvtty", Normal, NULL },
+#ifdef EVENTS
+  { ev_read,	"ev-read", Normal, NULL }, // ( fd xt -- )
+  { ev_write,	"ev-write", Normal, NULL }, // ( fd xt -- )
+  { ev_del,	"ev-del", Normal, NULL }, // ( fd -- )
+  { run_events,	"run-events", Normal, NULL }, // ( msecs -- n )
+  { tcp_listen,	"tcp-listen", Normal, NULL }, // ( port -- fd )
+  { tcp_connect,	"tcp-connect", Normal, NULL }, // ( host port -- fd )
+  { udp_open,	"udp-open", Normal, NULL }, // ( port -- fd )
+  { unix_listen,	"unix-listen", Normal, NULL }, // ( path -- fd )
+  { unix_connect,	"unix-connect", Normal, NULL }, // ( path -- fd )
+  { sock_accept,	"sock-accept", Normal, NULL }, // ( fd -- fd' | -1 )
+  { sock_recv,	"sock-recv", Normal, NULL }, // ( fd buf n -- nr | -1 )
+  { sock_send,	"sock-send", Normal, NULL }, // ( fd buf n -- nx | -1 )
+  { udp_sendto,	"udp-sendto", Normal, NULL }, // ( fd buf n host port -- nx | -1 )
+  { sock_close,	"sock-close", Normal, NULL }, // ( fd -- )
+#endif
   { qdlopen,	"dlopen", Normal, NULL },
   { qdlclose,	"dlclose", Normal, NULL },
   { qdlsym,	"dlsym", Normal, NULL },
   { qdlerror,	"dlerror", Normal, NULL },
+#ifdef IN_MMAP
+  { save_image,	"save-image", Normal, NULL }, // ( <file> -- )
+  { compile_c,	"compile-c", Normal, NULL }, // ( <file> -- )
+#endif
   { last_will,	"atexit", Normal, NULL },
   { spinner,	"spin", Normal, NULL },
   { path,	"path", Normal, NULL }, // ( -- ptr )
@@ -665,13 +1055,45 @@ Dict_t Primitives[] = {
   { it_reset, "it_reset", Normal, NULL },
   { it_doit, "it_doit", Normal, NULL },
 #endif /* HOSTED */
-  { callout,	"native", Normal, NULL },
+#ifdef TIMERS
+  { after,	"after", Normal, NULL }, // ( usecs xt -- id )
+  { every,	"every", Normal, NULL }, // ( usecs xt -- id )
+  { cancel,	"cancel", Normal, NULL }, // ( id -- )
+  { dottimers,	".timers", Normal, NULL },
+#endif
+  { callout,	"native", Normal, NULL }, // ( args.. n fnptr -- rv )
+  { doNative,	"(native)", Normal, NULL },
+  { qbind,	"bind", Normal, NULL }, // ( fnptr sig <name> -- )
+#ifdef HOSTED
+  { import,	"import", Normal, NULL }, // ( lib sig <name> -- )
+#endif
+  { bind_map,	"bind-map", Normal, NULL }, // ( args count results xt -- )
   { clkspersec,	"clks", Normal, NULL },
   { plusplus,	"++", Normal, NULL },
   { minusminus,	"--", Normal, NULL },
   { utime,	"utime", Normal, NULL },
+#ifdef NATIVE
+  { cycles,	"cycles", Normal, NULL },
+#endif
+  { task,	"task", Normal, NULL }, // ( <name> -- )
+  { activate,	"activate", Normal, NULL }, // ( xt task -- )
+  { Pause,	"pause", Normal, NULL },
+  { stop,	"stop", Normal, NULL },
   { ops,	"ops", Normal, NULL },
   { noops,	"noops", Normal, NULL },
+#ifdef PROFILE
+  { profile_on,	"profile-on", Normal, NULL },
+  { profile_off,	"profile-off", Normal, NULL },
+  { profile_reset,	"profile-reset", Normal, NULL },
+  { dotprofile,	".profile", Normal, NULL },
+#endif
+#ifdef SAMPLER
+  { sample_on,	"sample-on", Normal, NULL }, // ( usecs -- )
+  { sample_off,	"sample-off", Normal, NULL },
+  { samples,	"samples", Normal, NULL }, // ( -- n )
+  { dotsamples,	".samples", Normal, NULL }, // ( n -- )
+  { dotfolded,	".folded", Normal, NULL },
+#endif
   { qdo,	"do", Immediate, NULL },
   { do_do,	"(do)", Normal, NULL },
   { do_I,	"i", Normal, NULL },
@@ -679,6 +1101,13 @@ Dict_t Primitives[] = {
   { do_loop,	"(loop)", Normal, NULL },
   { ploop,	"+loop", Immediate, NULL },
   { do_ploop,	"(+loop)", Normal, NULL },
+#ifdef PARDO
+  { pardo,	"pardo", Immediate, NULL },
+  { par_do,	"(pardo)", Normal, NULL }, // ( [seed] limit start -- [n] )
+  { parloop,	"parloop", Immediate, NULL },
+  { parreduce,	"parreduce", Immediate, NULL }, // ( <word> -- )
+  { par_workers,	"par-workers", Normal, NULL }, // ( n -- )
+#endif
   { forget,	"forget", Normal, NULL },
   { fmt_start,	"<#", Normal, NULL },
   { fmt_digit,	"#", Normal, NULL },
@@ -687,29 +1116,52 @@ Dict_t Primitives[] = {
   { fmt_sign,	"sign", Normal, NULL },
   { fmt_end,	"#>", Normal, NULL },
   { utf8_encode, "utf8", Normal, NULL }, // ( ch buf len -- len )
-  { accept,	"accept", Normal, NULL }, // ( buf len -- n )
+  { qaccept,	"accept", Normal, NULL }, // ( buf len -- n )
   { find,	"find", Normal, NULL }, // ( ptr -- dp | 0  )
   { version,	"version", Normal, NULL }, // ( -- Mjr Mnr Rev )
   { code,	"code", Normal, NULL }, // ( -- adr )
   { data,	"data", Normal, NULL }, // ( -- adr )
   { align,	"align", Normal, NULL }, // ( adr -- adr' )
   { fill,	"fill", Normal, NULL }, // ( adr -- adr' )
+  { move,	"move", Normal, NULL }, // ( src dst n -- )
+  { compare,	"compare", Normal, NULL }, // ( a1 n1 a2 n2 -- n )
+  { search,	"search", Normal, NULL }, // ( a1 n1 a2 n2 -- a3 n3 f )
+  { scan,	"scan", Normal, NULL }, // ( addr n char -- addr' n' )
+  { skip,	"skip", Normal, NULL }, // ( addr n char -- addr' n' )
+  { cell_fill,	"cell-fill", Normal, NULL }, // ( addr n x -- )
+  { cell_move,	"cell-move", Normal, NULL }, // ( src dst n -- )
+  { read_cells,	"read-cells", Normal, NULL }, // ( addr n -- m )
+  { write_cells,	"write-cells", Normal, NULL }, // ( addr n base -- )
+  { array,	"array", Normal, NULL }, // ( n size -- )
+  { array_len,	"array-len", Normal, NULL }, // ( arr -- n )
+  { array_fetch,	"array@", Normal, NULL }, // ( i arr -- x )
+  { array_store,	"array!", Normal, NULL }, // ( x i arr -- )
+  { array_add,	"array+", Normal, NULL }, // ( a b c -- )
+  { array_sub,	"array-", Normal, NULL }, // ( a b c -- )
+  { array_mul,	"array*", Normal, NULL }, // ( a b c -- )
+  { array_and,	"array-and", Normal, NULL }, // ( a b c -- )
+  { array_or,	"array-or", Normal, NULL }, // ( a b c -- )
+  { array_shift,	"array-shift", Normal, NULL }, // ( a k c -- )
+  { array_scale,	"array-scale", Normal, NULL }, // ( a k c -- )
+  { array_sum,	"array-sum", Normal, NULL }, // ( a -- n )
+  { array_min,	"array-min", Normal, NULL }, // ( a -- n )
+  { array_max,	"array-max", Normal, NULL }, // ( a -- n )
+  { array_dot,	"array-dot", Normal, NULL }, // ( a b -- n )
+  { array_scan,	"array-scan", Normal, NULL }, // ( a c -- )
+  { array_convert,	"array-convert", Normal, NULL }, // ( a c -- )
+  { arena_new,	"arena-new", Normal, NULL }, // ( bytes -- arena )
+  { arena_alloc,	"arena-alloc", Normal, NULL }, // ( arena n -- addr | 0 )
+  { arena_reset,	"arena-reset", Normal, NULL }, // ( arena -- )
+  { arena_space,	"arena-free", Normal, NULL }, // ( arena -- bytes )
+  { dotarena,	".arena", Normal, NULL }, // ( arena -- )
+  { pool_new,	"pool-new", Normal, NULL }, // ( size count -- pool )
+  { pool_get,	"pool-get", Normal, NULL }, // ( pool -- addr | 0 )
+  { pool_put,	"pool-put", Normal, NULL }, // ( addr pool -- )
+  { pool_space,	"pool-free", Normal, NULL }, // ( pool -- n )
+  { dotpool,	".pool", Normal, NULL }, // ( pool -- )
   { NULL, 	NULL, 0, NULL }
 } ;
-
-Dict_t Colon_Defs[sz_ColonDefs] ;
-Cell_t n_ColonDefs = 0 ;
-
-Cell_t flash[sz_FLASH] = { FLASH_INIT_VAL } ;
-Cell_t *flash_mem = StartOf( flash ) ;
-
-// Some global state variables (see forget();)
-Cell_t *Here ;
-Cell_t *DictPtr ;
-Byt_t  *String_Data = NULL ;
-Byt_t  *String_LowWater = NULL ;
-Cell_t  Base = 10 ;
-Cell_t  Trace = 0 ;
+#define n_Primitives	((Cell_t) (sizeof( Primitives ) / sizeof( Dict_t )))
 
 typedef enum {
  state_Interactive,
@@ -719,9 +1171,6 @@ typedef enum {
  state_Undefined
 } State_t ;
 
-State_t state = state_Interactive ;
-State_t state_save = state_Interactive ;
-
 /*
  -- error codes and strings
 */
@@ -747,6 +1196,7 @@ typedef enum {
   err_NoFile,
   err_InStack,
   err_Range,
+  err_BadImage,
   err_Undefined
 } Err_t ;
 
@@ -772,6 +1222,7 @@ Str_t errors[] = {
   "-- No file access.",
   "-- Input stack overflow.",
   "-- Range error.",
+  "-- Bad image file.",
   "-- Undefined error.",
   NULL,
 } ;
@@ -797,17 +1248,501 @@ Str_t resetfrom[] = {
   NULL
 } ;
 
-Wrd_t promptVal ;
 Str_t promptStr[] = {
   "ok ",
   "-- ",
   NULL
 } ;
 
-Str_t error_loc = (Str_t) NULL ;
-Err_t error_code = 0 ;
 Str_t digits = { "0123456789abcdefghijklmnopqrstuvwxyz" } ;
 
+#ifdef HOSTED 
+// every library and symbol looked up is remembered, so values
+// the dictionary holds can be re-resolved when an image loads.
+#ifndef sz_NATIVES
+#define sz_NATIVES	64
+#endif
+
+typedef struct {
+  Cell_t lib ;		// index of the library entry, or -1 for a library
+  Str_t  name ;		// cached, NULL for dlopen( 0 )
+  Cell_t value ;
+} Native_t ;
+
+#endif
+
+#ifdef ARENA
+// each arena is reserved with a PROT_NONE guard page on either side,
+// pages are only committed when touched, so the sizes can be generous.
+// A fault in a guard page is turned back into the error it stands for.
+typedef enum {
+  ar_Stack,
+  ar_RStack,
+  ar_UStack,
+  ar_Flash,
+  ar_Defs,
+  ar_TmpBuf,
+  ar_Profile,
+  ar_Max
+} Arena_Id_t ;
+
+typedef struct {
+  Byt_t  *lo ;		// the reservation, guard pages included
+  Byt_t  *hi ;
+  Byt_t  *base ;	// the usable part
+  Cell_t  bytes ;
+} Arena_t ;
+
+#endif
+
+#ifdef TASKS
+#ifndef sz_TASKS
+#define sz_TASKS	8		// the interpreter itself is task 0
+#endif
+#ifndef sz_CSTACK
+#define sz_CSTACK	(256 * 1024)	// bytes of C stack for each task
+#endif
+
+typedef enum {
+  task_Free,
+  task_Ready,
+  task_Stopped
+} Run_t ;
+
+// the machine of a task which is not running, see task_switch()
+typedef struct {
+  ucontext_t tk_ctx ;
+  jmp_buf  tk_env ;
+  Cell_t  *tk_stack, *tk_rstack, *tk_ustack ;
+  Cell_t  *tk_tos, *tk_rtos, *tk_utos ;
+  Arena_t  tk_arena[ ar_UStack + 1 ] ;	// guards for the three stacks
+  Arena_t  tk_cstack ;
+  Dict_t  *tk_xt ;
+  Run_t    tk_run ;
+  Wrd_t    tk_fd ;		// waiting for input on fd ...
+  uCell_t  tk_until ;		// ... or until then (usecs), see io_wait()
+  Wrd_t    tk_ready ;		// and which it was
+#ifdef STK_TRUST
+  Cell_t   tk_chk ;		// its chk_Ok
+#endif
+} Task_t ;
+#endif
+
+#ifdef TIMERS
+#ifndef sz_TIMERS
+#define sz_TIMERS	64		// pending at once
+#endif
+
+typedef struct {
+  uCell_t  tm_due ;		// usecs, on the CLOCK_MONOTONIC clock
+  uCell_t  tm_period ;		// 0 for a one shot
+  Dict_t  *tm_xt ;
+  Cell_t   tm_id ;		// 0 when free
+  Cell_t   tm_pos ;		// in tm_Heap
+  uCell_t  tm_runs ;
+  uCell_t  tm_late ;		// usecs past due, all runs ...
+  uCell_t  tm_late_max ;	// ... and the worst of them
+  uCell_t  tm_overruns ;	// periods missed altogether
+} Timer_t ;
+#endif
+
+#ifdef EVENTS
+#ifndef sz_EVENTS
+#define sz_EVENTS	64		// fds watched at once
+#endif
+
+typedef struct {
+  Wrd_t    ev_sock ;
+  Wrd_t    ev_out ;		// watching for output rather than input
+  Dict_t  *ev_xt ;		// run ( fd -- ) when it is ready
+} Event_t ;
+
+#ifndef sz_WORKERS
+#define sz_WORKERS	64		// most -w allows, see srv_run()
+#endif
+#endif
+
+#ifdef JIT
+#ifndef sz_JIT
+#define sz_JIT		(256 * 1024)	// bytes of generated code
+#endif
+#define sz_JITMAP	4096		// cells in the longest colon def
+#define jit_NoTarget	0xffffffff
+#endif
+
+#ifdef TOKENS
+#ifndef sz_TOKMAP
+#define sz_TOKMAP	256		// cells in the longest colon def packed
+#endif
+#endif
+
+#ifndef sz_STKMAP
+#define sz_STKMAP	256		// cells in the longest colon def with an effect
+#endif
+#define stk_None	(-0x7fff - 1)
+
+// trace bits, 1 trace ! prints each word as it runs and ring-on keeps
+// the last sz_RING in memory instead, see tracing() ...
+#define trc_Print	1
+#define trc_Ring	2
+#ifndef sz_RING
+#define sz_RING		256		// a power of 2
+#endif
+#define sz_RINGDUMP	16		// shown by catch()
+
+typedef struct {
+  Dict_t  *tr_dp ;
+  Cell_t   tr_depth ;
+  Cell_t   tr_top ;
+  uint64_t tr_clock ;		// see tr_clock()
+} Trace_t ;
+
+#ifdef SAMPLER
+#ifndef sz_SAMPLES
+#define sz_SAMPLES	16384
+#endif
+#define sz_SAMPLEDEPTH	15
+
+typedef struct {
+  Dict_t  *sm_dp ;		// the word running
+  Cell_t   sm_n ;
+  Cell_t   sm_at[ sz_SAMPLEDEPTH ] ;	// return addresses, innermost first,
+} Sample_t ;			// and then their words, see sm_resolve()
+#endif
+
+#ifdef PROFILE
+#define sz_PSTACK	64
+
+typedef struct {
+  uCell_t count ;
+  uCell_t incl ;
+  uCell_t excl ;
+} Prof_t ;
+
+typedef struct {		// the profiler's shadow stack, see prof_enter()
+  Cell_t  idx ;
+  uCell_t start ;
+  uCell_t child ;
+} Pframe_t ;
+#endif
+
+#ifdef PARDO
+#ifndef sz_PARDO
+#define sz_PARDO	64		// most workers, see par_workers()
+#endif
+
+typedef struct {
+  struct _vm_ *pw_vm ;
+  pthread_t pw_thread ;
+  Wrd_t    pw_started ;
+  Dict_t   pw_body ;		// the thread between (pardo) and its end
+  Cell_t   pw_lo, pw_hi ;	// the chunk of the range
+  Cell_t   pw_seeded ;
+  Cell_t   pw_seed ;		// and the chunk's value, with a reduction
+  Cell_t   pw_base ;
+  Err_t    pw_err ;
+} Par_t ;
+#endif
+
+// a block buffer, see blk_get()
+typedef struct {
+  Cell_t   bk_blk ;		// the block in it, -1 for none
+  uCell_t  bk_used ;		// blk_Clock when last used
+  Cell_t   bk_dirty ;		// updated since it was read
+  Byt_t    bk_data[ blk_Size ] ;
+} Block_t ;
+
+/*
+ -- the machine: everything an interpreter changes as it runs lives
+    in a VM_t, reached through vm (one per thread on HOSTED builds),
+    so that several can run in one process, see off_create().  The
+    names below stand for the fields of the running one.
+*/
+#ifdef HOSTED
+#define THREAD		__thread
+#else
+#define THREAD
+#endif
+
+typedef struct _vm_ {
+#ifdef ARENA
+  Cell_t  *stack, *rstack, *ustack ;
+  Cell_t  *flash ;
+  Dict_t  *Colon_Defs ;
+  Byt_t   *tmp_buffer ;
+  Arena_t  Arenas[ ar_Max ] ;
+#else
+  Cell_t   stack[ sz_STACK + 1 ], rstack[ sz_STACK + 1 ], ustack[ sz_STACK + 1 ] ;
+  Cell_t   flash[ sz_FLASH ] ;
+  Dict_t   Colon_Defs[ sz_ColonDefs ] ;
+  Byt_t    tmp_buffer[ sz_TMPBUFFER ] ;
+#endif
+  Cell_t  *tos, *rtos, *utos ;
+  Cell_t  *flash_mem ;
+  Cell_t   n_ColonDefs ;
+  Dict_t  *Dict_Hash[ sz_HASH ] ;	// name index, newest first, see lookup()
+  Dict_t  *Dict_Base[ sz_HASH ] ;	// what dict_rehash() starts from
+  Cell_t  *Here ;
+  Cell_t  *DictPtr ;
+  Byt_t   *String_Data ;
+  Byt_t   *String_LowWater ;
+  Cell_t   Base ;
+  Cell_t   Trace ;
+  Cell_t   Fusion ;
+  Cell_t   quiet ;
+#ifdef STK_TRUST
+  Cell_t   chk_Ok ;		// the depth was checked on the way in, see stk_enter()
+#endif
+#ifdef TOKENS
+  Dict_t  *tok_Defs ;		// the Colon_Defs[] tokens index, see tok_dict()
+#endif
+  State_t  state ;
+  State_t  state_save ;
+  Err_t    error_code ;
+  Err_t    error_last ;		// the last error caught, see off_eval()
+  Str_t    error_loc ;
+  Wrd_t    promptVal ;
+  Cell_t   sign_is_negative ;
+  Cell_t  *peep_Here ;		// Here just after the last emit ...
+  Cell_t  *peep_Last ;		// and where that instruction went
+  uCell_t  _ops ;
+  Cir_Queue_t T ;
+  Cir_Queue_t *TB ;
+  int      in_This, in_files[ sz_FILES ] ;
+  int      out_This, out_files[ sz_FILES ] ;
+  Input_t  InputStack[ sz_FILES ] ;
+  Byt_t    input_buffer[ sz_FILES * sz_INBUF ] ;
+  Byt_t   *inbuf[ sz_FILES + 1 ] ;
+  Byt_t    in_acc[ sz_INBUF + 1 ] ;	// token accumulator
+  Byt_t    found_eol ;
+  Str_t    in_Back ;		// a token to slice again ...
+  Wrd_t    in_BackLen ;		// ... and its length
+  Str_t    Locale ;
+#ifdef HOSTED
+  jmp_buf  env ;
+  Str_t    off_path ;
+  Byt_t    output_buffer[ sz_FILES ][ sz_OUTBUF ] ;
+  Wrd_t    out_len[ sz_FILES ] ;
+  Buf_t    out_mode[ sz_FILES ] ;
+  Native_t Natives[ sz_NATIVES ] ;
+  Cell_t   n_Natives ;
+#endif
+#ifdef JIT
+  uByt_t  *jit_Base ;
+  uByt_t  *jit_Here ;
+  uByt_t  *jit_P ;
+  Cell_t   jit_L ;		// epilogue, and jit_L + 1 skips the write back
+  Cell_t   Jit_Auto ;
+  uint32_t jit_Map[ sz_JITMAP + 2 ] ;	// thread cell -> code offset
+  struct {
+    uByt_t *at ;
+    Cell_t  idx ;
+  } jit_Fix[ sz_JITMAP ] ;
+  Cell_t   jit_nFix ;
+#endif
+#ifdef TASKS
+  Task_t   task_Main ;		// the interpreter, when it is not running
+  Task_t  *Tasks[ sz_TASKS ] ;
+  Cell_t   task_This ;
+  Cell_t   task_Count ;		// tasks ready to run besides task 0
+  Cell_t   n_Tasks ;		// task numbers handed out by task()
+#endif
+#ifdef TIMERS
+  Timer_t  Timers[ sz_TIMERS ] ;
+  Cell_t   tm_Heap[ sz_TIMERS ] ;	// slots, soonest first
+  Cell_t   n_Timers ;
+  Cell_t   tm_Serial ;
+  Cell_t   tm_Busy ;
+  Cell_t   tm_Armed ;
+#ifdef HOSTED
+  timer_t  tm_Posix ;
+#else
+  volatile uCell_t tm_Next ;	// the soonest, for tick_isr()
+#endif
+  Cell_t   it_Id ;		// the timer it_set started
+  volatile sig_atomic_t tm_Due ;	// set from the signal, see tm_alarm()
+#endif
+#ifdef EVENTS
+  Wrd_t    ev_Poll ;		// the epoll or kqueue fd
+  Event_t  Events[ sz_EVENTS ] ;
+  Cell_t   n_Events ;
+#endif
+  Trace_t  tr_Ring[ sz_RING ] ;
+  uCell_t  tr_Next ;		// entries recorded, the next goes here
+#ifdef SAMPLER
+  Cell_t  *sm_Ip ;		// just past the cell running, see vm_Cell
+  Dict_t  *sm_Word ;		// or the word execute() is running
+  Sample_t *sm_Buf ;
+  volatile sig_atomic_t sm_On ;
+  Cell_t   sm_Count ;
+  Cell_t   sm_Done ;		// resolved, see sm_resolve()
+  Cell_t   sm_Lost ;
+  Cell_t   sm_Usecs ;
+#endif
+#ifdef PROFILE
+  Cell_t   Profile ;		// each VM profiles itself, workers start off
+  Pframe_t prof_Stack[ sz_PSTACK ] ;
+  Cell_t   prof_Depth ;
+#ifdef ARENA
+  Prof_t  *Profile_Data ;	// see arena_init()
+#else
+  Prof_t   Profile_Data[ n_Primitives + sz_ColonDefs ] ;
+#endif
+#endif
+#ifdef PARDO
+  Par_t    par_Pool[ sz_PARDO ] ;
+  Cell_t   par_N ;		// workers to use, 0 until par_init()
+  Cell_t   par_Running ;	// threads not yet joined
+  Cell_t   par_Worker ;		// this VM is one, it runs pardo itself
+#endif
+  Block_t  blk_Bufs[ sz_BUFFERS ] ;
+  Block_t *blk_Cur ;		// the last block or buffer, for update
+  Block_t *blk_Load[ sz_FILES ] ;	// the block each input is loading
+  uCell_t  blk_Clock ;
+  Cell_t   blk_Next ;		// the block after the last one read ...
+  Cell_t   blk_Ahead ;		// ... and how many past it to read ahead
+#ifdef HOSTED
+  Wrd_t    blk_Fd ;
+#else
+  Byt_t    blk_Flash[ sz_BLOCKS ][ blk_Size ] ;
+#endif
+} VM_t ;
+
+VM_t off_Main ;
+THREAD VM_t *vm = NULL ;
+
+#define stack		(vm ->stack)
+#define rstack		(vm ->rstack)
+#define ustack		(vm ->ustack)
+#define flash		(vm ->flash)
+#define Colon_Defs	(vm ->Colon_Defs)
+#define tmp_buffer	(vm ->tmp_buffer)
+#define Arenas		(vm ->Arenas)
+#define tos		(vm ->tos)
+#define rtos		(vm ->rtos)
+#define utos		(vm ->utos)
+#define flash_mem	(vm ->flash_mem)
+#define n_ColonDefs	(vm ->n_ColonDefs)
+#define Dict_Hash	(vm ->Dict_Hash)
+#define Dict_Base	(vm ->Dict_Base)
+#define Here		(vm ->Here)
+#define DictPtr		(vm ->DictPtr)
+#define String_Data	(vm ->String_Data)
+#define String_LowWater	(vm ->String_LowWater)
+#define Base		(vm ->Base)
+#define Trace		(vm ->Trace)
+#define Fusion		(vm ->Fusion)
+#ifdef STK_TRUST
+#define chk_Ok		(vm ->chk_Ok)
+#endif
+#ifdef TOKENS
+#define tok_Defs	(vm ->tok_Defs)
+#endif
+#define quiet		(vm ->quiet)
+#define state		(vm ->state)
+#define state_save	(vm ->state_save)
+#define error_code	(vm ->error_code)
+#define error_last	(vm ->error_last)
+#define error_loc	(vm ->error_loc)
+#define promptVal	(vm ->promptVal)
+#define sign_is_negative (vm ->sign_is_negative)
+#define peep_Here	(vm ->peep_Here)
+#define peep_Last	(vm ->peep_Last)
+#define _ops		(vm ->_ops)
+#define T		(vm ->T)
+#define TB		(vm ->TB)
+#define in_This		(vm ->in_This)
+#define in_files	(vm ->in_files)
+#define out_This	(vm ->out_This)
+#define out_files	(vm ->out_files)
+#define InputStack	(vm ->InputStack)
+#define input_buffer	(vm ->input_buffer)
+#define inbuf		(vm ->inbuf)
+#define in_acc		(vm ->in_acc)
+#define found_eol	(vm ->found_eol)
+#define in_Back		(vm ->in_Back)
+#define in_BackLen	(vm ->in_BackLen)
+#define Locale		(vm ->Locale)
+#define env		(vm ->env)
+#define off_path	(vm ->off_path)
+#define output_buffer	(vm ->output_buffer)
+#define out_len		(vm ->out_len)
+#define out_mode	(vm ->out_mode)
+#define Natives		(vm ->Natives)
+#define n_Natives	(vm ->n_Natives)
+#define jit_Base	(vm ->jit_Base)
+#define jit_Here	(vm ->jit_Here)
+#define jit_P		(vm ->jit_P)
+#define jit_L		(vm ->jit_L)
+#define Jit_Auto	(vm ->Jit_Auto)
+#define jit_Map		(vm ->jit_Map)
+#define jit_Fix		(vm ->jit_Fix)
+#define jit_nFix	(vm ->jit_nFix)
+#define task_Main	(vm ->task_Main)
+#define Tasks		(vm ->Tasks)
+#define task_This	(vm ->task_This)
+#define task_Count	(vm ->task_Count)
+#define n_Tasks		(vm ->n_Tasks)
+#define Timers		(vm ->Timers)
+#define tm_Heap		(vm ->tm_Heap)
+#define n_Timers	(vm ->n_Timers)
+#define tm_Serial	(vm ->tm_Serial)
+#define tm_Busy		(vm ->tm_Busy)
+#define tm_Armed	(vm ->tm_Armed)
+#define tm_Posix	(vm ->tm_Posix)
+#define tm_Next		(vm ->tm_Next)
+#define it_Id		(vm ->it_Id)
+#define tm_Due		(vm ->tm_Due)
+#define blk_Bufs	(vm ->blk_Bufs)
+#define blk_Cur		(vm ->blk_Cur)
+#define blk_Load	(vm ->blk_Load)
+#define blk_Clock	(vm ->blk_Clock)
+#define blk_Next	(vm ->blk_Next)
+#define blk_Ahead	(vm ->blk_Ahead)
+#define blk_Fd		(vm ->blk_Fd)
+#define blk_Flash	(vm ->blk_Flash)
+
+// branches and tokens are the safe points for timers, see tm_poll()
+#ifdef TIMERS
+#define tm_Safe()	do { if( tm_Due ) tm_poll() ; } while( 0 )
+#define tm_Key( i )	(Timers[ tm_Heap[ i ] ].tm_due)
+#else
+#define tm_Safe()	{}
+#endif
+#define ev_Poll		(vm ->ev_Poll)
+#define Events		(vm ->Events)
+#define n_Events	(vm ->n_Events)
+#define tr_Ring		(vm ->tr_Ring)
+#define tr_Next		(vm ->tr_Next)
+#define sm_Ip		(vm ->sm_Ip)
+#define sm_Word		(vm ->sm_Word)
+#define sm_Buf		(vm ->sm_Buf)
+#define sm_On		(vm ->sm_On)
+#define sm_Count	(vm ->sm_Count)
+#define sm_Done		(vm ->sm_Done)
+#define sm_Lost		(vm ->sm_Lost)
+#define sm_Usecs	(vm ->sm_Usecs)
+#define Profile		(vm ->Profile)
+#define prof_Stack	(vm ->prof_Stack)
+#define prof_Depth	(vm ->prof_Depth)
+#define Profile_Data	(vm ->Profile_Data)
+#define par_Pool	(vm ->par_Pool)
+#define par_N		(vm ->par_N)
+#define par_Running	(vm ->par_Running)
+#define par_Worker	(vm ->par_Worker)
+
+// where the interpreter is, for sm_sample() ...
+#ifdef SAMPLER
+#define sm_Mark( x )	(sm_Ip = (x))
+#define sm_Note( x )	(sm_Word = (x))
+#else
+#define sm_Mark( x )
+#define sm_Note( x )
+#endif
+
+// the primitives are shared by every VM, see dict_init() ...
+Dict_t *Prim_Hash[ sz_HASH ] = { NULL } ;
+
 /*
  -- string and character handling stuff which converts
     numbers, reads tokens and performs the platform
@@ -820,32 +1755,97 @@ Wrd_t put_str( Str_t s );
 Wrd_t get_str( Wrd_t fd, Str_t buf, Wrd_t len );
 Wrd_t inp( Wrd_t fd, Str_t buf, Wrd_t len );
 Wrd_t outp( Wrd_t fd, Str_t buf, Wrd_t len );
+Wrd_t out_write( Wrd_t fd, Str_t buf, Wrd_t len );
+void out_flush( Wrd_t slot );
+void out_flushall( void );
 Wrd_t str_match( Str_t a, Str_t b, Wrd_t len );
+Wrd_t str_cmp( Str_t a, Str_t b, Wrd_t len );
+Str_t str_scan( Str_t p, Wrd_t len, Byt_t ch, Wrd_t skip );
+void str_move( Str_t dst, Str_t src, Wrd_t len );
 Wrd_t str_length( Str_t str );
 Wrd_t str_literal( Str_t tkn, Wrd_t radix );
+Wrd_t str_nliteral( Str_t tkn, Wrd_t len, Wrd_t radix );
 Wrd_t str_format( Str_t dst, Wrd_t dlen, Str_t fmt, ... );
 Wrd_t str_format_ap( Str_t dst, Wrd_t dlen, Str_t fmt, va_list ap );
 void str_set( Str_t dst, Byt_t dat, Wrd_t len );
 Wrd_t str_copy( Str_t dst, Str_t src, Wrd_t len );
 Wrd_t str_utoa( uByt_t *dst, Wrd_t dlen, Cell_t val, Wrd_t radix );
 Wrd_t str_ntoa( Str_t dst, Wrd_t dlen, Cell_t val, Wrd_t radix, Wrd_t isSigned );
+uByt_t *str_digits( uByt_t *p, uCell_t n, uCell_t radix );
+Str_t str_number( Str_t tkn, Wrd_t len, Wrd_t radix, Cell_t *val );
 Str_t str_token( Input_t *inptr );
+Str_t str_slice( Input_t *inptr, Wrd_t *len );
+void in_map( Input_t *inptr );
+void in_unmap( Input_t *inptr );
+void in_pop( void );
+void in_showline( Input_t *inptr );
+Wrd_t blk_io( Block_t *b, Wrd_t writing );
+Block_t *blk_get( Cell_t n, Wrd_t reading );
+void blk_close( void );
+typedef enum {
+  img_Raw = 0,
+  img_Prim,		// Primitives[] index
+  img_Colon,		// Colon_Defs[] index
+  img_Flash,		// byte offset into flash
+  img_Code,		// Primitives[] index of a cfa
+  img_Native		// Natives[] index
+} Img_t ;
+
+Err_t img_load( Str_t fn );
+void img_hook( void );
+#ifdef AOT
+extern Fptr_t aot_Code[] ;		// written by compile-c
+extern Cell_t aot_Words ;
+void aot_load( void );
+Wrd_t aot_run( Dict_t *dp, Cell_t *r );
+#endif
+void arena_init( void );
+Wrd_t arena_sizes( void );
+void arena_free( void );
+#ifdef ARENA
+void *arena_reserve( Arena_t *ap, Cell_t bytes, Cell_t *rounded );
+#endif
+void vm_init( VM_t *v, VM_t *shared );
+void arena_signals( void );
 Str_t str_delimited( Str_t term ) ;
 Str_t str_cache( Str_t tag );
 Str_t str_seal( void );
 Str_t str_uncache( Str_t tag );
+uWrd_t str_hash( Str_t str, Wrd_t len );
+void dict_index( Dict_t *dp );
+void dict_unindex( Dict_t *dp );
+void dict_init( void );
+void dict_rehash( void );
+Dict_t *lookup_len( Str_t tkn, Wrd_t len );
+uByt_t vm_opcode( Fptr_t cfa );
+void stk_prim( Dict_t *dp );
+void emit_op( Dict_t *dp );
+void emit_lit( Cell_t value );
+void peep_barrier( void );
+void tail_call( void );
+void tr_dump( Cell_t n );
 Wrd_t ch_matches( Byt_t ch, Str_t anyOf );
 Byt_t ch_tolower( Byt_t b );
 Wrd_t utf8_encoder( Wrd_t ch, Str_t buf, Wrd_t len );
 Wrd_t ch_index( Str_t str, Byt_t c );
 void sig_hdlr( int sig );
 Wrd_t io_cbreak( int fd );
+Wrd_t io_wait( Wrd_t fd, Cell_t usecs );
+Wrd_t io_busy( void );
 Wrd_t fmt_out( Str_t fmt, ... );
+Wrd_t err_out( Str_t fmt, ... );
+#ifdef PROFILE
+void prof_enter( Dict_t *dp );
+void prof_leave( void );
+void prof_leave_all( void );
+#endif
 
 #ifdef HOSTED
 
 void sig_hdlr( int sig ){
   sigval = sig ;
+  if( isNul( vm ) )	// not a thread with an interpreter
+    return ;
   throw( err_CaughtSignal ) ;
 //  if( sigval == SIGSEGV ){
 //    catch();
@@ -856,42 +1856,129 @@ void sig_hdlr( int sig ){
 
 Str_t  in_File = (Str_t) NULL ;
 Str_t  in_Word = (Str_t) NULL ;
-Cell_t quiet = 0 ;
+Str_t  in_Image = (Str_t) NULL ;
+Cell_t in_Trace = 0 ;
+#ifdef EVENTS
+Str_t  in_Serve = (Str_t) NULL ;	// see srv_run()
+Cell_t in_Workers = 4 ;
+Cell_t in_Requests = 1 ;
+Wrd_t  srv_Fd = -1 ;			// listening, in the workers
+Cell_t srv_Left = 0 ;			// requests before the worker exits
+#endif
 Dict_t *lookup( Str_t tkn );
 static int do_x_Once = 1 ;
 
+// before vm_init() there is no output buffer, so stderr ...
 void usage(int argc, char **argv )
 {
-  Wrd_t nx ;
-  nx = fmt_out( "usage:\n\t%s [-i <infile>] [-q] [-x <word>]\n\n", argv[0] ) ;
+  err_out( "usage:\n\t%s [-I <image>] [-i <infile>] [-q] [-t] [-r] [-x <word>]\n\n", argv[0] ) ;
+#ifdef ARENA
+  err_out( "\t[-F <flash cells>] [-C <colon defs>] [-S <stack cells>] [-T <tmp bytes>]\n" ) ;
+  err_out( "\t(or %s, %s, %s and %s in the environment,\n", OFF_FLASH, OFF_DEFS, OFF_STACK, OFF_TMP ) ;
+  err_out( "\tat least %d, %d, %d and %d)\n\n", ar_MinFlash, ar_MinDefs, ar_MinStack, ar_MinTmp ) ;
+#endif
+#ifdef EVENTS
+  err_out( "\t[-s <port or path> [-w <workers>] [-m <requests per worker>]]\n\n" ) ;
+#endif
+}
+
+#ifdef EVENTS
+#define SRV_ARGS "s:w:m:"
+#else
+#define SRV_ARGS ""
+#endif
+
+#ifdef ARENA
+#define STD_ARGS "I:i:x:qtrF:C:S:T:" SRV_ARGS
+
+Cell_t arena_env( Str_t name, Cell_t dflt )
+{
+  Str_t val = getenv( name ) ;
+
+  return isNul( val ) ? dflt : (Cell_t) strtol( val, NULL, 0 ) ;
 }
 
-#define STD_ARGS "i:x:qt"
+// sizes arena_init() can map, whether from the command line or not
+Wrd_t arena_sizes( void )
+{
+  return sz_FLASH >= ar_MinFlash && sz_FLASH <= ar_Most / (Cell_t) sizeof( Cell_t )
+      && sz_ColonDefs >= ar_MinDefs && sz_ColonDefs <= ar_Most / (Cell_t) sizeof( Dict_t )
+      && sz_STACK >= ar_MinStack && sz_STACK < ar_Most / (Cell_t) sizeof( Cell_t )
+      && sz_TMPBUFFER >= ar_MinTmp ;
+}
+#else
+#define STD_ARGS "I:i:x:qtr" SRV_ARGS
+#endif
+
 void chk_args( int argc, char **argv )
 {
   int ch, err=0 ; 
+#ifdef ARENA
+  sz_FLASH = arena_env( OFF_FLASH, sz_FLASH ) ;
+  sz_ColonDefs = arena_env( OFF_DEFS, sz_ColonDefs ) ;
+  sz_STACK = arena_env( OFF_STACK, sz_STACK ) ;
+  sz_TMPBUFFER = arena_env( OFF_TMP, sz_TMPBUFFER ) ;
+#endif
   while( (ch = getopt( argc, argv, STD_ARGS )) != -1 )
   {
     switch( ch )
     {
+        case 'I':
+          in_Image = (Str_t) optarg ;
+          break ;
         case 'i':
-          in_File = str_cache( optarg ) ;
+          in_File = (Str_t) optarg ;
           break ;
         case 'x':
-          in_Word = str_cache( optarg ) ; 
+          in_Word = (Str_t) optarg ; 
           break ;
         case 'q':
           quiet++ ;
           break ;
 		case 't':
-		  push( 1 );
-		  trace() ;
-		  wrd_store();
+		  in_Trace |= trc_Print ;
+          break ;
+        case 'r':
+          in_Trace |= trc_Ring ;
+          break ;
+#ifdef ARENA
+        case 'F':
+          sz_FLASH = (Cell_t) strtol( optarg, NULL, 0 ) ;
+          break ;
+        case 'C':
+          sz_ColonDefs = (Cell_t) strtol( optarg, NULL, 0 ) ;
+          break ;
+        case 'S':
+          sz_STACK = (Cell_t) strtol( optarg, NULL, 0 ) ;
+          break ;
+        case 'T':
+          sz_TMPBUFFER = (Cell_t) strtol( optarg, NULL, 0 ) ;
           break ;
+#endif
+#ifdef EVENTS
+        case 's':
+          in_Serve = (Str_t) optarg ;
+          break ;
+        case 'w':
+          in_Workers = (Cell_t) strtol( optarg, NULL, 0 ) ;
+          err += (in_Workers < 1 || in_Workers > sz_WORKERS) ;
+          break ;
+        case 'm':
+          in_Requests = (Cell_t) strtol( optarg, NULL, 0 ) ;
+          err += (in_Requests < 1) ;
+          break ;
+#endif
         default:
           err++ ;
     }
   }
+#ifdef ARENA
+  if( !arena_sizes() )
+  {
+     err_out( "-- arena sizes out of range.\n" ) ;
+     err++ ;
+  }
+#endif
   if( err )
   {
      usage( argc, argv );
@@ -902,8 +1989,36 @@ void chk_args( int argc, char **argv )
 
 #endif // HOSTED
 
-Str_t  Locale = (Str_t) NULL ;
-Byt_t  found_eol = (Byt_t) 0 ;
+// character classes for the tokenizer (WHITE_SPACE and EOL) ...
+#define cc_White	0x01
+#define cc_Eol		0x02
+uByt_t ch_class[256] = {
+  [' '] = cc_White,
+  ['\t'] = cc_White,
+  ['\r'] = cc_White | cc_Eol,
+  ['\n'] = cc_White | cc_Eol
+} ;
+
+// digit values by character, plus one, so that 0 is not a digit ...
+#define n_DIGITS	36
+uByt_t ch_digit[256] = {
+  ['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8,
+  ['8'] = 9, ['9'] = 10, ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+  ['g'] = 17, ['h'] = 18, ['i'] = 19, ['j'] = 20, ['k'] = 21, ['l'] = 22, ['m'] = 23, ['n'] = 24,
+  ['o'] = 25, ['p'] = 26, ['q'] = 27, ['r'] = 28, ['s'] = 29, ['t'] = 30, ['u'] = 31, ['v'] = 32,
+  ['w'] = 33, ['x'] = 34, ['y'] = 35, ['z'] = 36, ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14,
+  ['E'] = 15, ['F'] = 16, ['G'] = 17, ['H'] = 18, ['I'] = 19, ['J'] = 20, ['K'] = 21, ['L'] = 22,
+  ['M'] = 23, ['N'] = 24, ['O'] = 25, ['P'] = 26, ['Q'] = 27, ['R'] = 28, ['S'] = 29, ['T'] = 30,
+  ['U'] = 31, ['V'] = 32, ['W'] = 33, ['X'] = 34, ['Y'] = 35, ['Z'] = 36
+} ;
+
+// and two decimal digits at a time the other way, see str_digits()
+const char dec_pairs[] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899" ;
 
 // reset never forgets ...
 // forget does that (see below).
@@ -919,12 +2034,19 @@ void q_reset()
   signal( SIGKILL, sig_hdlr ) ;
   signal( SIGBUS, sig_hdlr ) ;
   signal( SIGFPE, sig_hdlr ) ;
+#ifdef ARENA
+  arena_signals() ;
+#else
   signal( SIGSEGV, sig_hdlr ) ;
 #endif
+#endif
 #endif
 
   decimal() ;
   promptVal = 0 ; 
+#ifdef PROFILE
+  prof_leave_all() ;
+#endif
 
   tos = (Cell_t *) StartOf( stack ) ; 
   *tos = FLASH_INIT_VAL ;
@@ -933,7 +2055,15 @@ void q_reset()
   *rtos = FLASH_INIT_VAL ;
 
   error_code = err_OK ;
+#ifdef STK_TRUST
+  chk_Ok = 0 ;
+#endif
   state = state_Interactive ;
+  in_Back = (Str_t) NULL ;
+#ifdef TIMERS
+  tm_Busy = 0 ;
+#endif
+  sm_Mark( NULL ) ;
 
 }
 
@@ -952,72 +2082,288 @@ volatile unsigned int * const UARTDR = (unsigned int *)0x101f1000;      // UART0
 volatile unsigned int * const UARTFR = (unsigned int *)0x101f1018;      // UART0 flag register
 volatile unsigned int * const UARTCR = (unsigned int *)0x101f1030;      // UART0 control register
 volatile unsigned int * const UARTLCR_H = (unsigned int *)0x101f102c;   // UART0 line control register
-
+volatile unsigned int * const UARTIFLS = (unsigned int *)0x101f1034;    // UART0 fifo level select
+volatile unsigned int * const UARTIMSC = (unsigned int *)0x101f1038;    // UART0 interrupt mask
+volatile unsigned int * const UARTMIS = (unsigned int *)0x101f1040;     // UART0 masked interrupt status
+volatile unsigned int * const UARTICR = (unsigned int *)0x101f1044;     // UART0 interrupt clear
+volatile unsigned int * const VICIRQSTATUS = (unsigned int *)0x10140000; // primary interrupt controller
+volatile unsigned int * const VICINTSELECT = (unsigned int *)0x1014000c;
+volatile unsigned int * const VICINTENABLE = (unsigned int *)0x10140010;
+volatile unsigned int * const SCCTRL = (unsigned int *)0x101e0000;       // system controller
+volatile unsigned int * const TIMER0LOAD = (unsigned int *)0x101e2000;   // SP804 timer 0, the tick
+volatile unsigned int * const TIMER0CTRL = (unsigned int *)0x101e2008;
+volatile unsigned int * const TIMER0CLR = (unsigned int *)0x101e200c;
+volatile unsigned int * const TIMER1LOAD = (unsigned int *)0x101e2020;   // timer 1, free running
+volatile unsigned int * const TIMER1VALUE = (unsigned int *)0x101e2024;
+volatile unsigned int * const TIMER1CTRL = (unsigned int *)0x101e2028;
+
+#define uart_BUSY	0x08		// flags
+#define uart_RXFE	0x10
+#define uart_TXFF	0x20
+#define uart_RXIM	0x10		// and interrupts
+#define uart_TXIM	0x20
+#define uart_RTIM	0x40
+#define vic_UART0	(1 << 12)
+#define vic_TIMER01	(1 << 4)
+#define sc_TIMCLK	((1 << 15) | (1 << 17))	// timers 0 and 1 at 1MHz
+#define tmr_ENABLE	0x80
+#define tmr_PERIODIC	0x40
+#define tmr_INTEN	0x20
+#define tmr_32BIT	0x02
+#ifndef us_TICK
+#define us_TICK		1000		// usecs between ticks
+#endif
 
 // defined in the assembler file ...
 int GET8( unsigned adr );
 int GET32( unsigned adr );
 int PUT32( unsigned adr, unsigned char ch );
+void enable_irq( void );
+void disable_irq( void );
+void WFI( void );
+
+// the interrupt fills the receive ring and drains the transmit ring,
+// so the core only waits when a ring is full (or empty, for key) ...
+#define sz_UARTRING	1024		// a power of 2
+
+typedef struct {
+  volatile uCell_t head ;		// written by the producer
+  volatile uCell_t tail ;		// and the consumer
+  uByt_t buf[ sz_UARTRING ] ;
+} Uart_Ring_t ;
+
+Uart_Ring_t uart_Rx, uart_Tx ;
+volatile uCell_t uart_Lost ;		// received with the ring full
+
+// what the transmit fifo will take, its interrupt asks for the rest
+void uart_kick( void )
+{
+  *UARTIMSC &= ~uart_TXIM ;
+  while( uart_Tx.tail != uart_Tx.head && !(*UARTFR & uart_TXFF) ){
+    *UARTDR = uart_Tx.buf[ uart_Tx.tail % sz_UARTRING ] ;
+    uart_Tx.tail++ ;
+  }
+  if( uart_Tx.tail != uart_Tx.head ){
+    *UARTIMSC |= uart_TXIM ;
+  }
+}
 
-void uart_putc ( unsigned int c )
+void uart_isr( void )
 {
-    while( ( *(UARTFR) & 0x20 ) != 0 );
-    *(UARTDR) = c & 0xff ;
+  unsigned int mis = *UARTMIS ;
+
+  if( mis & (uart_RXIM | uart_RTIM) ){
+    while( !(*UARTFR & uart_RXFE) ){
+      if( uart_Rx.head - uart_Rx.tail < sz_UARTRING ){
+        uart_Rx.buf[ uart_Rx.head % sz_UARTRING ] = *UARTDR ;
+        uart_Rx.head++ ;
+      } else {
+        (void) *UARTDR ;
+        uart_Lost++ ;
+      }
+    }
+  }
+  if( mis & uart_TXIM ){
+    uart_kick() ;
+  }
+  *UARTICR = mis ;
 }
 
-Cell_t uart_getc_ne( void )
-{
-  int ch ; 
-  while ( *(UARTFR) == 0x90 ) ;
+/*
+  -- time: timer 1 counts down from ~0 at 1MHz, so its complement is
+  usecs since timer_init() (wrapping with a cell, as clk_usecs() does
+  on 32 bit hosts).  Timer 0 interrupts every us_TICK usecs and marks
+  the VM when its soonest timer is due, as tm_alarm() does; the safe
+  points run it.  cycles counts cpu cycles where there is a PMCCNTR
+  (ARMv7 and after), and falls back to usecs on the ARM926.
+*/
+volatile uCell_t native_Ticks ;
 
-  ch = *(UARTDR) ;
-  return ch ;
+uCell_t native_usecs( void )
+{
+  return ~*TIMER1VALUE ;
 }
 
-Cell_t uart_getc( void )
+uCell_t native_cycles( void )
 {
-  int ch ; 
-  while ( *(UARTFR) == 0x90 ) ;
+#if defined( __ARM_ARCH ) && __ARM_ARCH >= 7
+  uCell_t c ;
 
-  ch = *(UARTDR) ;
-  uart_putc( ch ) ;
-  return ch ;
+  __asm__ volatile( "mrc p15, 0, %0, c9, c13, 0" : "=r" (c) ) ;
+  return c ;
+#else
+  return native_usecs() ;
+#endif
 }
 
-int uart_can_recv( void )
+void tick_isr( void )
 {
-   if( (*UARTFR) == 0x90 )
-     return( 0 );
+  *TIMER0CLR = 1 ;
+  native_Ticks++ ;
+  if( !isNul( vm ) && n_Timers > 0 && tm_Next <= native_usecs() ){
+    tm_Due = 1 ;
+  }
+}
 
-  return( 1 );
+void timer_init( void )
+{
+  *SCCTRL |= sc_TIMCLK ;
+  *TIMER1CTRL = 0 ;
+  *TIMER1LOAD = ~0U ;
+  *TIMER1CTRL = tmr_ENABLE | tmr_32BIT ;
+  *TIMER0CTRL = 0 ;
+  *TIMER0LOAD = us_TICK ;
+  *TIMER0CLR = 1 ;
+  *TIMER0CTRL = tmr_ENABLE | tmr_PERIODIC | tmr_INTEN | tmr_32BIT ;
+  *VICINTSELECT &= ~vic_TIMER01 ;
+  *VICINTENABLE = vic_TIMER01 ;
+#if defined( __ARM_ARCH ) && __ARM_ARCH >= 7
+  __asm__ volatile( "mcr p15, 0, %0, c9, c12, 0" : : "r" (1) ) ;		// PMCR, enable
+  __asm__ volatile( "mcr p15, 0, %0, c9, c12, 1" : : "r" (1U << 31) ) ;	// PMCNTENSET, the cycle counter
+#endif
 }
 
-void uart_init(void)
+// called from the irq vector, see qemu_versatile_start.s
+void irq_dispatch( void )
 {
-   // GET32( x_UARTDR );
-   return;
+  unsigned int status = *VICIRQSTATUS ;
+
+  if( status & vic_UART0 ){
+    uart_isr() ;
+  }
+  if( status & vic_TIMER01 ){
+    tick_isr() ;
+  }
 }
 
-int notmain( void )
+void uart_putc ( unsigned int c )
 {
-  uart_init();
+  while( uart_Tx.head - uart_Tx.tail >= sz_UARTRING ){
+    uart_kick() ;
+  }
+  uart_Tx.buf[ uart_Tx.head % sz_UARTRING ] = c & 0xff ;
+  uart_Tx.head++ ;
+  if( !(*UARTIMSC & uart_TXIM) ){
+    uart_kick() ;
+  }
+}
 
-#else // NATIVE vs HOSTED ... 
+// wait until all that was written has left the uart
+void uart_flush( void )
+{
+  while( uart_Tx.tail != uart_Tx.head ){
+    if( !(*UARTIMSC & uart_TXIM) ){
+      uart_kick() ;
+    }
+  }
+  while( *UARTFR & uart_BUSY ) ;
+}
 
-int main( int argc, char **argv )
+Cell_t uart_getc_ne( void )
+{
+  int ch ; 
+
+  while( uart_Rx.tail == uart_Rx.head ){
+    tm_Safe() ;				// the tick wakes us, see tick_isr()
+    disable_irq() ;			// so that its wakeup is not missed
+    if( uart_Rx.tail == uart_Rx.head && !tm_Due ){
+      WFI() ;
+    }
+    enable_irq() ;
+  }
+  ch = uart_Rx.buf[ uart_Rx.tail % sz_UARTRING ] ;
+  uart_Rx.tail++ ;
+  return ch ;
+}
+
+Cell_t uart_getc( void )
+{
+  int ch ; 
+
+  ch = uart_getc_ne() ;
+  uart_putc( ch ) ;
+  return ch ;
+}
+
+int uart_can_recv( void )
+{
+  return uart_Rx.tail != uart_Rx.head ;
+}
+
+void uart_init(void)
+{
+  *UARTCR = 0 ;				// off while it is set up
+  *UARTLCR_H = 0x70 ;			// 8 bits, fifos on
+  *UARTIFLS = 0x12 ;			// interrupt at half full, or half empty
+  *UARTICR = 0x7ff ;
+  *UARTIMSC = uart_RXIM | uart_RTIM ;
+  *UARTCR = 0x301 ;			// receive, transmit and enable
+  *VICINTSELECT &= ~vic_UART0 ;		// an irq, not a fiq
+  *VICINTENABLE = vic_UART0 ;
+  enable_irq() ;
+}
+
+int notmain( void )
+{
+  timer_init();
+  uart_init();
+
+#else // NATIVE vs HOSTED ... 
+
+#ifdef EMBED
+#define main	off_main	// the host has its own, see off_create()
+#endif
+
+int main( int argc, char **argv )
 {
 
 #endif
 
+  vm = &off_Main ;
+#ifdef HOSTED
+  atexit( out_flushall ) ;
+  atexit( blk_close ) ;
+  chk_args( argc, argv ) ;
+#endif
+  dict_init() ;
+  vm_init( vm, NULL ) ;
+
   forget() ; // puts the system in a known state ...
   q_reset() ;
+#ifdef AOT
+  aot_load() ; // and the words built in, see compile_c()
+#endif
+
+#ifdef HOSTED
+#ifdef IN_MMAP
+  if( !isNul( in_Image ) ) // the image replaces flash, so it goes first ...
+  {
+     Err_t err = img_load( in_Image ) ;
+     if( err != err_OK )
+     {
+        fmt_out( "%s: %s %s\n", argv[0], in_Image, errors[ err ] ) ;
+        exit( 1 ) ;
+     }
+  }
+#endif
+  Trace = in_Trace ;
+#endif
+
   push( "stdin" ) ; 
   infile() ; 
+#ifdef AOT
+  img_hook() ; // the words built in may want on-load too
+#endif
 
 #ifdef HOSTED
   Locale = str_cache( (Str_t) setlocale( LC_ALL, "" ) ) ;
   off_path = str_cache( getenv( OFF_PATH ) ) ;
-  chk_args( argc, argv ) ;
+#ifdef IN_MMAP
+  if( !isNul( in_Image ) )
+  {
+     img_hook() ;
+  }
+#endif
   if( !isNul( in_File ) )
   {
      push( (Str_t) in_File );
@@ -1035,6 +2381,12 @@ int main( int argc, char **argv )
 #endif
 
   str_seal() ;
+#ifdef EVENTS
+  if( !isNul( in_Serve ) && in_This == 0 ) // else once -i is loaded, see Eof()
+  {
+     srv_run() ; // only the workers return, with a connection for stdin
+  }
+#endif
   banner() ;
   quit() ;
   return 0 ;
@@ -1108,11 +2460,81 @@ Wrd_t ch_index( Str_t str, Byt_t c )
   return -1;
 }
 
-Str_t str_token( Input_t *input )
+#ifdef IN_MMAP
+// a mapped input is scanned in place, the token is returned as a
+// pointer into the mapping and a length, nothing is copied.
+Str_t str_mapslice( Input_t *input, Wrd_t *len )
+{
+  register uByt_t *p, *end, c ;
+  uByt_t *start = NULL ;
+
+  found_eol = (Byt_t) 0 ; 
+  p = (uByt_t *) input->map + input->map_this ;
+  end = (uByt_t *) input->map + input->map_size ;
+  while( p < end )
+  {
+    c = ch_class[ *p++ ] ;
+    if( !(c & cc_White) )
+    {
+      if( isNul( start ) )
+        start = p - 1 ;
+      continue ;
+    }
+
+    if( c & cc_Eol )
+    {
+      input->in_line++ ;
+      found_eol = (Byt_t) p[-1] ;
+    }
+
+    if( !isNul( start ) )
+    {
+      input->map_this = (Str_t) p - input->map ;
+      *len = (p - 1) - start ;
+      return (Str_t) start ;
+    }
+
+    if( found_eol )
+    {
+      input->map_this = (Str_t) p - input->map ;
+      *len = 0 ;
+      return (Str_t) NULL ;
+    }
+  }
+
+  input->map_this = input->map_size ;
+  if( !isNul( start ) )		// last token, no newline ...
+  {
+    *len = end - start ;
+    return (Str_t) start ;
+  }
+  *len = str_length( inEOF ) ;
+  return inEOF ;
+}
+#endif
+
+// the next token from the input as a slice, (ptr, len) ... a NULL
+// ptr is an empty token at the end of a line.
+Str_t str_slice( Input_t *input, Wrd_t *len )
 {
+  Str_t tkn_back ;
   int tkn = 0 ;
   Byt_t this_char ;
-  static Byt_t acc[sz_INBUF] ;
+  uByt_t cc ;
+
+  if( !isNul( in_Back ) )	// the rest of a token, see read_cells()
+  {
+    tkn_back = in_Back ;
+    in_Back = (Str_t) NULL ;
+    *len = in_BackLen ;
+    return tkn_back ;
+  }
+#ifdef IN_MMAP
+  if( !isNul( input->map ) )
+  {
+    return str_mapslice( input, len ) ;
+  }
+#endif
 
   found_eol = (Byt_t) 0 ; 
   do {
@@ -1120,10 +2542,12 @@ Str_t str_token( Input_t *input )
 		{
 			prompt() ;
 			str_set( input->bytes, 0, sz_INBUF ) ;
+			io_wait( INPUT, -1 ) ;
 			input->bytes_read = inp( INPUT, input->bytes, sz_INBUF ) ;
 			if( input->bytes_read == 0 )
 			{
 				input->bytes[0] = (Byt_t) 0 ; 
+				*len = str_length( inEOF ) ;
 				return inEOF ;
 			}
 			input->bytes_this = 0 ; 
@@ -1139,16 +2563,20 @@ Str_t str_token( Input_t *input )
 
 		// accumulate printing characters in the accumulater for the next token ...
 		this_char = input->bytes[input->bytes_this++] ;
+		cc = ch_class[ (uByt_t) this_char ] ;
 
-		if( !ch_matches( this_char, WHITE_SPACE ) )
+		if( !(cc & cc_White) )
 		{
-			acc[tkn++] = this_char ;
-			acc[tkn] = (Byt_t) 0 ; 
+			if( tkn < sz_INBUF )
+			{
+				in_acc[tkn] = this_char ;
+			}
+			tkn++ ;
 			continue ; 
 		}
 
 	  	// errors and comments require eol, so flag it in a global.
-		if( ch_matches( this_char, EOL ) )
+		if( cc & cc_Eol )
 		{
 			input->in_line++ ;
 			found_eol = this_char ;
@@ -1157,62 +2585,182 @@ Str_t str_token( Input_t *input )
 		// have a token, return the accumulator ...
 		if( tkn > 0 )
 		{
-			return (Str_t) acc ;
+			if( tkn > sz_INBUF )
+			{
+				throw( err_TknSize ) ;
+				catch() ;
+				tkn = sz_INBUF ;
+			}
+			in_acc[tkn] = (Byt_t) 0 ; 
+			*len = tkn ;
+			return (Str_t) in_acc ;
 		}
 
 		// null tokens are simply ignored ... 
 		if( found_eol )
 		{
+			*len = 0 ;
 			return (Str_t) NULL ;
 		}
 
   } while( 1 ) ;
 }
 
-Wrd_t str_match( Str_t a, Str_t b, Wrd_t len )
+// ... and as a NUL terminated string for the words that parse
+// their own input (word, create, tick and friends).
+Str_t str_token( Input_t *input )
 {
-  int8_t i ;
+  Str_t tkn ;
+  Wrd_t len ;
 
-  if( (str_length( a ) == len) && (str_length( b ) == len) ){
-    for( i = 0 ; i < len ; i++ ){
-      if( a[i] != b[i] ){
-        return 0 ;
-      }
-    }
-    return 1 ;
+  tkn = str_slice( input, &len ) ;
+  if( isNul( tkn ) || tkn == (Str_t) in_acc || tkn == (Str_t) inEOF )
+  {
+    return tkn ;
   }
-  return 0 ;
+  if( len > sz_INBUF )
+  {
+    throw( err_TknSize ) ;
+    catch() ;
+    len = sz_INBUF ;
+  }
+  str_copy( (Str_t) in_acc, tkn, len ) ;
+  in_acc[len] = (Byt_t) 0 ;
+  return (Str_t) in_acc ;
+}
+
+Wrd_t str_match( Str_t a, Str_t b, Wrd_t len )
+{
+  // both lengths first, str_cmp() reads whole cells of each
+  return str_length( a ) == len && str_length( b ) == len && str_cmp( a, b, len ) == 0 ;
 }
 
 Wrd_t str_length( Str_t str )
 {
   Str_t  p ; 
-  Wrd_t ret = 0 ;
 
   if( isNul( str ) ){
     return 0 ;
   }
 
   p = str ;
-  while( *p++ ) ret++ ;
-  return ret ; 
+#ifdef WIDE
+  while( ((uCell_t) p & CELL_MASK) && *p ) p++ ;
+  if( *p ){	// an aligned word never crosses into the next page
+    while( !has_zero( *(aCell_t *) p ) ) p += sizeof( uCell_t ) ;
+  }
+#endif
+  while( *p ) p++ ;
+  return p - str ; 
+}
+
+// -1, 0 or 1 as the first len bytes of a sort before, with or after b
+Wrd_t str_cmp( Str_t a, Str_t b, Wrd_t len )
+{
+  Wrd_t i = 0 ;
+
+#ifdef WIDE
+  while( i + (Wrd_t) sizeof( uCell_t ) <= len && *(uaCell_t *) (a + i) == *(uaCell_t *) (b + i) ){
+    i += sizeof( uCell_t ) ;
+  }
+#endif
+  for( ; i < len ; i++ ){
+    if( a[i] != b[i] ){
+      return ((uByt_t) a[i] < (uByt_t) b[i]) ? -1 : 1 ;
+    }
+  }
+  return 0 ;
+}
+
+// the first ch in len bytes at p (or with skip, the first that isn't),
+// p + len if there is none ...
+Str_t str_scan( Str_t p, Wrd_t len, Byt_t ch, Wrd_t skip )
+{
+  Str_t end = p + len ;
+#ifdef WIDE
+  uCell_t pat = CELL_ONES * (uByt_t) ch, x ;
+
+  while( p < end && ((uCell_t) p & CELL_MASK) ){
+    if( (*p == ch) != skip ){
+      return p ;
+    }
+    p++ ;
+  }
+  for( ; end - p >= (Wrd_t) sizeof( uCell_t ) ; p += sizeof( uCell_t ) ){
+    x = *(aCell_t *) p ^ pat ;
+    if( skip ? (x != 0) : (has_zero( x ) != 0) ){
+      break ;
+    }
+  }
+#endif
+  for( ; p < end ; p++ ){
+    if( (*p == ch) != skip ){
+      return p ;
+    }
+  }
+  return end ;
+}
+
+// str_copy() for any overlap ...
+void str_move( Str_t dst, Str_t src, Wrd_t len )
+{
+  Str_t d, s ;
+
+  if( dst <= src || dst >= src + len ){
+    str_copy( dst, src, len ) ;
+    return ;
+  }
+  d = dst + len ;
+  s = src + len ;
+#ifdef WIDE
+  while( d > dst && ((uCell_t) d & CELL_MASK) ) *--d = *--s ;
+  while( d - dst >= (Wrd_t) sizeof( uCell_t ) ){
+    d -= sizeof( uCell_t ) ;
+    s -= sizeof( uCell_t ) ;
+    *(aCell_t *) d = *(uaCell_t *) s ;
+  }
+#endif
+  while( d > dst ) *--d = *--s ;
 }
 
 Wrd_t str_literal( Str_t tkn, Wrd_t radix )
 {
-  Wrd_t  ret, sign, digit, base ;
-  Str_t p ;
+  return str_nliteral( tkn, str_length( tkn ), radix ) ;
+}
 
-  if( radix > str_length( digits ) ){
-    put_str( tkn ) ;
+Wrd_t str_nliteral( Str_t tkn, Wrd_t len, Wrd_t radix )
+{
+  Cell_t ret ;
+  Str_t bad ;
+
+  if( radix > n_DIGITS ){
+    outp( OUTPUT, tkn, len ) ;
+    outp( OUTPUT, " ", 1 ) ;
     throw( err_BadBase ) ;
     return -1 ;
   }
+  bad = str_number( tkn, len, radix, &ret ) ;
+  if( !isNul( bad ) ){
+    outp( OUTPUT, "-- ", 3 ) ;
+    outp( OUTPUT, tkn, len ) ;
+    fmt_out( " digit: '%c'\n", *bad ) ;
+    throw( err_BadLiteral ) ;
+    return -1 ;
+  }
+  return ret ;
+}
+
+// the value of len chars at tkn in radix, or where it went wrong ...
+Str_t str_number( Str_t tkn, Wrd_t len, Wrd_t radix, Cell_t *val )
+{
+  Wrd_t  ret, sign, digit, base ;
+  Str_t p, end ;
 
   sign = 1 ;
   base = radix ;
   p = tkn ; 
-  switch( *p++ ){
+  end = tkn + len ;
+  switch( (len > 0) ? *p++ : 0 ){
     case '-': /* negative */
      sign = -1 ;
      break ;
@@ -1224,7 +2772,7 @@ Wrd_t str_literal( Str_t tkn, Wrd_t radix )
      break ;
     case '0': /* octal or hex constant */
      base = 8 ;
-     if( *p == 'x' || *p == 'X' ){
+     if( p < end && (*p == 'x' || *p == 'X') ){
       base = 16 ;
       p++ ;
      }
@@ -1235,112 +2783,116 @@ Wrd_t str_literal( Str_t tkn, Wrd_t radix )
    }
 
    ret = 0 ; 
-   while( *p ){
-     digit = ch_index( digits, ch_tolower( *p++ ) ) ;
+   while( p < end && *p ){
+     digit = ch_digit[ (uByt_t) *p++ ] - 1 ;
      if( digit < 0 || digit > (base - 1) ){
-       fmt_out( "-- %s digit: '%x'\n", tkn, digit ) ;
-       throw( err_BadLiteral ) ;
-       return -1 ;
+       return p - 1 ;
      }
      ret *= base ; 
      ret += digit ;
    }
-   ret *= sign ;
-   return ret ;
+   *val = ret * sign ;
+   return (Str_t) NULL ;
 }
 
 void str_set( Str_t dst, Byt_t dat, Wrd_t len )
 {
-  Str_t ptr ;
+  Str_t end = dst + len ;
+#ifdef WIDE
+  uCell_t pat = CELL_ONES * (uByt_t) dat ;
 
-  for( ptr = dst ; ptr - dst < len ; ptr++ ){
-    *ptr = (Byt_t) dat & 0xff ;
-  } 
+  while( dst < end && ((uCell_t) dst & CELL_MASK) ) *dst++ = dat ;
+  for( ; end - dst >= (Wrd_t) sizeof( uCell_t ) ; dst += sizeof( uCell_t ) ){
+    *(aCell_t *) dst = pat ;
+  }
+#endif
+  while( dst < end ) *dst++ = dat ;
 }
 
+// low to high, as cmove has it, so a copy just above its source
+// smears the first bytes along ... a cell at a time where that gives
+// the same result, i.e. unless dst is less than a cell past src.
 Wrd_t str_copy( Str_t dst, Str_t src, Wrd_t len )
 {
-  Wrd_t i ;
-  Str_t from, to ; 
+  Str_t end = dst + len ;
 
-  to = dst ;
-  from = src ;
-  for( i = 0 ; i < len ; i++ ){
-    *to++ = *from++ ;
+#ifdef WIDE
+  if( dst <= src || dst - src >= (Wrd_t) sizeof( uCell_t ) ){
+    while( dst < end && ((uCell_t) dst & CELL_MASK) ) *dst++ = *src++ ;
+    for( ; end - dst >= (Wrd_t) sizeof( uCell_t ) ; dst += sizeof( uCell_t ), src += sizeof( uCell_t ) ){
+      *(aCell_t *) dst = *(uaCell_t *) src ;
+    }
   }
-  return i ;
+#endif
+  while( dst < end ) *dst++ = *src++ ;
+  return (len > 0) ? len : 0 ;
 }
 
-Wrd_t str_utoa( uByt_t *dst, Wrd_t dlen, Cell_t val, Wrd_t radix )
+// the digits of n in radix, written back from p, two at a time in
+// decimal and by shifts for powers of two ... returns the first.
+uByt_t *str_digits( uByt_t *p, uCell_t n, uCell_t radix )
 {
+  uCell_t q, shift ;
 
-  uCell_t n, i, dig ;
-  uByt_t *p, *q, buf[30] ;
-
-  i = 0 ; 
-  n = val ;
-  do{
-    dig = (n % radix) + '0' ;
-    dig = (dig > '9') ? dig - '9' + 'a' - 1 : dig ; 
-    buf[i++] = dig ;
-    n /= radix ;
-  } while( n != 0 ) ;
-  buf[i] = (Byt_t) 0 ; 
-
-  n = 0 ; 
-  p = dst ;
-  q = &buf[i] ;
-  do {
-    if( n > dlen ){
-      throw( err_BufOvr ) ;
-      return -1 ;
+  if( radix < 2 || radix > n_DIGITS ){
+    radix = 10 ;
+  }
+  if( radix == 10 ){
+    for( ; n >= 100 ; n = q ){
+      q = n / 100 ;
+      p -= 2 ;
+      p[0] = dec_pairs[ 2 * (n - q * 100) ] ;
+      p[1] = dec_pairs[ 2 * (n - q * 100) + 1 ] ;
+    }
+    if( n >= 10 ){
+      p -= 2 ;
+      p[0] = dec_pairs[ 2 * n ] ;
+      p[1] = dec_pairs[ 2 * n + 1 ] ;
+      return p ;
     }
-    *p++ = *q-- ; n++ ;
-  } while( q >= &buf[0] ); 
-  *p++ = (Byt_t) 0 ; 
+    *--p = '0' + n ;
+    return p ;
+  }
+  if( (radix & (radix - 1)) == 0 ){
+    for( shift = 0 ; ((uCell_t) 1 << shift) < radix ; shift++ ) ;
+    do {
+      *--p = digits[ n & (radix - 1) ] ;
+      n >>= shift ;
+    } while( n != 0 ) ;
+    return p ;
+  }
+  do {
+    q = n / radix ;
+    *--p = digits[ n - q * radix ] ;
+    n = q ;
+  } while( n != 0 ) ;
+  return p ;
+}
 
-  return n ;
+Wrd_t str_utoa( uByt_t *dst, Wrd_t dlen, Cell_t val, Wrd_t radix )
+{
+  return str_ntoa( (Str_t) dst, dlen, val, radix, 0 ) ;
 }
+
 Wrd_t str_ntoa( Str_t dst, Wrd_t dlen, Cell_t val, Wrd_t radix, Wrd_t isSigned )
 {
-  Wrd_t i, sign, n ;
-  Byt_t c, buf[30] ;
-  Str_t p ;
+  uByt_t buf[ 8 * sizeof( Cell_t ) + 2 ], *end, *p ;
+  Wrd_t n ;
 
-  n = val ;
-  sign = (Byt_t) 0 ;  
+  end = &buf[ sizeof( buf ) ] ;
   if( isSigned && val < 0 ){
-    sign = '-' ;
-    n = -1 * n ;
+    p = str_digits( end, -(uCell_t) val, radix ) ;
+    *--p = '-' ;
+  } else {
+    p = str_digits( end, (uCell_t) val, radix ) ;
   }
-
-  i = 0 ; 
-  do {
-   c = '0' + (n % radix) ;
-   c = (c > '9') ? c - '9' + 'a' - 1 : c ; 
-   buf[i++] = c ;
-   n /= radix ;
-  } while( n != 0 ) ;
-
-  buf[ i ] = ' ' ;
-  if( sign ){
-    buf[i] = sign ;
-  } 
-
-  if( i > dlen ){
+  n = end - p ;
+  if( n > dlen ){
     throw( err_BufOvr ) ;
     return -1 ;
   }
-
-  if( !sign ){
-    i-- ;
-  } 
-  n = i + 1 ;
-  p = dst ;
-  do {
-    *p++ = buf[i--] ;
-  } while( i > -1 ) ;
-  *p++ = (Byt_t) 0 ; 
+  str_copy( dst, (Str_t) p, n ) ;
+  dst[ n ] = (Byt_t) 0 ; 
   return n ;
 } 
 
@@ -1443,35 +2995,100 @@ Str_t str_seal( void )
   return (Str_t) String_Data ;
 }
 
-Dict_t *lookup( Str_t tkn )
+uWrd_t str_hash( Str_t str, Wrd_t len )
+{
+  uWrd_t h = 5381 ;
+  uByt_t *p, *end ;
+
+  end = (uByt_t *) str + len ;
+  for( p = (uByt_t *) str ; p < end ; p++ ){
+    h = ((h << 5) + h) ^ *p ;
+  }
+  return h & (sz_HASH - 1) ;
+}
+
+void dict_index( Dict_t *dp )
 {
+  uWrd_t h ;
+
+  h = str_hash( dp ->nfa, str_length( dp ->nfa ) ) ;
+  dp ->lnk = Dict_Hash[ h ] ;
+  Dict_Hash[ h ] = dp ;
+}
+
+void dict_unindex( Dict_t *dp )
+{
+  Dict_t **pp ;
+
+  for( pp = &Dict_Hash[ str_hash( dp ->nfa, str_length( dp ->nfa ) ) ] ; !isNul( *pp ) ; pp = &(*pp) ->lnk ){
+    if( *pp == dp ){
+      *pp = dp ->lnk ;
+      break ;
+    }
+  }
+  dp ->lnk = (Dict_t *) NULL ;
+}
+
+// index the primitives once for every VM ... they go in last to
+// first so the first of any duplicates is found.
+void dict_init( void )
+{
+  static Cell_t done = 0 ;
   Dict_t *p ;
+  uWrd_t  h ;
+
+  if( done++ ){
+    return ;
+  }
+  for( p = StartOf( Primitives ) ; p ->nfa ; p++ ) ;
+  while( p-- > StartOf( Primitives ) ){
+    p ->op = vm_opcode( p ->cfa ) ;
+    stk_prim( p ) ;
+    h = str_hash( p ->nfa, str_length( p ->nfa ) ) ;
+    p ->lnk = Prim_Hash[ h ] ;
+    Prim_Hash[ h ] = p ;
+  }
+}
+
+// rebuild the index from scratch (see forget()) ... the primitives,
+// or the dictionary this one shares, then the colon defs oldest to
+// newest.
+void dict_rehash( void )
+{
   Cell_t  i ;
 
+  str_copy( (Str_t) Dict_Hash, (Str_t) Dict_Base, sizeof( Dict_Hash ) ) ;
+
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    dict_index( &Colon_Defs[ i ] ) ;
+  }
+}
+
+Dict_t *lookup( Str_t tkn )
+{
+  return lookup_len( tkn, str_length( tkn ) ) ;
+}
+
+Dict_t *lookup_len( Str_t tkn, Wrd_t len )
+{
+  Dict_t *p ;
+  Str_t   a, b, end ;
+
   if( !isNul( tkn ) )
   {
-    if( n_ColonDefs > 0 )
+    end = tkn + len ;
+    for( p = Dict_Hash[ str_hash( tkn, len ) ] ; !isNul( p ) ; p = p ->lnk )
     {
-      for( i = n_ColonDefs - 1 ; i > -1 ; i-- )
+      a = tkn ;
+      b = p ->nfa ;
+      while( a < end && *a == *b ){
+        a++ ; b++ ;
+      }
+      if( a == end && *b == (Byt_t) 0 )
       {
-        p = &Colon_Defs[ i ] ;
-        if( isMatch( tkn, p ->nfa ) )
-        {
-          return p ;
-        }
+        return p ;
       }
     }
-
-    p = StartOf( Primitives ) ;
-    while( p ->nfa )
-    {
-       if( isMatch( tkn, p ->nfa ) )
-       {
-         return p ;
-       }
-       p++ ;
-    }
-
   }
   return (Dict_t *) NULL ;
 
@@ -1486,9 +3103,6 @@ Dict_t *lookup( Str_t tkn )
 
 void quit()
 {
-  Str_t tkn ;
-  Dict_t *dp ;
-
 #ifdef HOSTED
   Wrd_t beenhere = 0, n ;
   beenhere = setjmp( env ) ;
@@ -1500,19 +3114,30 @@ void quit()
   }
 #endif
   for(;;){ // *outer loop*
-    while( (tkn = str_token( &InputStack[in_This] )) ){
-      dp = lookup( tkn );
-      if( isNul( dp ) ){
-        push( str_literal( tkn, Base ) ) ;
-      } else {
-        push( (Cell_t) dp ) ; 
-        execute() ;
-      }
-      catch() ;
-    } // *tkn*
+    q_token() ;
   } // *ever*
 } // *quit*
 
+// interpret the next token of the input, for quit() and off_eval()
+void q_token()
+{
+  Str_t tkn ;
+  Wrd_t len ;
+  Dict_t *dp ;
+
+  if( (tkn = str_slice( &InputStack[in_This], &len )) ){
+    dp = lookup_len( tkn, len );
+    if( isNul( dp ) ){
+      push( str_nliteral( tkn, len, Base ) ) ;
+    } else {
+      push( (Cell_t) dp ) ; 
+      execute() ;
+    }
+    catch() ;
+    tm_Safe() ;
+  }
+}
+
 void banner()
 {
   Wrd_t UNUSED( n );
@@ -1536,6 +3161,7 @@ void prompt()
 {
   if( INPUT == 0 ){
     outp( OUTPUT, (Str_t) promptStr[promptVal], 3 ) ;
+    out_flushall() ;
   }
 }
 
@@ -1697,7 +3323,7 @@ Wrd_t checkstack( Wrd_t n, Str_t fun )
   Wrd_t UNUSED( x ), d ;
 
   if( n > 0 ) {
-    depth(); d = pop() ;
+    d = tos - StartOf( stack ) ;
     if( d < n ){
       x = fmt_out( "-- Found %d of %d args expected in '%s'.\n", d, n, fun ) ; 
       throw( err_StackUdr ) ;
@@ -1714,11 +3340,13 @@ Wrd_t checkstack( Wrd_t n, Str_t fun )
     return 0 ;
   }
 
+#ifndef ARENA // the guard page above the stack catches this
   if( tos > &stack[sz_STACK] ){
     put_str( fun ) ; 
     throw( err_StackOvr ) ;
     return 0 ;
   }
+#endif
   return 1 ;
 }
 
@@ -1740,11 +3368,13 @@ void fwd_resolve()
 
   p = (Cell_t *) pop() ;
   *p = (Cell_t) Here ;
+  peep_barrier() ;
 }
 
 void bkw_mark()
 {
   push( (Cell_t) Here ) ;
+  peep_barrier() ;
 }
 
 void bkw_resolve()
@@ -1759,23 +3389,20 @@ void  begin()
   
 void  again()
 {
-  push( (Cell_t) lookup( "branch" ) ) ;
-  comma() ;
+  emit_op( lookup( "branch" ) ) ;
   bkw_resolve();
 }
 
 void  While()
 {
-  push( (Cell_t) lookup( "?branch" ) );
-  comma() ;
+  emit_op( lookup( "?branch" ) ) ;
   fwd_mark();
   swap();
 }
 
 void  Repeat()
 {
-  push( (Cell_t) lookup( "branch" ) );
-  comma() ;
+  emit_op( lookup( "branch" ) ) ;
   bkw_resolve();
   fwd_resolve();
 }
@@ -1788,22 +3415,19 @@ void  Leave()
 
 void  Until()
 {
-  push( (Cell_t) lookup( "?branch" ) );
-  comma() ;
+  emit_op( lookup( "?branch" ) ) ;
   bkw_resolve() ;
 }
 
 void  If()
 {
-  push( (Cell_t) lookup( "?branch" ) ) ;
-  comma() ;
+  emit_op( lookup( "?branch" ) ) ;
   fwd_mark() ;
 }
 
 void Else()
 {
-  push( (Cell_t) lookup( "branch" ) ) ;
-  comma();
+  emit_op( lookup( "branch" ) ) ;
   fwd_mark() ;
   swap() ;
   fwd_resolve() ;
@@ -1915,6 +3539,7 @@ void q_branch()
 {
   Cell_t *ptr ;
 
+  tm_Safe() ;
   ptr = (Cell_t *) rpop() ;		// grab next word pointer
   if( pop() ){					// if .T. skip current pointer for next (?branch)
     rpush( (Cell_t) ++ptr ) ;
@@ -1927,13 +3552,34 @@ void branch()
 {
   Cell_t *x ;
 
+  tm_Safe() ;
   x = (Cell_t *) rpop() ;		// always branch to next ... 
   rpush( *x ) ;
 }
 
-void rdepth()
+// a colon word called last is entered in the caller's frame, see
+// semicolon() ...
+void tail()
 {
-  Cell_t d ;
+  Cell_t *x ;
+
+  tm_Safe() ;
+  x = (Cell_t *) rpop() ;
+  rpush( (Cell_t) ((Dict_t *) *x) ->pfa ) ;
+}
+
+void recurse()
+{
+  if( state != state_Compiling ){
+    throw( err_BadState ) ;
+    return ;
+  }
+  emit_op( &Colon_Defs[n_ColonDefs-1] ) ;
+}
+
+void rdepth()
+{
+  Cell_t d ;
 
   d = rtos - StartOf( rstack ) ;
   push( d ) ; 
@@ -2057,17 +3703,29 @@ void Eof()
 #ifdef HOSTED
   if( in_This > 0 )
   {
-    close( INPUT ) ;
-    INPUT = -1 ;
-    in_This-- ;
+    in_pop() ;
     if( !isNul( in_Word ) && do_x_Once )
     {
       do_x_Once = 0 ; 
       push( (Cell_t) lookup( in_Word ) ) ;
       execute() ;
     }
+#ifdef EVENTS
+    if( in_This == 0 && !isNul( in_Serve ) && srv_Fd < 0 )
+    {
+      str_seal() ;
+      srv_run() ;
+    }
+#endif
     return ;
   }
+#ifdef EVENTS
+  if( srv_Fd >= 0 )	// the request is over, see srv_run()
+  {
+    srv_take() ;
+    return ;
+  }
+#endif
   throw( err_NoInput ) ;
   catch() ;
   exit( 0 ) ;
@@ -2076,6 +3734,25 @@ void Eof()
 #endif
 }
 
+#ifdef HOSTED
+void in_pop( void )
+{
+  Input_t *input = &InputStack[ in_This ] ;
+
+  if( input ->file >= 0 )
+  {
+#ifdef IN_MMAP
+    in_unmap( input ) ;
+#endif
+    close( input ->file ) ;
+  }
+  input ->file = -1 ;
+  input ->map = (Str_t) NULL ;
+  blk_Load[ in_This ] = NULL ;
+  in_This-- ;
+}
+#endif
+
 void cells()
 {
   chk( 1 ) ;
@@ -2101,6 +3778,12 @@ void catch()
   Wrd_t UNUSED( sz );
   Input_t *input = &InputStack[ in_This ];
 
+  if( error_code != err_OK ){
+    error_last = error_code ;
+#ifdef STK_TRUST
+    chk_Ok = 0 ;
+#endif
+  }
   switch( error_code ){
     case err_OK:
       return ;
@@ -2159,6 +3842,9 @@ void catch()
   dotS() ; cr() ;
   if( error_code != err_OK && error_code != err_NoInput )
   {
+    if( Trace & trc_Ring ){
+      tr_dump( sz_RINGDUMP ) ;
+    }
     sz = fmt_out( "-- Abnormal Termination.\n" ) ;
   }
 #ifdef HOSTED
@@ -2167,10 +3853,23 @@ void catch()
 
  reset:
   dump() ;
+  if( Trace & trc_Ring ){
+    tr_dump( sz_RINGDUMP ) ;
+  }
+#ifdef IN_MMAP
+  if( !isNul( input->map ) ){
+    in_showline( input ) ;
+  } else
+#endif
   fmt_out( "-- Last input: %s\n", input->bytes) ; 
   q_reset() ;
-  sz = fmt_out( "-- Remaining input flushed.\n" ) ;
-  flushtoeol();
+#ifdef TASKS
+  if( task_This == 0 )
+#endif
+  {
+    sz = fmt_out( "-- Remaining input flushed.\n" ) ;
+    flushtoeol();
+  }
   sz = fmt_out( "-- Attempting Reset.\n" ) ;
 #ifdef HOSTED
   longjmp( env, rst_catch );
@@ -2340,9 +4039,7 @@ void quote()
   push( (Cell_t) str_delimited( "\"" ) ) ;
   if( state == state_Compiling ){
     ssave() ;
-    push( (Cell_t) lookup( "(literal)" ) ) ;
-    comma() ; 
-    comma() ;
+    emit_lit( pop() ) ;
   }
 
 }
@@ -2351,8 +4048,7 @@ void dotquote()
 {
   quote() ;
   if( state == state_Compiling ){
-    push( (Cell_t) lookup( "type" ) ) ;
-    comma() ; 
+    emit_op( lookup( "type" ) ) ;
     return ;
   }
   type() ;
@@ -2369,7 +4065,7 @@ void flushtoeol()
   Str_t UNUSED( tkn ) ;
 
   // toss tokens until the end of line is reached ... 
-  do { tkn = str_token( &InputStack[ in_This ] ) ; } while ( ! found_eol ) ;
+  do { tkn = str_token( &InputStack[ in_This ] ) ; } while ( ! found_eol && tkn != (Str_t) inEOF ) ;
 
 }
 
@@ -2481,9 +4177,7 @@ void ascii()
   push( (Cell_t) *p ) ;
   if( state == state_Compiling )
   {
-    push( (Cell_t) lookup( "(literal)" ) ) ;
-    comma() ; 
-    comma();
+    emit_lit( pop() ) ;
   }
 }
 
@@ -2514,7 +4208,9 @@ void key()
   Byt_t ch ;
   Wrd_t nx, x ;
 
+  out_flushall() ;
   while( ! io_cbreak( INPUT ) ) ;	// turn on cbreak ...
+  io_wait( INPUT, -1 ) ;
   nx = inp( INPUT, (Str_t) &ch, 1 ) ;
   while( io_cbreak( INPUT ) ) ; 	// turn off cbreak ...
   if( nx < 1 )
@@ -2619,12 +4315,253 @@ void pushPfa()
   push( rpop() ) ;
 }
 
+/*
+  -- superinstructions --
+
+  compile() and the control words lay threads down through emit_op()
+  and emit_lit(), which remember where the previous instruction went.
+  When it and the next one make a pair in the Fusions table, the pair
+  is rewritten in place as a single fused word; the operand cells of
+  the original pair are kept, so a (literal) 5 + becomes (lit+) 5.
+  Branch targets and marks are barriers, nothing is fused across them.
+  The fused words are plain primitives built from the words they
+  replace, so they also run from the classic engine or from execute.
+*/
+
+typedef enum {
+  fz_Lit,		// (literal) n op	-> (litop) n
+  fz_LitBranch,		// (litop) n ?branch	-> (litop?branch) n addr
+  fz_Branch,		// op ?branch		-> (op?branch) addr
+  fz_Var		// var op		-> (varop) var
+} Fuse_t ;
+
+typedef struct {
+  Fptr_t  cfa ;		// the fused word
+  Fptr_t  first ;	// previous instruction
+  Fptr_t  next ;	// instruction being compiled
+  Fuse_t  kind ;
+  Dict_t *dp ;
+  Cell_t  count ;
+} Fusion_t ;
+
+Fusion_t Fusions[] = {
+  { lit_add,		doLiteral,	add,		fz_Lit,		NULL, 0 },
+  { lit_sub,		doLiteral,	subt,		fz_Lit,		NULL, 0 },
+  { lit_eq,		doLiteral,	eq,		fz_Lit,		NULL, 0 },
+  { lit_ne,		doLiteral,	ne,		fz_Lit,		NULL, 0 },
+  { lit_lt,		doLiteral,	lt,		fz_Lit,		NULL, 0 },
+  { lit_gt,		doLiteral,	gt,		fz_Lit,		NULL, 0 },
+  { lit_eq_branch,	lit_eq,		q_branch,	fz_LitBranch,	NULL, 0 },
+  { lit_ne_branch,	lit_ne,		q_branch,	fz_LitBranch,	NULL, 0 },
+  { lit_lt_branch,	lit_lt,		q_branch,	fz_LitBranch,	NULL, 0 },
+  { lit_gt_branch,	lit_gt,		q_branch,	fz_LitBranch,	NULL, 0 },
+  { dup_branch,		dupe,		q_branch,	fz_Branch,	NULL, 0 },
+  { loop_branch,	do_loop,	q_branch,	fz_Branch,	NULL, 0 },
+  { ploop_branch,	do_ploop,	q_branch,	fz_Branch,	NULL, 0 },
+  { var_fetch,		pushPfa,	wrd_fetch,	fz_Var,		NULL, 0 },
+  { var_store,		pushPfa,	wrd_store,	fz_Var,		NULL, 0 },
+  { NULL,		NULL,		NULL,		fz_Lit,		NULL, 0 }
+} ;
+
+void peep_barrier( void )
+{
+  peep_Here = NULL ;
+}
+
+Fusion_t *fuse_find( Fptr_t cfa )
+{
+  Fusion_t *fp ;
+
+  for( fp = Fusions ; !isNul( fp ->cfa ) ; fp++ ){
+    if( fp ->cfa == cfa ){
+      return fp ;
+    }
+  }
+  return NULL ;
+}
+
+Dict_t *fuse_dict( Fusion_t *fp )
+{
+  Wrd_t i ;
+
+  if( isNul( fp ->dp ) ){
+    for( i = 0 ; !isNul( Primitives[i].cfa ) ; i++ ){
+      if( Primitives[i].cfa == fp ->cfa ){
+        fp ->dp = &Primitives[i] ;
+        break ;
+      }
+    }
+  }
+  return fp ->dp ;
+}
+
+void emit_op( Dict_t *dp )
+{
+  Fusion_t *fp ;
+  Dict_t   *prev ;
+  Wrd_t     dist ;
+
+  if( isNul( dp ) ){
+    throw( err_NoWord ) ;
+    return ;
+  }
+  if( Fusion && peep_Here == Here && !isNul( peep_Last ) ){
+    prev = (Dict_t *) *peep_Last ;
+    dist = Here - peep_Last ;
+    for( fp = Fusions ; !isNul( fp ->cfa ) ; fp++ ){
+      if( fp ->next != dp ->cfa || fp ->first != prev ->cfa ){
+        continue ;
+      }
+      switch( fp ->kind ){
+        case fz_Lit:
+        case fz_LitBranch:
+          if( dist != 2 ) continue ;
+          break ;
+        case fz_Branch:
+          if( dist != 1 ) continue ;
+          break ;
+        case fz_Var:
+          if( dist != 1 || isNul( prev ->pfa ) ) continue ;
+          break ;
+      }
+      if( isNul( fuse_dict( fp ) ) ){
+        break ;
+      }
+      *peep_Last = (Cell_t) fp ->dp ;
+      if( fp ->kind == fz_Var ){
+        push( (Cell_t) prev ) ;
+        comma() ;
+      }
+      fp ->count++ ;
+      peep_Here = Here ;
+      return ;
+    }
+  }
+  peep_Last = Here ;
+  push( (Cell_t) dp ) ;
+  comma() ;
+  peep_Here = Here ;
+}
+
+void emit_lit( Cell_t value )
+{
+  emit_op( lookup( "(literal)" ) ) ;
+  push( value ) ;
+  comma() ;
+  peep_Here = Here ;
+}
+
+void lit_add()
+{
+  doLiteral() ; add() ;
+}
+
+void lit_sub()
+{
+  doLiteral() ; subt() ;
+}
+
+void lit_eq()
+{
+  doLiteral() ; eq() ;
+}
+
+void lit_ne()
+{
+  doLiteral() ; ne() ;
+}
+
+void lit_lt()
+{
+  doLiteral() ; lt() ;
+}
+
+void lit_gt()
+{
+  doLiteral() ; gt() ;
+}
+
+void lit_eq_branch()
+{
+  lit_eq() ; q_branch() ;
+}
+
+void lit_ne_branch()
+{
+  lit_ne() ; q_branch() ;
+}
+
+void lit_lt_branch()
+{
+  lit_lt() ; q_branch() ;
+}
+
+void lit_gt_branch()
+{
+  lit_gt() ; q_branch() ;
+}
+
+void dup_branch()
+{
+  dupe() ; q_branch() ;
+}
+
+void loop_branch()
+{
+  do_loop() ; q_branch() ;
+}
+
+void ploop_branch()
+{
+  do_ploop() ; q_branch() ;
+}
+
+void var_fetch()
+{
+  Cell_t *p ;
+
+  p = (Cell_t *) rpop() ;
+  push( (Cell_t) ((Dict_t *) *p) ->pfa ) ;
+  rpush( (Cell_t) ++p ) ;
+  wrd_fetch() ;
+}
+
+void var_store()
+{
+  Cell_t *p ;
+
+  p = (Cell_t *) rpop() ;
+  push( (Cell_t) ((Dict_t *) *p) ->pfa ) ;
+  rpush( (Cell_t) ++p ) ;
+  wrd_store() ;
+}
+
+void fusion()
+{
+  push( (Cell_t) &Fusion );
+}
+
+void fused()
+{
+  Fusion_t *fp ;
+
+  for( fp = Fusions ; !isNul( fp ->cfa ) ; fp++ ){
+    if( fp ->count > 0 && !isNul( fp ->dp ) ){
+      fmt_out( "%d\t%s\n", fp ->count, fp ->dp ->nfa ) ;
+    }
+  }
+}
+
 void does()
 {
   Dict_t *dp ; 
-  Cell_t **p ;
+  Cell_t **p, *pfa, *here ;
+  Fptr_t cfa ;
 
   dp = &Colon_Defs[n_ColonDefs-1] ;
+  cfa = dp ->cfa ;
+  pfa = dp ->pfa ;
+  here = Here ;
   push( (Cell_t) dp ->pfa ) ;
   dp ->pfa = Here ;
   push( (Cell_t) lookup( "(literal)" ) ) ;
@@ -2636,7 +4573,12 @@ void does()
       state = state_Compiling ;
 
     case state_Compiling:
-      compile() ;
+      compile( 0 ) ;
+      if( error_code != err_OK ){	// the word is left as it was
+        dp ->cfa = cfa ;
+        dp ->pfa = pfa ;
+        Here = here ;
+      }
       return ;
 
     case state_Interpret: /* copy the does> behaviour into the new word */
@@ -2686,6 +4628,10 @@ void lambda()
   dp ->nfa = str_cache( tag ) ; // cache tag ..
   dp ->cfa = pushPfa ;		// default behaviour (like variable)
   dp ->pfa = Here ;		// pfa points to current 
+  dp ->op = op_Call ;
+  dp ->jit = NULL ;
+  dp ->eff_in = 0 ;		// not known, see stk_effect()
+  dict_index( dp ) ;		// and make it visible to lookup()
 
 }
 
@@ -2715,48 +4661,55 @@ void colon()
 {
   state = state_Compiling ;
   create();
-  compile() ; 
+  compile( 1 ) ; 
 }
 
-void compile()
+// the body of a definition, up to ;  opened is set when the caller
+// made the entry for it, and an unknown token then takes it away ...
+void compile( Wrd_t opened )
 {
   Dict_t *dp ;
   Str_t   tkn ; 
+  Wrd_t   len ;
   Cell_t *save, value ;
 
   save = Here ;
   dp = &Colon_Defs[n_ColonDefs-1] ;
   dp ->cfa = doColon ;
 
+  peep_barrier() ;
   ++promptVal ;
-  while( (tkn = str_token( &InputStack[ in_This ] )) ){
-    if( isMatch( tkn, ";" ) ){
+  while( (tkn = str_slice( &InputStack[ in_This ], &len )) ){
+    if( len == 1 && tkn[0] == ';' ){
       semicolon() ;
       break ;
     }
-    dp = (Dict_t *) lookup( tkn ) ;
+    dp = (Dict_t *) lookup_len( tkn, len ) ;
     if( !isNul( dp ) ){
-      push( (Cell_t) dp ) ;
       if( state == state_Immediate || dp ->flg == Immediate ){
+        push( (Cell_t) dp ) ;
         execute() ; /* execute */
       } else {
-        comma() ;   /* compile */
+        emit_op( dp ) ;   /* compile */
       }
     } else {
-      value = (Cell_t) str_literal( tkn, Base ) ;
+      value = (Cell_t) str_nliteral( tkn, len, Base ) ;
       if( error_code != err_OK ){
-        str_uncache( (Str_t) String_Data ) ; 
+        if( opened ){
+          dict_unindex( &Colon_Defs[ --n_ColonDefs ] ) ;
+          str_uncache( (Str_t) String_Data ) ; 
+        }
         Here = save ;
         state = state_Interpret ;
         throw( err_BadString ) ;
-        put_str( tkn ) ;
+        outp( OUTPUT, tkn, len ) ;
+        outp( OUTPUT, " ", 1 ) ;
         return ; /* like it never happened */
       }
-      push( value ) ;
       if( state != state_Immediate ){
-        push( (Cell_t) lookup( "(literal)" ) ) ;
-        comma() ;
-        comma() ;
+        emit_lit( value ) ;
+      } else {
+        push( value ) ;
       }
     }
   }
@@ -2798,8 +4751,57 @@ void call()
   push( (*fun)() ) ;
 }
 
+// the ring takes a time stamp, the tsc where there is one, or else
+// nanoseconds, or the count of cells run on NATIVE ...
+uint64_t tr_clock( void )
+{
+#if defined( __GNUC__ ) && defined( __x86_64__ )
+  return __builtin_ia32_rdtsc() ;
+#elif defined( HOSTED ) && !defined( __WIN32__ )
+  struct timespec ts ;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts ) ;
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec ;
+#else
+  return _ops ;
+#endif
+}
+
+// the last n entries, oldest first, with the time since the newest
+void tr_dump( Cell_t n )
+{
+  Trace_t *t ;
+  uint64_t last ;
+  uCell_t i ;
+
+  n = (n < (Cell_t) tr_Next) ? n : (Cell_t) tr_Next ;
+  n = (n < sz_RING) ? n : sz_RING ;
+  if( n < 1 ){
+    return ;
+  }
+  last = tr_Ring[ (tr_Next - 1) & (sz_RING - 1) ].tr_clock ;
+  fmt_out( "-- Trace ring: ago\tdepth\ttop\tword\n" ) ;
+  for( i = tr_Next - n ; i != tr_Next ; i++ ){
+    t = &tr_Ring[ i & (sz_RING - 1) ] ;
+    fmt_out( "  -- %u\t%d\t%x\t%s\n", (uCell_t) (last - t ->tr_clock), t ->tr_depth, t ->tr_top,
+      isNul( t ->tr_dp ) ? "next" : t ->tr_dp ->nfa ) ;
+  }
+}
+
 void tracing( Dict_t *dp )
 {
+  Trace_t *t ;
+
+  if( Trace & trc_Ring ){
+    t = &tr_Ring[ tr_Next++ & (sz_RING - 1) ] ;
+    t ->tr_dp = dp ;
+    t ->tr_depth = tos - StartOf( stack ) ;
+    t ->tr_top = *tos ;
+    t ->tr_clock = tr_clock() ;
+  }
+  if( !(Trace & trc_Print) ){
+    return ;
+  }
 
   dotS() ;
   put_str( "\t\t" ) ;
@@ -2812,28 +4814,320 @@ void tracing( Dict_t *dp )
   cr() ;
 }
 
+/*
+  -- stack effects --
+
+  every primitive in stk_tab takes and leaves a known number of cells,
+  and ; works out the same for the word just compiled, through
+  straight line code, branches and loops, as long as each place in it
+  is reached with the one depth.  A word that calls anything without
+  an effect (execute, does>, a native, itself ...) has none.
+
+  In a checked build a word with an effect has its depth checked once
+  on the way in (see stk_enter()), and while it runs chk() trusts it;
+  the words it calls have effects too, so nothing below it needs a
+  check.  execute() decides afresh for whatever it runs, so a timer or
+  event callback met inside a trusted word is checked as usual, and
+  puts the caller's flag back after.  A task switch restores it and
+  catch() drops it.  The classic engine runs every cell through
+  execute(), where the flag costs more than the checks it saves, so
+  there each word still checks its own.
+*/
+struct {
+  Fptr_t cfa ;
+  uByt_t in ;
+  uByt_t out ;
+} stk_tab[] = {
+  { add,	2, 1 },
+  { subt,	2, 1 },
+  { mult,	2, 1 },
+  { exponent,	2, 1 },
+  { divide,	2, 1 },
+  { modulo,	2, 1 },
+  { absolute,	1, 1 },
+  { dot,	1, 0 },
+  { udot,	1, 0 },
+  { depth,	0, 1 },
+  { rdepth,	0, 1 },
+  { dupe,	1, 2 },
+  { rot,	3, 3 },
+  { nip,	2, 1 },
+  { tuck,	2, 3 },
+  { drop,	1, 0 },
+  { over,	2, 3 },
+  { swap,	2, 2 },
+  { toR,	1, 0 },
+  { Rto,	0, 1 },
+  { cells,	1, 1 },
+  { cellsize,	0, 1 },
+  { wrd_fetch,	1, 1 },
+  { wrd_store,	2, 0 },
+  { reg_fetch,	2, 2 },
+  { reg_store,	2, 0 },
+  { crg_fetch,	1, 1 },
+  { crg_store,	2, 0 },
+  { hlf_fetch,	1, 1 },
+  { hlf_store,	2, 0 },
+  { byt_fetch,	1, 1 },
+  { byt_store,	2, 0 },
+  { lft_shift,	2, 1 },
+  { rgt_shift,	2, 1 },
+  { cmove,	3, 0 },
+  { emit,	1, 0 },
+  { type,	1, 0 },
+  { cr,		0, 0 },
+  { dp,		0, 1 },
+  { stringptr,	0, 1 },
+  { flashsize,	0, 1 },
+  { flashptr,	0, 1 },
+  { here,	0, 1 },
+  { freespace,	0, 1 },
+  { comma,	1, 0 },
+  { doLiteral,	0, 1 },
+  { lit_add,	1, 1 },
+  { lit_sub,	1, 1 },
+  { lit_eq,	1, 1 },
+  { lit_ne,	1, 1 },
+  { lit_lt,	1, 1 },
+  { lit_gt,	1, 1 },
+  { lit_eq_branch,	1, 0 },
+  { lit_ne_branch,	1, 0 },
+  { lit_lt_branch,	1, 0 },
+  { lit_gt_branch,	1, 0 },
+  { dup_branch,	1, 1 },
+  { loop_branch,	0, 0 },
+  { ploop_branch,	1, 0 },
+  { var_fetch,	0, 1 },
+  { var_store,	1, 0 },
+  { q_branch,	1, 0 },
+  { branch,	0, 0 },
+  { Leave,	0, 0 },
+  { lt,		2, 1 },
+  { gt,		2, 1 },
+  { ge,		2, 1 },
+  { le,		2, 1 },
+  { eq,		2, 1 },
+  { ne,		2, 1 },
+  { And,	2, 1 },
+  { and,	2, 1 },
+  { or,		2, 1 },
+  { xor,	2, 1 },
+  { not,	1, 1 },
+  { plusplus,	1, 1 },
+  { minusminus,	1, 1 },
+  { do_do,	2, 0 },
+  { do_I,	0, 1 },
+  { do_loop,	0, 1 },
+  { do_ploop,	1, 1 },
+  { NULL,	0, 0 }
+} ;
+
+void stk_prim( Dict_t *dp )
+{
+  Wrd_t i ;
+
+  dp ->eff_in = 0 ;
+  for( i = 0 ; !isNul( stk_tab[i].cfa ) ; i++ ){
+    if( stk_tab[i].cfa == dp ->cfa ){
+      dp ->eff_in = stk_tab[i].in + 1 ;
+      dp ->eff_out = stk_tab[i].out ;
+      return ;
+    }
+  }
+}
+
+// a word in a thread, if stk_effect() can see what it does
+Dict_t *stk_word( Cell_t c )
+{
+  Byt_t *p = (Byt_t *) c ;
+  Dict_t *dp = (Dict_t *) c ;
+
+  if( p >= (Byt_t *) Primitives && p < (Byt_t *) &Primitives[ n_Primitives ] &&
+      (p - (Byt_t *) Primitives) % sizeof( Dict_t ) == 0 ){
+    return eff_Known( dp ) ? dp : NULL ;
+  }
+  if( p >= (Byt_t *) Colon_Defs && p < (Byt_t *) &Colon_Defs[ n_ColonDefs ] &&
+      (p - (Byt_t *) Colon_Defs) % sizeof( Dict_t ) == 0 ){
+    if( dp ->cfa == pushPfa || dp ->cfa == doConstant ){
+      return dp ;
+    }
+#ifdef TOKENS
+    if( dp ->cfa == doTokens ){
+      return eff_Known( dp ) ? dp : NULL ;
+    }
+#endif
+    return (dp ->cfa == doColon && eff_Known( dp )) ? dp : NULL ;
+  }
+  return NULL ;
+}
+
+// a place in the thread is reached with depth d, which must be the
+// one it had, if any
+Wrd_t stk_reach( int16_t *at, Cell_t k, Cell_t d )
+{
+  if( k < 0 || k > sz_STKMAP ){
+    return 0 ;
+  }
+  if( at[ k ] == stk_None ){
+    at[ k ] = d ;
+  }
+  return at[ k ] == d ;
+}
+
+void stk_effect( Dict_t *wp )
+{
+  int16_t at[ sz_STKMAP + 1 ] ;
+  Cell_t *pfa, *ip, d, need, in, out, k, n ;
+  Dict_t *dp, *cp ;
+  Fusion_t *fp ;
+  Wrd_t live = 1 ;
+
+  wp ->eff_in = 0 ;
+  pfa = wp ->pfa ;
+  if( wp ->cfa != doColon || isNul( pfa ) ){
+    return ;
+  }
+  for( k = 0 ; k <= sz_STKMAP ; k++ ){
+    at[ k ] = stk_None ;
+  }
+  d = need = 0 ;
+  out = stk_None ;
+  for( ip = pfa ; ip < Here ; ip += 1 + n ){
+    k = ip - pfa ;
+    if( k >= sz_STKMAP ){
+      return ;
+    }
+    if( !live ){			// only a branch gets here
+      if( at[ k ] == stk_None ){
+        return ;
+      }
+      d = at[ k ] ;
+    }
+    if( !stk_reach( at, k, d ) ){
+      return ;
+    }
+    live = 1 ;
+    if( *ip == 0 ){			// next
+      if( out != stk_None && out != d ){
+        return ;
+      }
+      out = d ;
+      break ;
+    }
+    dp = (Dict_t *) *ip ;
+    fp = fuse_find( dp ->cfa ) ;
+    n = 0 ;
+    cp = dp ;
+    if( dp ->cfa == tail ){		// the word it runs
+      n = 1 ;
+      cp = (ip[1] == (Cell_t) wp) ? NULL : stk_word( ip[1] ) ;
+    } else if( !isNul( fp ) ){
+      n = (fp ->kind == fz_LitBranch) ? 2 : 1 ;
+    } else if( dp ->cfa == doLiteral || dp ->cfa == branch || dp ->cfa == q_branch ){
+      n = 1 ;
+    }
+    if( isNul( cp ) || isNul( stk_word( (Cell_t) cp ) ) ){
+      return ;
+    }
+    in = (cp ->cfa == pushPfa || cp ->cfa == doConstant) ? 0 : eff_In( cp ) ;
+    if( in - d > need ){
+      need = in - d ;
+    }
+    d += ((cp ->cfa == pushPfa || cp ->cfa == doConstant) ? 1 : eff_Out( cp )) - in ;
+    if( dp ->cfa == branch || dp ->cfa == q_branch || (!isNul( fp ) && (fp ->kind == fz_Branch || fp ->kind == fz_LitBranch)) ){
+      if( !stk_reach( at, (Cell_t *) ip[ n ] - pfa, d ) ){
+        return ;
+      }
+      live = (dp ->cfa != branch) ;
+    }
+    if( dp ->cfa == Leave ){		// leaves the word
+      if( out != stk_None && out != d ){
+        return ;
+      }
+      out = d ;
+      live = 0 ;
+    }
+  }
+  if( out == stk_None || need > 254 || need + out > 255 ){
+    return ;
+  }
+  wp ->eff_in = need + 1 ;
+  wp ->eff_out = need + out ;
+}
+
+#ifdef STK_TRUST
+// a word with a stack effect is checked once, here, and trusted
+Cell_t stk_enter( Dict_t *dp )
+{
+  if( !eff_Known( dp ) || dp ->cfa != doColon ){
+#ifdef TOKENS
+    if( !eff_Known( dp ) || dp ->cfa != doTokens )
+#endif
+    return 0 ;
+  }
+  if( tos - StartOf( stack ) < eff_In( dp ) ){
+    checkstack( eff_In( dp ), dp ->nfa ) ;
+    return 0 ;
+  }
+  return 1 ;
+}
+#endif
+
 void execute()
 {
   Dict_t *dp ; 
+#ifdef STK_TRUST
+  Cell_t ok = chk_Ok ;		// the caller's, a callback may run in a trusted word
+#endif
 
   chk( 1 ) ; 
   dp = (Dict_t *) pop() ;
   if( !isNul( dp ) )
   {
+#ifdef STK_TRUST
+    chk_Ok = 0 ;
+    if( eff_Known( dp ) && !isNul( dp ->pfa ) ){
+      chk_Ok = stk_enter( dp ) ;
+      if( error_code != err_OK ){	// only stk_enter()'s, not one left from before
+        chk_Ok = ok ;
+        catch() ;
+        return ;
+      }
+    }
+#endif
+
+    if( jit_Ready( dp ) ){
+      (*dp ->jit)() ;
+#ifdef STK_TRUST
+      chk_Ok = ok ;
+#endif
+      catch() ;
+      return ;
+    }
 
     if( dp ->pfa ){
       rpush( (Cell_t) dp->pfa ) ;
     }
 
+    sm_Note( dp ) ;
     if( Trace )
        tracing( dp ) ;
 
+    prof_Enter( dp ) ;
     (*dp ->cfa)() ;
+    prof_Leave() ;
+#ifdef STK_TRUST
+    chk_Ok = ok ;
+#endif
     catch() ;
 
   }
 }
 
+#ifdef CLASSIC
+
+// the original inner interpreter, each cell is run through
+// execute(), and nested colon words recurse on the C stack.
 void doColon()
 {
   Dict_t *dp ;
@@ -2857,1037 +5151,6684 @@ void doColon()
 
 }
 
-void semicolon()
+uByt_t vm_opcode( Fptr_t cfa )
 {
-
-  if( state != state_Compiling ){
-    throw( err_BadState );
-    return ;
-  }
-  push( 0 ) ; /* next is NULL */
-  comma() ;
-  --promptVal ;
-  state = state_Interactive ;
+  return op_Call ;
 }
 
-void tick()
-{
-  Str_t tkn ; 
+#else
 
-  chk( 0 ) ; 
-  word() ;
-  tkn = (Str_t) pop() ;
-  push( (Cell_t) lookup( tkn ) ) ;
-  if( *tos == 0 ){
-    put_str( tkn ) ;
-    throw( err_NoWord ) ;
-  }
-  if( state == state_Compiling )
-  {
-    push( (Cell_t) lookup( "(literal)" ) ) ;
-    comma() ; 
-    comma();
-  }
-}
+// the threaded inner interpreter ... the instruction pointer stays
+// in a register, nested colon words are entered and left without
+// recursing, and the control, literal and common stack primitives
+// are run in line.  Anything else is called in the usual way, with
+// the instruction pointer on the return stack where the primitive
+// expects it, so (literal), does> and friends behave as before.
+
+struct {
+  Fptr_t cfa ;
+  uByt_t op ;
+} vm_optab[] = {
+  { doLiteral,	op_Literal },
+  { branch,	op_Branch },
+  { q_branch,	op_QBranch },
+  { do_do,	op_Do },
+  { do_loop,	op_Loop },
+  { do_ploop,	op_PLoop },
+  { do_I,	op_I },
+  { Leave,	op_Leave },
+  { execute,	op_Execute },
+  { toR,	op_ToR },
+  { Rto,	op_RFrom },
+  { add,	op_Add },
+  { subt,	op_Sub },
+  { dupe,	op_Dup },
+  { drop,	op_Drop },
+  { swap,	op_Swap },
+  { over,	op_Over },
+  { plusplus,	op_Inc },
+  { minusminus,	op_Dec },
+  { eq,		op_Eq },
+  { ne,		op_Ne },
+  { lt,		op_Lt },
+  { gt,		op_Gt },
+  { wrd_fetch,	op_Fetch },
+  { wrd_store,	op_Store },
+  { lit_add,	op_LitAdd },
+  { lit_sub,	op_LitSub },
+  { lit_eq,	op_LitEq },
+  { lit_ne,	op_LitNe },
+  { lit_lt,	op_LitLt },
+  { lit_gt,	op_LitGt },
+  { lit_eq_branch,	op_LitEqBr },
+  { lit_ne_branch,	op_LitNeBr },
+  { lit_lt_branch,	op_LitLtBr },
+  { lit_gt_branch,	op_LitGtBr },
+  { dup_branch,	op_DupBr },
+  { loop_branch,	op_LoopBr },
+  { ploop_branch,	op_PLoopBr },
+  { var_fetch,	op_VarFetch },
+  { var_store,	op_VarStore },
+  { tail,	op_Tail },
+  { NULL,	op_Call }
+} ;
 
-void nfa()
+uByt_t vm_opcode( Fptr_t cfa )
 {
-  Dict_t *dp ;
+  Wrd_t i ;
 
-  chk( 1 ) ; 
-  dp = (Dict_t *) pop();
-  push( (Cell_t) dp ->nfa ) ;
+  for( i = 0 ; !isNul( vm_optab[i].cfa ) ; i++ ){
+    if( vm_optab[i].cfa == cfa ){
+      return vm_optab[i].op ;
+    }
+  }
+  return op_Call ;
 }
 
-void cfa()
-{
-  Dict_t *dp ;
+// computed goto where the compiler has it (-D NOGOTO to disable),
+// otherwise a switch in a tight loop ...
+// while profiling every cell takes the op_Call path, so each word
+// is timed by prof_enter()/prof_leave() ...
+#ifdef PROFILE
+#define vm_Opcode	(Profile ? op_Call : dp ->op)
+#else
+#define vm_Opcode	(dp ->op)
+#endif
 
-  chk( 1 ) ; 
-  dp = (Dict_t *) pop();
-  push( (Cell_t) dp ->cfa ) ;
-}
+#if defined( __GNUC__ ) && !defined( NOGOTO )
+#define vm_Op( x )	vm_##x
+#define vm_Dispatch()	goto *vm_ops[ vm_Opcode ] ;
+#define vm_Next		do { vm_Cell ; vm_Dispatch() } while( 0 )
+#else
+#define vm_Op( x )	case op_##x
+#define vm_Dispatch()	switch( vm_Opcode )
+#define vm_Next		continue
+#endif
 
-void pfa()
-{
-  Dict_t *dp ;
+#define vm_Cell		do { dp = (Dict_t *) *ip++ ; \
+			     if( isNul( dp ) ) goto vm_exit ; \
+			     ++_ops ; \
+			     sm_Mark( ip ) ; \
+			     if( Trace ) tracing( dp ) ; } while( 0 )
 
-  chk( 1 ) ; 
-  dp = (Dict_t *) pop() ;
-  push( (Cell_t) dp ->pfa ) ;
-}
+#ifdef NOCHECK
+#define vm_Chk( x )	{}
+#else
+#define vm_Chk( x )	do { if( !chk_Ok && tos - StartOf( stack ) < (x) ){ need = (x) ; goto vm_underflow ; } } while( 0 )
+#endif
 
-void decimal()
-{
-  Base = 10 ; 
-}
+// the fused words, (litop) n and (litop?branch) n addr
+#define vm_LitOp( x, op )	vm_Op( x ): \
+				  vm_Chk( 1 ) ; \
+				  *tos = (*tos op *ip++) ; \
+				  vm_Next ;
+#define vm_LitBranch( x, op )	vm_Op( x ): \
+				  vm_Chk( 1 ) ; \
+				  tm_Safe() ; \
+				  n = pop() ; \
+				  ip = (n op ip[0]) ? ip + 2 : (Cell_t *) ip[1] ; \
+				  vm_Next ;
 
-void hex()
+void doColon()
 {
-  Base = 16 ; 
-}
+  register Cell_t *ip ;
+  register Dict_t *dp ;
+  register Cell_t  n ;
+  Cell_t  nest = 0 ;
+  State_t save ;
+#ifndef NOCHECK
+  Cell_t  need = 0 ;
+  Cell_t  trust = -1 ;		// nest of the word chk_Ok was set for
+#endif
+#if defined( __GNUC__ ) && !defined( NOGOTO )
+  static void *vm_ops[] = {
+    [op_Call] = &&vm_Call,
+    [op_Literal] = &&vm_Literal,
+    [op_Branch] = &&vm_Branch,
+    [op_QBranch] = &&vm_QBranch,
+    [op_Do] = &&vm_Do,
+    [op_Loop] = &&vm_Loop,
+    [op_PLoop] = &&vm_PLoop,
+    [op_I] = &&vm_I,
+    [op_Leave] = &&vm_Leave,
+    [op_Execute] = &&vm_Execute,
+    [op_ToR] = &&vm_ToR,
+    [op_RFrom] = &&vm_RFrom,
+    [op_Add] = &&vm_Add,
+    [op_Sub] = &&vm_Sub,
+    [op_Dup] = &&vm_Dup,
+    [op_Drop] = &&vm_Drop,
+    [op_Swap] = &&vm_Swap,
+    [op_Over] = &&vm_Over,
+    [op_Inc] = &&vm_Inc,
+    [op_Dec] = &&vm_Dec,
+    [op_Eq] = &&vm_Eq,
+    [op_Ne] = &&vm_Ne,
+    [op_Lt] = &&vm_Lt,
+    [op_Gt] = &&vm_Gt,
+    [op_Fetch] = &&vm_Fetch,
+    [op_Store] = &&vm_Store,
+    [op_LitAdd] = &&vm_LitAdd,
+    [op_LitSub] = &&vm_LitSub,
+    [op_LitEq] = &&vm_LitEq,
+    [op_LitNe] = &&vm_LitNe,
+    [op_LitLt] = &&vm_LitLt,
+    [op_LitGt] = &&vm_LitGt,
+    [op_LitEqBr] = &&vm_LitEqBr,
+    [op_LitNeBr] = &&vm_LitNeBr,
+    [op_LitLtBr] = &&vm_LitLtBr,
+    [op_LitGtBr] = &&vm_LitGtBr,
+    [op_DupBr] = &&vm_DupBr,
+    [op_LoopBr] = &&vm_LoopBr,
+    [op_PLoopBr] = &&vm_PLoopBr,
+    [op_VarFetch] = &&vm_VarFetch,
+    [op_VarStore] = &&vm_VarStore,
+    [op_Tail] = &&vm_Tail,
+    [op_Jit] = &&vm_Jit,
+  } ;
+#endif
 
-void sigvar()
-{
-#ifdef HOSTED
-  push( (Cell_t) &sigval ); 
+  save = state ;
+  state = state_Interpret ;
+  ip = (Cell_t *) rpop() ;
+
+  for(;;){
+    vm_Cell ;
+   vm_again:
+    vm_Dispatch() {
+
+      vm_Op( Call ):
+        if( !isNul( dp ->pfa ) ){
+          if( dp ->cfa == doColon ){
+#if !defined( NOCHECK ) && !defined( ARENA )
+            if( rtos >= &rstack[sz_STACK - 1] ){
+              throw( err_StackOvr ) ;
+              goto vm_fault ;
+            }
 #endif
-}
+#ifndef NOCHECK
+            if( !chk_Ok && eff_Known( dp ) ){
+              vm_Chk( eff_In( dp ) ) ;
+              chk_Ok = 1 ;
+              trust = nest + 1 ;
+            }
+#endif
+            rpush( (Cell_t) ip ) ;
+            ip = dp ->pfa ;
+            nest++ ;
+            prof_Enter( dp ) ;
+            vm_Next ;
+          }
+          if( dp ->cfa == pushPfa ){
+            prof_Enter( dp ) ;
+            push( dp ->pfa ) ;
+            prof_Leave() ;
+            vm_Next ;
+          }
+          if( dp ->cfa == doConstant ){
+            prof_Enter( dp ) ;
+            push( *dp ->pfa ) ;
+            prof_Leave() ;
+            vm_Next ;
+          }
+          rpush( (Cell_t) ip ) ;
+          rpush( (Cell_t) dp ->pfa ) ;
+        } else {
+          rpush( (Cell_t) ip ) ;
+        }
+        prof_Enter( dp ) ;
+        (*dp ->cfa)() ;
+        prof_Leave() ;
+        if( error_code ){
+          catch() ;
+        }
+        ip = (Cell_t *) rpop() ;
+        if( isNul( ip ) ){
+          goto vm_exit ;
+        }
+        vm_Next ;
+
+      vm_Op( Literal ):
+        push( *ip++ ) ;
+        vm_Next ;
+
+      vm_Op( Branch ):
+        tm_Safe() ;
+        ip = (Cell_t *) *ip ;
+        vm_Next ;
+
+      vm_Op( QBranch ):
+        tm_Safe() ;
+        if( pop() ){
+          ip++ ;
+        } else {
+          ip = (Cell_t *) *ip ;
+        }
+        vm_Next ;
+
+      vm_Op( Do ):		// ( end start -- )
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        rpush( pop() ) ;
+        rpush( n ) ;
+        vm_Next ;
+
+      vm_Op( Loop ):
+        if( *rtos + 1 < *rnos ){
+          *rtos += 1 ;
+          push( 0 ) ;
+        } else {
+          rtos -= 2 ;
+          push( 1 ) ;
+        }
+        vm_Next ;
+
+      vm_Op( PLoop ):
+        n = pop() ;
+        if( (n > 0) ? (*rtos + n < *rnos) : (*rtos + n > *rnos) ){
+          *rtos += n ;
+          push( 0 ) ;
+        } else {
+          rtos -= 2 ;
+          push( 1 ) ;
+        }
+        vm_Next ;
 
-void errvar()
-{
-  push( (Cell_t) &error_code ); 
-}
+      vm_Op( I ):
+        push( *rtos ) ;
+        vm_Next ;
 
-void errval()
-{
-  errvar();
-  wrd_fetch();
-}
+      vm_Op( Leave ):
+        goto vm_exit ;
 
-void errstr()
-{
+      vm_Op( Execute ):
+        vm_Chk( 1 ) ;
+        dp = (Dict_t *) pop() ;
+        if( isNul( dp ) ){
+          vm_Next ;
+        }
+        if( Trace ) tracing( dp ) ;
+        goto vm_again ;
+
+      vm_Op( ToR ):
+        vm_Chk( 1 ) ;
+        rpush( pop() ) ;
+        vm_Next ;
+
+      vm_Op( RFrom ):
+        push( rpop() ) ;
+        vm_Next ;
+
+      vm_Op( Add ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos += n ;
+        vm_Next ;
+
+      vm_Op( Sub ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos -= n ;
+        vm_Next ;
+
+      vm_Op( Dup ):
+        vm_Chk( 1 ) ;
+        n = *tos ;
+        push( n ) ;
+        vm_Next ;
+
+      vm_Op( Drop ):
+        vm_Chk( 1 ) ;
+        tos-- ;
+        vm_Next ;
+
+      vm_Op( Swap ):
+        vm_Chk( 2 ) ;
+        n = *tos ;
+        *tos = nos ;
+        nos = n ;
+        vm_Next ;
+
+      vm_Op( Over ):
+        vm_Chk( 2 ) ;
+        n = nos ;
+        push( n ) ;
+        vm_Next ;
+
+      vm_Op( Inc ):
+        *tos += 1 ;
+        vm_Next ;
+
+      vm_Op( Dec ):
+        *tos -= 1 ;
+        vm_Next ;
+
+      vm_Op( Eq ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos = (*tos == n) ? 1 : 0 ;
+        vm_Next ;
+
+      vm_Op( Ne ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos = (*tos != n) ? 1 : 0 ;
+        vm_Next ;
+
+      vm_Op( Lt ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos = (*tos < n) ? 1 : 0 ;
+        vm_Next ;
+
+      vm_Op( Gt ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        *tos = (*tos > n) ? 1 : 0 ;
+        vm_Next ;
+
+      vm_Op( Fetch ):
+        vm_Chk( 1 ) ;
+        n = pop() ;
+        if( isNul( (Cell_t *) n ) ){
+          throw( err_NullPtr ) ;
+          goto vm_fault ;
+        }
+        push( *(Cell_t *) n ) ;
+        vm_Next ;
+
+      vm_Op( Store ):
+        vm_Chk( 2 ) ;
+        n = pop() ;
+        if( isNul( (Cell_t *) n ) ){
+          tos-- ;
+          throw( err_NullPtr ) ;
+          goto vm_fault ;
+        }
+        *(Cell_t *) n = pop() ;
+        vm_Next ;
+
+      vm_LitOp( LitAdd, + )
+      vm_LitOp( LitSub, - )
+      vm_LitOp( LitEq, == )
+      vm_LitOp( LitNe, != )
+      vm_LitOp( LitLt, < )
+      vm_LitOp( LitGt, > )
+      vm_LitBranch( LitEqBr, == )
+      vm_LitBranch( LitNeBr, != )
+      vm_LitBranch( LitLtBr, < )
+      vm_LitBranch( LitGtBr, > )
+
+      vm_Op( DupBr ):
+        vm_Chk( 1 ) ;
+        tm_Safe() ;
+        ip = (*tos) ? ip + 1 : (Cell_t *) *ip ;
+        vm_Next ;
+
+      vm_Op( LoopBr ):
+        tm_Safe() ;
+        if( *rtos + 1 < *rnos ){
+          *rtos += 1 ;
+          ip = (Cell_t *) *ip ;
+        } else {
+          rtos -= 2 ;
+          ip++ ;
+        }
+        vm_Next ;
+
+      vm_Op( PLoopBr ):
+        vm_Chk( 1 ) ;
+        tm_Safe() ;
+        n = pop() ;
+        if( (n > 0) ? (*rtos + n < *rnos) : (*rtos + n > *rnos) ){
+          *rtos += n ;
+          ip = (Cell_t *) *ip ;
+        } else {
+          rtos -= 2 ;
+          ip++ ;
+        }
+        vm_Next ;
+
+      vm_Op( VarFetch ):
+        push( *((Dict_t *) *ip++) ->pfa ) ;
+        vm_Next ;
+
+      vm_Op( VarStore ):
+        vm_Chk( 1 ) ;
+        *((Dict_t *) *ip++) ->pfa = pop() ;
+        vm_Next ;
+
+      vm_Op( Tail ):		// the caller's frame is reused
+        tm_Safe() ;
+        dp = (Dict_t *) *ip ;
+        if( dp ->op == op_Jit && !Trace && jit_Mine( dp ) ){
+          (*dp ->jit)() ;
+          goto vm_exit ;
+        }
+        ip = dp ->pfa ;
+        vm_Next ;
 
-  register Cell_t err = pop() ;
+      vm_Op( Jit ):		// traced words run threaded
+        if( !Trace && jit_Mine( dp ) ){
+          (*dp ->jit)() ;
+          vm_Next ;
+        }
+        rpush( (Cell_t) ip ) ;
+        ip = dp ->pfa ;
+        nest++ ;
+        prof_Enter( dp ) ;
+        vm_Next ;
+
+#if !defined( __GNUC__ ) || defined( NOGOTO )
+      default:
+        throw( err_BadState ) ;
+        goto vm_fault ;
+#endif
+    }
 
-  if( err >= err_OK && err <= err_Undefined )
-     push( errors[ err ] ) ;
-  else
-     throw( err_Range ) ;
-  return ;
+#ifndef NOCHECK
+   vm_underflow:
+    fmt_out( "-- Found %d of %d args expected in '%s'.\n", tos - StartOf( stack ), need, dp ->nfa ) ;
+    throw( err_StackUdr ) ;
+#endif
+
+   vm_fault:			// let catch() see where we were ...
+    rpush( (Cell_t) ip ) ;
+    catch() ;
+    ip = (Cell_t *) rpop() ;
+    if( !isNul( ip ) ){
+      continue ;
+    }
+
+   vm_exit:
+    if( nest < 1 ){
+      sm_Mark( NULL ) ;
+      break ;
+    }
+    prof_Leave() ;
+#ifndef NOCHECK
+    if( nest == trust ){
+      chk_Ok = 0 ;
+      trust = -1 ;
+    }
+#endif
+    nest-- ;
+    ip = (Cell_t *) rpop() ;
+  }
+
+  state = save ;
 }
 
-void errmax()
-{
-  push( err_Undefined ) ;
+#endif // CLASSIC
+
+#ifdef TOKENS
+/*
+  -- token threaded code --
+
+  built with -D TOKENS, for the small targets, a colon word is packed
+  at ; into 16 bit tokens in the flash it was compiled to, and Here is
+  given back what that saved.  A token is one more than the word's
+  index in Primitives[] then tok_Defs[] (the Colon_Defs[] the words
+  are in, a shared VM has none of its own), 0 ends the word.  A
+  literal is a token if it fits one, otherwise tok_Long and the cell a
+  token at a time, low first; a branch is the distance in tokens from
+  where it is stored to its target, and (tail) and the variable
+  fusions hold the token of their word.  None of it depends on where
+  the code is, so does> copies the rest of a packed word as it is.
+
+  A word with a cell tok_pack() can not account for, a (pardo) or more
+  than sz_TOKMAP cells stays threaded as it was compiled.
+*/
+typedef uint16_t	Tok_t ;
+
+#define tok_Long	((Tok_t) 0x8000)
+#define tok_None	((Tok_t) 0xffff)
+#define tok_Halves	(sizeof( Cell_t ) / sizeof( Tok_t ))
+#define tok_Cells( n )	(((n) * sizeof( Tok_t ) + sizeof( Cell_t ) - 1) / sizeof( Cell_t ))
+#define tok_Fits( v )	((v) >= -0x7fff && (v) <= 0x7fff)
+#define tok_Jump( tp )	((tp) + (int16_t) *(tp))
+
+typedef enum {
+  ta_None,		// just the token
+  ta_Lit,		// a literal
+  ta_Branch,		// a branch
+  ta_LitBranch,		// a literal then a branch
+  ta_Word,		// the token of a word
+  ta_Bad		// not packed
+} TokArg_t ;
+
+// called from a packed word, a primitive finds this where ip would be
+Cell_t tok_Ret[ 2 ] = { 0, 0 } ;
+
+Cell_t tok_token( Dict_t *dp )
+{
+  Byt_t *p = (Byt_t *) dp ;
+  Cell_t t = -1 ;
+
+  if( p >= (Byt_t *) Primitives && p < (Byt_t *) &Primitives[ n_Primitives ] &&
+      (p - (Byt_t *) Primitives) % sizeof( Dict_t ) == 0 ){
+    t = dp - Primitives ;
+  } else if( p >= (Byt_t *) tok_Defs && p < (Byt_t *) &tok_Defs[ sz_ColonDefs ] &&
+      (p - (Byt_t *) tok_Defs) % sizeof( Dict_t ) == 0 ){
+    t = n_Primitives + (dp - tok_Defs) ;
+  }
+  return (t < 0 || t + 1 >= tok_None) ? -1 : t + 1 ;
+}
+
+Dict_t *tok_dict( Tok_t t )
+{
+  return (t <= n_Primitives) ? &Primitives[ t - 1 ] : &tok_Defs[ t - 1 - n_Primitives ] ;
+}
+
+TokArg_t tok_arg( Dict_t *dp )
+{
+  switch( dp ->op ){
+    case op_Literal:
+    case op_LitAdd:
+    case op_LitSub:
+    case op_LitEq:
+    case op_LitNe:
+    case op_LitLt:
+    case op_LitGt:
+      return ta_Lit ;
+    case op_Branch:
+    case op_QBranch:
+    case op_DupBr:
+    case op_LoopBr:
+    case op_PLoopBr:
+      return ta_Branch ;
+    case op_LitEqBr:
+    case op_LitNeBr:
+    case op_LitLtBr:
+    case op_LitGtBr:
+      return ta_LitBranch ;
+    case op_VarFetch:
+    case op_VarStore:
+    case op_Tail:
+      return ta_Word ;
+  }
+#ifdef PARDO
+  if( dp ->cfa == par_do ){		// its body is threaded
+    return ta_Bad ;
+  }
+#endif
+  return ta_None ;
 }
 
-void trace()
+// the cells after a threaded instruction
+Cell_t tok_operands( TokArg_t a )
 {
-  push( (Cell_t) &Trace ); 
+  return (a == ta_LitBranch) ? 2 : (a == ta_None) ? 0 : 1 ;
 }
 
-void base()
+Tok_t *tok_put_lit( Tok_t *tp, Cell_t v )
 {
-  push( (Cell_t) &Base ); 
+  Cell_t k ;
+
+  if( tok_Fits( v ) ){
+    *tp++ = (Tok_t) v ;
+    return tp ;
+  }
+  *tp++ = tok_Long ;
+  for( k = 0 ; k < tok_Halves ; k++ ){
+    *tp++ = (Tok_t) ((uCell_t) v >> (16 * k)) ;
+  }
+  return tp ;
 }
 
-void resetter()
+Cell_t tok_lit( Tok_t **tpp )
 {
-  put_str( "-- Warm start." ) ; cr();
-  q_reset() ;
-#ifdef HOSTED
-  longjmp( env, rst_user ) ;
-#endif
+  Tok_t *tp = *tpp ;
+  uCell_t v = 0 ;
+  Cell_t k ;
+
+  if( *tp != tok_Long ){
+    *tpp = tp + 1 ;
+    return (int16_t) *tp ;
+  }
+  for( k = 0 ; k < tok_Halves ; k++ ){
+    v |= (uCell_t) tp[ 1 + k ] << (16 * k) ;
+  }
+  *tpp = tp + 1 + tok_Halves ;
+  return (Cell_t) v ;
 }
 
-void cold()
+// the token after this instruction
+Tok_t *tok_next( Tok_t *tp )
 {
-  put_str( "-- Cold start." ) ; cr();
-  q_reset() ;
-  forget() ;
-#ifdef HOSTED
-  longjmp( env, rst_coldstart ) ;
-#else
-#endif
+  TokArg_t a = tok_arg( tok_dict( *tp++ ) ) ;
+
+  if( a == ta_Lit || a == ta_LitBranch ){
+    tp += (*tp == tok_Long) ? 1 + tok_Halves : 1 ;
+  }
+  if( a == ta_Branch || a == ta_LitBranch || a == ta_Word ){
+    tp++ ;
+  }
+  return tp ;
 }
 
-void see()
+// the word just compiled, packed in place if every cell is accounted
+// for.  No instruction packs to more than its cells, so what is
+// written never reaches what is still to be read.
+void tok_pack( Dict_t *wp )
 {
-  register Dict_t *p, *r ; 
-  Cell_t *ptr, n ; 
-
-  chk( 1 ) ; 
+  Tok_t map[ sz_TOKMAP + 1 ], *tp ;
+  Cell_t *pfa, *ip, *next, *to, n, k, v ;
+  Dict_t *dp ;
+  TokArg_t a ;
 
-  p = (Dict_t *) pop() ;
-  if( isNul( p ->pfa ) ){
-    n = fmt_out( "-- %s (%x) flg: %d is coded in C (%x).\n", p ->nfa, p, p->flg, p ->cfa ) ;
+  pfa = wp ->pfa ;
+  if( wp ->cfa != doColon || isNul( pfa ) || pfa >= Here ){
     return ;
-  } else {
-    if( p ->cfa == (Fptr_t) doConstant ){
-      n = fmt_out( "-- %s constant value (0x%x).\n", p ->nfa, *p->pfa ) ;
+  }
+  for( k = 0 ; k <= sz_TOKMAP ; k++ ){
+    map[ k ] = tok_None ;
+  }
+  for( n = 0, ip = pfa ; ip < Here && *ip ; ip += 1 + tok_operands( a ) ){
+    dp = (Dict_t *) *ip ;
+    if( ip - pfa >= sz_TOKMAP || tok_token( dp ) < 0 || (a = tok_arg( dp )) == ta_Bad ){
       return ;
     }
-    if( p ->cfa == (Fptr_t) pushPfa ){
-      n = fmt_out( "-- %s variable value (0x%x).\n", p ->nfa, *p->pfa ) ;
+    if( a == ta_Word && tok_token( (Dict_t *) ip[1] ) < 0 ){
       return ;
     }
-    n = fmt_out( "-- %s (%x) word flg: %d.\n", p ->nfa, p, p->flg ) ;
+    map[ ip - pfa ] = n++ ;
+    if( a == ta_Lit || a == ta_LitBranch ){
+      n += tok_Fits( ip[1] ) ? 1 : 1 + tok_Halves ;
+    }
+    if( a == ta_Branch || a == ta_LitBranch || a == ta_Word ){
+      n++ ;
+    }
   }
-  ptr = p ->pfa ; 
-  while( !isNul( ptr ) ){
-    r = (Dict_t *) *ptr ;
-    if( isNul( r ) ){			/* next == NULL */
-      n = fmt_out( "%x  next\n", ptr ) ;
-      break ;
+  if( ip + 1 != Here ){			// something after the 0
+    return ;
+  }
+  map[ ip - pfa ] = n ;
+  for( ip = pfa ; *ip ; ip += 1 + tok_operands( a ) ){
+    a = tok_arg( (Dict_t *) *ip ) ;
+    if( a == ta_Branch || a == ta_LitBranch ){
+      to = (Cell_t *) ip[ tok_operands( a ) ] ;
+      if( to < pfa || to >= Here || map[ to - pfa ] == tok_None ){
+        return ;
+      }
     }
-    Str_t buf = tb_get( TB ) ;
-    if( r ->cfa  == (Fptr_t) branch ){
-      n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", ptr, r ->nfa, *(ptr+1) ) ;
-      ptr++ ;
-    } else  if( r ->cfa  == (Fptr_t) q_branch ){
-      n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", ptr, r ->nfa, *(ptr+1) ) ;
-      ptr++ ;
-    } else if( r ->cfa  == (Fptr_t) doLiteral ){
-      n = str_format( buf, tb_bufsize( TB ), "%x  %s = %d\n", ptr, r ->nfa, *(ptr+1) ) ;
-      ptr++ ;
-    } else {
-      n = str_format( buf, tb_bufsize( TB ), "%x  %s\n", ptr, r ->nfa ) ;
+  }
+
+  tp = (Tok_t *) pfa ;
+  for( ip = pfa ; *ip ; ip = next ){
+    dp = (Dict_t *) *ip ;
+    a = tok_arg( dp ) ;
+    next = ip + 1 + tok_operands( a ) ;
+    v = ip[1] ;
+    to = (Cell_t *) ip[ tok_operands( a ) ] ;
+    *tp++ = (Tok_t) tok_token( dp ) ;
+    if( a == ta_Lit || a == ta_LitBranch ){
+      tp = tok_put_lit( tp, v ) ;
+    }
+    if( a == ta_Branch || a == ta_LitBranch ){
+      *tp = (Tok_t) (map[ to - pfa ] - (tp - (Tok_t *) pfa)) ;
+      tp++ ;
+    }
+    if( a == ta_Word ){
+      *tp++ = (Tok_t) tok_token( (Dict_t *) v ) ;
     }
-    outp( OUTPUT, (Str_t) buf, n ) ;
-    ptr++ ;
   }
+  *tp++ = 0 ;
+  Here = pfa + tok_Cells( tp - (Tok_t *) pfa ) ;
+  wp ->cfa = doTokens ;
+  peep_barrier() ;
 }
 
-/*
-  -- I/O routines --
+// does> run from a packed word, as does() is from a threaded one, the
+// new word is given the rest of this one
+void tok_does( Tok_t *tp )
+{
+  Dict_t *dp ;
+  Tok_t *end, *out ;
 
-  must be written for the Atmel AVR's, but
-  any HOSTED (Linux/Unix/Windows) system can simply use read/write.
-  key and ?key are special cases (len == 1), 
-  and cbreak has been added for processing for tty's.
+  for( end = tp ; *end ; end = tok_next( end ) ) ;
+  freespace() ;
+  if( pop() <= (Cell_t) ((end - tp + 2 + tok_Halves) * sizeof( Tok_t ) + sizeof( Cell_t )) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  dp = &Colon_Defs[n_ColonDefs-1] ;
+  out = (Tok_t *) Here ;
+  *out++ = (Tok_t) tok_token( lookup( "(literal)" ) ) ;
+  out = tok_put_lit( out, (Cell_t) dp ->pfa ) ;	/* push the original pfa */
+  while( tp <= end ){
+    *out++ = *tp++ ;
+  }
+  dp ->pfa = Here ;
+  dp ->cfa = doTokens ;
+  Here += tok_Cells( out - (Tok_t *) Here ) ;
+}
 
-  For Native ARM based systems, we will be implementing uart put/get functions
-  and a get without echo (for key) ... 
+#ifdef NOCHECK
+#define tok_Chk( x )	{}
+#else
+#define tok_Chk( x )	do { if( tos - StartOf( stack ) < (x) ){ checkstack( x, dp ->nfa ) ; catch() ; goto tok_exit ; } } while( 0 )
+#endif
 
-*/
+#define tok_LitOp( x, op )	case op_##x: \
+				  n = tok_lit( &tp ) ; \
+				  tok_Chk( 1 ) ; \
+				  *tos = (*tos op n) ; \
+				  continue ;
+#define tok_LitBranch( x, op )	case op_##x: \
+				  n = tok_lit( &tp ) ; \
+				  tok_Chk( 1 ) ; \
+				  tm_Safe() ; \
+				  tp = (pop() op n) ? tp + 1 : tok_Jump( tp ) ; \
+				  continue ;
+
+// the inner interpreter for packed words, the opcodes that work the
+// return stack or read the thread run here, anything else is called
+// as execute() would, nesting on the C stack as the classic one does
+void doTokens()
+{
+  register Tok_t *tp ;
+  register Dict_t *dp ;
+  Cell_t n ;
+  State_t save ;
 
-Wrd_t fmt_out( Str_t fmt, ... )
-{
-  va_list  ap ;
-  Wrd_t    nx, siz ;
-  Str_t    buf = tb_get( TB );
+  save = state ;
+  state = state_Interpret ;
+  tp = (Tok_t *) rpop() ;
+
+  while( *tp ){
+    dp = tok_dict( *tp++ ) ;
+    ++_ops ;
+    if( Trace ) tracing( dp ) ;
+   tok_again:
+    switch( dp ->op ){
+
+      case op_Literal:
+        push( tok_lit( &tp ) ) ;
+        continue ;
+
+      case op_Branch:
+        tm_Safe() ;
+        tp = tok_Jump( tp ) ;
+        continue ;
+
+      case op_QBranch:
+        tok_Chk( 1 ) ;
+        tm_Safe() ;
+        tp = pop() ? tp + 1 : tok_Jump( tp ) ;
+        continue ;
+
+      case op_Do:		// ( end start -- )
+        tok_Chk( 2 ) ;
+        n = pop() ;
+        rpush( pop() ) ;
+        rpush( n ) ;
+        continue ;
+
+      case op_Loop:
+        if( *rtos + 1 < *rnos ){
+          *rtos += 1 ;
+          push( 0 ) ;
+        } else {
+          rtos -= 2 ;
+          push( 1 ) ;
+        }
+        continue ;
+
+      case op_PLoop:
+        tok_Chk( 1 ) ;
+        n = pop() ;
+        if( (n > 0) ? (*rtos + n < *rnos) : (*rtos + n > *rnos) ){
+          *rtos += n ;
+          push( 0 ) ;
+        } else {
+          rtos -= 2 ;
+          push( 1 ) ;
+        }
+        continue ;
 
-  siz = tb_bufsize( TB ) ;
-  va_start( ap, fmt );
-   nx = str_format_ap( buf, siz, fmt, ap ) ;
-  va_end( ap ) ;
+      case op_I:
+        push( *rtos ) ;
+        continue ;
 
-  outp( OUTPUT, buf, nx );
-  return nx ;
-}
+      case op_Leave:
+        goto tok_exit ;
 
-Wrd_t put_str( Str_t s )
-{
-  register Cell_t n = 0;
+      case op_Execute:
+        tok_Chk( 1 ) ;
+        dp = (Dict_t *) pop() ;
+        if( isNul( dp ) ){
+          continue ;
+        }
+        if( Trace ) tracing( dp ) ;
+        goto tok_again ;
+
+      case op_ToR:
+        tok_Chk( 1 ) ;
+        rpush( pop() ) ;
+        continue ;
+
+      case op_RFrom:
+        push( rpop() ) ;
+        continue ;
+
+      tok_LitOp( LitAdd, + )
+      tok_LitOp( LitSub, - )
+      tok_LitOp( LitEq, == )
+      tok_LitOp( LitNe, != )
+      tok_LitOp( LitLt, < )
+      tok_LitOp( LitGt, > )
+      tok_LitBranch( LitEqBr, == )
+      tok_LitBranch( LitNeBr, != )
+      tok_LitBranch( LitLtBr, < )
+      tok_LitBranch( LitGtBr, > )
+
+      case op_DupBr:
+        tok_Chk( 1 ) ;
+        tm_Safe() ;
+        tp = (*tos) ? tp + 1 : tok_Jump( tp ) ;
+        continue ;
+
+      case op_LoopBr:
+        tm_Safe() ;
+        if( *rtos + 1 < *rnos ){
+          *rtos += 1 ;
+          tp = tok_Jump( tp ) ;
+        } else {
+          rtos -= 2 ;
+          tp++ ;
+        }
+        continue ;
+
+      case op_PLoopBr:
+        tok_Chk( 1 ) ;
+        tm_Safe() ;
+        n = pop() ;
+        if( (n > 0) ? (*rtos + n < *rnos) : (*rtos + n > *rnos) ){
+          *rtos += n ;
+          tp = tok_Jump( tp ) ;
+        } else {
+          rtos -= 2 ;
+          tp++ ;
+        }
+        continue ;
+
+      case op_VarFetch:
+        push( *tok_dict( *tp++ ) ->pfa ) ;
+        continue ;
+
+      case op_VarStore:
+        tok_Chk( 1 ) ;
+        *tok_dict( *tp++ ) ->pfa = pop() ;
+        continue ;
+
+      case op_Tail:		// the frame is reused when it is packed
+        tm_Safe() ;
+        dp = tok_dict( *tp++ ) ;
+        if( dp ->cfa == doTokens ){
+          tp = (Tok_t *) dp ->pfa ;
+          continue ;
+        }
+        break ;
 
-  if( !isNul( s ) ){
-    n = str_length( s ) ; 
-    outp( OUTPUT, s, n ) ;
-    outp( OUTPUT, " ", 1 ) ;
+      default:
+        if( dp ->cfa == does ){
+          tok_does( tp ) ;
+          catch() ;
+          goto tok_exit ;
+        }
+        break ;
+    }
+
+    rpush( (Cell_t) &tok_Ret[ 1 ] ) ;
+    if( !isNul( dp ->pfa ) ){
+      rpush( (Cell_t) dp ->pfa ) ;
+    }
+    prof_Enter( dp ) ;
+    (*dp ->cfa)() ;
+    prof_Leave() ;
+    if( error_code ){
+      catch() ;
+    }
+    if( rpop() != (Cell_t) &tok_Ret[ 1 ] ){	// it moved ip, that ends us
+      break ;
+    }
   }
-  return n ;
-}
 
-Wrd_t get_str( Wrd_t fd, Str_t buf, Wrd_t len )
-{
-  Byt_t ch ;
-  Wrd_t i, crlf = 0 ;
+ tok_exit:
+  state = save ;
+}
 
-  str_set( buf, 0, len ) ;
+// see for a packed word
+void tok_see( Dict_t *wp )
+{
+  Tok_t *tp, *at ;
+  Dict_t *r ;
+  Cell_t n, v ;
+  Str_t buf ;
 
-  i = 0 ; 
-  do {
-    if( i > (len - 1) ){
-      return i ;
+  for( tp = (Tok_t *) wp ->pfa ; *tp ; tp = tok_next( tp ) ) ;
+  n = fmt_out( "-- packed in %d tokens.\n", tp - (Tok_t *) wp ->pfa + 1 ) ;
+  for( tp = (Tok_t *) wp ->pfa ; *tp ; ){
+    at = tp ;
+    r = tok_dict( *tp++ ) ;
+    buf = tb_get( TB ) ;
+    switch( tok_arg( r ) ){
+      case ta_Lit:
+        v = tok_lit( &tp ) ;
+        n = str_format( buf, tb_bufsize( TB ), (r ->op == op_Literal) ? "%x  %s = %d\n" : "%x  %s %d\n", at, r ->nfa, v ) ;
+        break ;
+      case ta_LitBranch:
+        v = tok_lit( &tp ) ;
+        n = str_format( buf, tb_bufsize( TB ), "%x  %s %d -> %x\n", at, r ->nfa, v, tok_Jump( tp ) ) ;
+        tp++ ;
+        break ;
+      case ta_Branch:
+        n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", at, r ->nfa, tok_Jump( tp ) ) ;
+        tp++ ;
+        break ;
+      case ta_Word:
+        n = str_format( buf, tb_bufsize( TB ), "%x  %s %s\n", at, r ->nfa, tok_dict( *tp++ ) ->nfa ) ;
+        break ;
+      default:
+        n = str_format( buf, tb_bufsize( TB ), "%x  %s\n", at, r ->nfa ) ;
+        break ;
     }
+    outp( OUTPUT, (Str_t) buf, n ) ;
+  }
+  n = fmt_out( "%x  next\n", tp ) ;
+}
 
-	key() ; ch = pop() & 0xff ;
-    if( ch == 0 )
-    {
-      return i ;
-    }
+// save-image and compile-c relocate pointers a cell at a time, those
+// in packed literals they would miss
+Cell_t tok_packed( void )
+{
+  Cell_t i ;
 
-    if( ch_matches( ch, "\r\n" ) ){ 
-       crlf++ ;
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    if( Colon_Defs[ i ].cfa == doTokens ){
+      return 1 ;
     }
+  }
+  return 0 ;
+}
+#endif // TOKENS
+
+#ifdef JIT
+// a small x86-64 compiler for colon defs.  rbx caches tos, r12 rtos,
+// r13 and r14 hold their addresses and r15 the base of the stack.
+// Cells with an opcode (see vm_optab) run in line, as do a few more
+// simple primitives, anything else is called with tos and rtos
+// written back around the call, so the C side sees the usual machine.
+// The code belongs to the VM it was compiled in (see jit_Mine()).
+#define J( s )		jit_emit( (uByt_t *) s, sizeof( s ) - 1 )
+#define X_SAVE		"\x49\x89\x5d\x00\x4d\x89\x26"	// mov [r13],rbx ; mov [r14],r12
+#define X_LOAD		"\x49\x8b\x5d\x00\x4d\x8b\x26"	// mov rbx,[r13] ; mov r12,[r14]
+#define X_PUSH_RAX	"\x48\x83\xc3\x08\x48\x89\x03"	// add rbx,8 ; mov [rbx],rax
+#define X_POP_RAX	"\x48\x8b\x03\x48\x83\xeb\x08"	// mov rax,[rbx] ; sub rbx,8
+#define X_POP_RCX	"\x48\x8b\x0b\x48\x83\xeb\x08"	// mov rcx,[rbx] ; sub rbx,8
+#define X_RTOS_RAX	"\x49\x8b\x04\x24"		// mov rax,[r12]
+#define X_RAX_RTOS	"\x49\x89\x04\x24"		// mov [r12],rax
+#define X_CMP_RNOS	"\x49\x3b\x44\x24\xf8"		// cmp rax,[r12-8]
+#define X_RDROP2	"\x49\x83\xec\x10"		// sub r12,16
+#define X_RAX		"\x48\xb8"			// movabs rax, ...
+#define X_RDI		"\x48\xbf"
+#define X_CMP_SET	"\x31\xc9\x48\x39\x03"		// xor ecx,ecx ; cmp [rbx],rax
+#define X_RCX_TOS	"\x48\x89\x0b"			// mov [rbx],rcx
+
+void jit_emit( uByt_t *s, Wrd_t n )
+{
+  while( n-- > 0 ){
+    *jit_P++ = *s++ ;
+  }
+}
 
-    buf[i++] = (Byt_t) ch ;
-
-  } while( crlf < 1 ) ;
-  return i ;
+void jit_u32( uint32_t v )
+{
+  str_copy( (Str_t) jit_P, (Str_t) &v, sizeof( v ) ) ;
+  jit_P += sizeof( v ) ;
 }
 
-Wrd_t io_cbreak( int fd )
+void jit_imm( Str_t op, Cell_t v )
 {
-#if defined( HOSTED ) 
-#if !defined(__WIN32__)
-  static int inCbreak = v_Off ;
-  static struct termios tty_state, *tty_orig = (struct termios *) NULL ; 
-  int rv ;
+  jit_emit( (uByt_t *) op, 2 ) ;
+  str_copy( (Str_t) jit_P, (Str_t) &v, sizeof( v ) ) ;
+  jit_P += sizeof( v ) ;
+}
 
-  if( isNul( tty_orig ) ){
-    rv = tcgetattr( fd, &tty_normal_state );
-    tty_orig = &tty_normal_state ;
-  } 
+void jit_call( void *fn )
+{
+  jit_imm( X_RAX, (Cell_t) fn ) ;
+  J( "\xff\xd0" ) ;				// call rax
+}
 
-  switch( inCbreak ){
-    case v_Off:
-      rv = tcgetattr( fd, &tty_state ) ;
-      cfmakeraw( &tty_state ) ;
-      rv = tcsetattr( fd, TCSANOW, &tty_state ) ; 
-      inCbreak = v_On ;
-      break ;
-    case v_On:
-      rv = tcsetattr( fd, TCSANOW, tty_orig ) ; 
-      inCbreak = v_Off ;
-  }
-  return inCbreak ;
-#endif
-#else
-  return v_On ;
-#endif
+void jit_jump( Str_t op, Cell_t idx )
+{
+  jit_emit( (uByt_t *) op, str_length( op ) ) ;
+  jit_Fix[ jit_nFix ].at = jit_P ;
+  jit_Fix[ jit_nFix++ ].idx = idx ;
+  jit_u32( 0 ) ;
 }
 
-void waitrdy() // fd secs usecs -- flag )
+uByt_t *jit_fwd8( Str_t op )			// short forward jump ...
 {
-#ifdef HOSTED
-#if !defined( __WIN32__ )
-  Wrd_t rv, fd, secs, usecs ;
-  fd_set fds ;
-  struct timeval tmo ;
+  *jit_P++ = *op ;
+  *jit_P++ = 0 ;
+  return jit_P - 1 ;
+}
 
-  usecs = pop() ;
-  secs = pop() ;
-  fd = pop() ;
- 
-  FD_ZERO( &fds ) ;
-  FD_SET( fd, &fds ) ;
+void jit_land8( uByt_t *p )			// ... and where it lands
+{
+  *p = (uByt_t) (jit_P - (p + 1)) ;
+}
 
-  tmo.tv_sec = secs ;
-  tmo.tv_usec = usecs ;
-  rv = select( fd+1, &fds, NULL, NULL, &tmo ) ;  
-  if( rv < 0 ){
-    throw( err_SysCall ) ;
-  }
-  push( FD_ISSET( fd, &fds ) ) ;
-#endif
-#endif
+void jit_exec( Dict_t *dp )
+{
+  push( (Cell_t) dp ) ;
+  execute() ;
 }
 
-void sndtty() // ( fd ptr -- nx )
+void jit_throw( Cell_t err )
 {
-  Str_t str ;
-  Wrd_t fd, len ;
+  throw( (Err_t) err ) ;
+  catch() ;
+}
 
-  chk( 2 ) ; 
-  
-  len = str_length( (Str_t) *tos ) ;
-  str = (Str_t) pop() ;
-  fd = pop() ;
-  push( (Cell_t) outp( fd, str, len ) ) ;
+void jit_underflow( Dict_t *wp )
+{
+  fmt_out( "-- Stack underflow in '%s'.\n", wp ->nfa ) ;
+  throw( err_StackUdr ) ;
+  catch() ;
 }
 
-#ifdef HOSTED
-void rcvtty() // ( fd n -- buf n )
+void jit_fault( Err_t err )
 {
-  Str_t buf ;
-  Wrd_t n, nr, fd ;
+  J( X_SAVE ) ;
+  jit_imm( X_RDI, err ) ;
+  jit_call( jit_throw ) ;
+  jit_jump( "\xe9", jit_L + 1 ) ;
+}
 
-  chk( 2 ) ; 
+void jit_need( Cell_t n, Dict_t *wp )
+{
+#ifndef NOCHECK
+  uByt_t *p ;
 
-  n = pop() ;
-  fd = pop() ;
-  here() ; buf = (Str_t) pop() + 8 * sizeof( Cell_t ) ;
-  in_files[++in_This] = fd ; 
-  nr = get_str( fd, buf, n ) ;
-  --in_This ;
-  push( (Cell_t) buf ) ;
-  push( (Cell_t) nr ) ;
-  return ;
+  J( "\x49\x8d\x87" ) ;				// lea rax,[r15+n*8]
+  jit_u32( n * sizeof( Cell_t ) ) ;
+  J( "\x48\x39\xc3" ) ;				// cmp rbx,rax
+  p = jit_fwd8( "\x73" ) ;			// jae
+  J( X_SAVE ) ;
+  jit_imm( X_RDI, (Cell_t) wp ) ;
+  jit_call( jit_underflow ) ;
+  jit_jump( "\xe9", jit_L + 1 ) ;
+  jit_land8( p ) ;
+#endif
 }
+
+void jit_checked_call( void *fn )
+{
+  uByt_t *p ;
+
+  J( X_SAVE ) ;
+  jit_call( fn ) ;
+  jit_imm( X_RAX, (Cell_t) &error_code ) ;
+  J( "\x83\x38\x00" ) ;				// cmp dword [rax],0
+  p = jit_fwd8( "\x74" ) ;
+  jit_call( catch ) ;
+  jit_land8( p ) ;
+  J( X_LOAD ) ;
+}
+
+// a backward branch checks for timers due, as the threaded code does
+void jit_safe( uByt_t op, Cell_t *target, Cell_t *ip )
+{
+#ifdef TIMERS
+  uByt_t *p ;
+
+  switch( op ){
+    case op_Tail:		// may well loop round
+      target = ip ;
+    case op_Branch:
+    case op_QBranch:
+    case op_DupBr:
+    case op_LoopBr:
+    case op_PLoopBr:
+    case op_LitEqBr:
+    case op_LitNeBr:
+    case op_LitLtBr:
+    case op_LitGtBr:
+      if( target <= ip ){
+        jit_imm( X_RAX, (Cell_t) &tm_Due ) ;
+        J( "\x83\x38\x00" ) ;			// cmp dword [rax],0
+        p = jit_fwd8( "\x74" ) ;
+        jit_checked_call( tm_poll ) ;
+        jit_land8( p ) ;
+      }
+  }
 #endif
+}
 
-void opentty()	// ( str -- fd )
-{
-#ifdef HOSTED
-#if !defined(__WIN32__)
-  Str_t fn ;
-  Wrd_t rv, fd ;
-  struct termios tty_state ;
+Cell_t jit_operands( uByt_t op )
+{
+  switch( op ){
+    case op_LitEqBr:
+    case op_LitNeBr:
+    case op_LitLtBr:
+    case op_LitGtBr:
+      return 2 ;
+    case op_Literal:
+    case op_Branch:
+    case op_QBranch:
+    case op_LitAdd:
+    case op_LitSub:
+    case op_LitEq:
+    case op_LitNe:
+    case op_LitLt:
+    case op_LitGt:
+    case op_DupBr:
+    case op_LoopBr:
+    case op_PLoopBr:
+    case op_VarFetch:
+    case op_VarStore:
+    case op_Tail:
+      return 1 ;
+  }
+  return 0 ;
+}
 
-  chk( 1 ) ; 
+// a word from the thread which has no opcode of its own ...
+void jit_word( Dict_t *dp, Dict_t *wp, uByt_t *start )
+{
+  uByt_t *p ;
 
-  fn = (Str_t) pop() ;
-  if( !isNul( fn ) ){
-    fd = open( fn, O_RDWR | O_NDELAY | O_NONBLOCK | O_NOCTTY ) ;
-    if( fd < 0 ){
-      throw( err_SysCall ) ;
-      return ;
-    }
-    rv = tcgetattr( fd, &tty_state ) ;
-    cfsetspeed( &tty_state, B115200 ) ; 
-    tty_state.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG ) ;
-    cfmakeraw( &tty_state ) ; 
-    rv = tcsetattr( fd, TCSANOW, &tty_state ) ;
-    if( rv < 0 ){
-      throw( err_SysCall ) ;
-      return ;
+  if( dp == wp ){				// recursion
+    J( X_SAVE ) ;
+    J( "\xe8" ) ;
+    jit_u32( (uint32_t) (start - (jit_P + 4)) ) ;
+    J( X_LOAD ) ;
+    return ;
+  }
+  if( !isNul( dp ->pfa ) ){
+    if( dp ->cfa == pushPfa ){
+      jit_imm( X_RAX, (Cell_t) dp ->pfa ) ;
+      J( X_PUSH_RAX ) ;
+    } else if( dp ->cfa == doConstant ){
+      jit_imm( X_RAX, (Cell_t) dp ->pfa ) ;
+      J( "\x48\x8b\x00" ) ;			// mov rax,[rax]
+      J( X_PUSH_RAX ) ;
+    } else if( dp ->op == op_Jit && jit_Mine( dp ) ){
+      J( X_SAVE ) ;
+      jit_call( dp ->jit ) ;
+      J( X_LOAD ) ;
+    } else {
+      J( X_SAVE ) ;
+      jit_imm( X_RDI, (Cell_t) dp ) ;
+      jit_call( jit_exec ) ;
+      J( X_LOAD ) ;
     }
-  } 
-  push( fd ) ; 
-#endif
-#endif
+    return ;
+  }
+
+  if( dp ->cfa == And || dp ->cfa == or || dp ->cfa == xor ){
+    jit_need( 2, wp ) ;
+    J( X_POP_RAX ) ;
+    if( dp ->cfa == And ) J( "\x48\x21\x03" ) ;	// and [rbx],rax
+    if( dp ->cfa == or ) J( "\x48\x09\x03" ) ;
+    if( dp ->cfa == xor ) J( "\x48\x31\x03" ) ;
+  } else if( dp ->cfa == and ){			// logical
+    jit_need( 2, wp ) ;
+    J( X_POP_RAX ) ;
+    J( "\x31\xc9\x48\x85\xc0" ) ;		// xor ecx,ecx ; test rax,rax
+    p = jit_fwd8( "\x74" ) ;
+    J( "\x48\x83\x3b\x00\x0f\x95\xc1" ) ;	// cmp qword [rbx],0 ; setne cl
+    jit_land8( p ) ;
+    J( X_RCX_TOS ) ;
+  } else if( dp ->cfa == not ){
+    jit_need( 1, wp ) ;
+    J( "\x48\xf7\x13" ) ;			// not qword [rbx]
+  } else if( dp ->cfa == lft_shift || dp ->cfa == rgt_shift ){
+    jit_need( 2, wp ) ;
+    J( X_POP_RCX ) ;
+    if( dp ->cfa == lft_shift )
+      J( "\x48\xd3\x23" ) ;			// shl qword [rbx],cl
+    else
+      J( "\x48\xd3\x3b" ) ;			// sar qword [rbx],cl
+  } else if( dp ->cfa == mult ){
+    jit_need( 2, wp ) ;
+    J( X_POP_RAX ) ;
+    J( "\x48\x0f\xaf\x03\x48\x89\x03" ) ;	// imul rax,[rbx] ; mov [rbx],rax
+  } else {
+    jit_checked_call( dp ->cfa ) ;
+  }
 }
 
-void closetty() // ( fd -- )
+Cell_t jit_init( void )
 {
-#ifdef HOSTED
-  chk( 1 ) ; 
-  close( (Wrd_t) pop() ) ;
-#endif
+  jit_Base = (uByt_t *) mmap( NULL, sz_JIT, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) ;
+  if( jit_Base == (uByt_t *) MAP_FAILED ){
+    jit_Base = NULL ;
+    return 0 ;
+  }
+  jit_Here = jit_Base ;
+  return 1 ;
 }
 
-void infile()
+void jit_release( void )
 {
-  chk( 1 ) ;
+  if( !isNul( jit_Base ) ){
+    madvise( jit_Base, sz_JIT, MADV_DONTNEED ) ;
+    jit_Here = jit_Base ;
+  }
+}
 
-  Str_t fn = (Str_t) pop() ;
+Fptr_t jit_compile( Dict_t *wp )
+{
+  Cell_t *ip, *pfa, *target, n, k, i ;
+  Dict_t *dp ;
+  uByt_t *start, op, cc ;
+  Fptr_t code = NULL ;
 
-  if( isMatch( fn, "stdin" ) ) // intialize ...
-  {
-	in_This = 0 ;
-	InputStack[ in_This ].file = 0 ; 
-	InputStack[ in_This ].bytes_read = -1 ; 
-	InputStack[ in_This ].bytes_this = -1 ; 
-	InputStack[ in_This ].in_line = 0 ; 
-	InputStack[ in_This ].name = str_cache( fn ) ;
-	InputStack[ in_This ].bytes = (Str_t) inbuf[ in_This ] ; 
-	return ;
+  if( wp ->cfa != doColon || isNul( wp ->pfa ) ){
+    return NULL ;
+  }
+  if( wp < Colon_Defs || wp >= &Colon_Defs[ n_ColonDefs ] ){	// shared, see off_create()
+    return NULL ;
+  }
+  if( wp ->op == op_Jit ){
+    return jit_Mine( wp ) ? wp ->jit : NULL ;
+  }
+  if( isNul( jit_Base ) && !jit_init() ){
+    return NULL ;
   }
 
-#ifdef HOSTED
-
-  if( in_This < sz_FILES ) // push a new input file ...
-  {
-	if( !isNul( fn ) )
-	{
-		in_This += 1 ;
-		InputStack[ in_This ].bytes_read = -1 ; 
-		InputStack[ in_This ].bytes_this = -1 ; 
-		InputStack[ in_This ].in_line = 0 ; 
-		InputStack[ in_This ].name = str_cache( fn ) ;
-		InputStack[ in_This ].bytes = (Str_t) inbuf[ in_This ] ; 
-		InputStack[ in_This ].file = open( InputStack[ in_This ].name , O_RDONLY ) ;
+  pfa = wp ->pfa ;				// find the end, and anything
+  for( ip = pfa ; !isNul( (Dict_t *) *ip ) ; ){	// we would rather not touch
+    dp = (Dict_t *) *ip ;
+    if( ip - pfa >= sz_JITMAP || dp ->cfa == does ){
+      return NULL ;
+    }
+#ifdef PARDO
+    if( dp ->cfa == par_do ){			// its body ends in a 0
+      return NULL ;
+    }
+#endif
+    ip += 1 + jit_operands( dp ->op ) ;
+  }
+  jit_L = ip - pfa ;
+  if( jit_Here + (jit_L + 4) * 96 + 64 > jit_Base + sz_JIT ){
+    return NULL ;
+  }
 
-		if( InputStack[ in_This ].file < 0 )
-		{
-			str_uncache( fn ) ;
-			if( !isNul( off_path ) ) // add the file path and try again ...
-			{
-				Str_t buf = tb_get( TB ) ;
-				str_format( buf, tb_bufsize( TB ), "%s/%s", (Str_t) off_path, (Str_t) fn ) ;
-    				InputStack[ in_This ].name = str_cache( (Str_t) buf ) ;
-				InputStack[ in_This ].file = open( InputStack[ in_This ].name , O_RDONLY ) ;
-			} 
-		}
+  mprotect( jit_Base, sz_JIT, PROT_READ | PROT_WRITE ) ;
+  start = jit_P = jit_Here ;
+  jit_nFix = 0 ;
+  J( "\x53\x41\x54\x41\x55\x41\x56\x41\x57" ) ;	// push rbx r12 r13 r14 r15
+  jit_imm( "\x49\xbd", (Cell_t) &tos ) ;
+  jit_imm( "\x49\xbe", (Cell_t) &rtos ) ;
+  jit_imm( "\x49\xbf", (Cell_t) &stack ) ;
+  J( "\x4d\x8b\x3f" ) ;				// mov r15,[r15] (tasks have their own)
+  J( X_LOAD ) ;
+
+  for( k = 0 ; k < jit_L ; ){
+    ip = pfa + k ;
+    dp = (Dict_t *) *ip ;
+    op = dp ->op ;
+    jit_Map[ k ] = jit_P - start ;
+    n = jit_operands( op ) ;
+    for( i = 1 ; i <= n ; i++ ){
+      jit_Map[ k + i ] = jit_NoTarget ;
+    }
+    target = (Cell_t *) ip[ n ] ;		// the branch, when there is one
+    k += 1 + n ;
+    jit_safe( op, target, ip ) ;
+
+    switch( op ){
+      case op_Literal:
+        jit_imm( X_RAX, ip[1] ) ;
+        J( X_PUSH_RAX ) ;
+        break ;
+      case op_Branch:
+        jit_jump( "\xe9", target - pfa ) ;
+        break ;
+      case op_QBranch:
+        J( X_POP_RAX ) ;
+        J( "\x48\x85\xc0" ) ;			// test rax,rax
+        jit_jump( "\x0f\x84", target - pfa ) ;
+        break ;
+      case op_Do:
+        jit_need( 2, wp ) ;
+        J( "\x48\x8b\x03\x48\x8b\x4b\xf8\x48\x83\xeb\x10" ) ;	// rax = start, rcx = end
+        J( "\x49\x83\xc4\x08\x49\x89\x0c\x24" ) ;		// rpush rcx
+        J( "\x49\x83\xc4\x08" X_RAX_RTOS ) ;			// rpush rax
+        break ;
+      case op_Loop:
+      case op_LoopBr: {
+        uByt_t *done, *next ;
+
+        J( X_RTOS_RAX "\x48\xff\xc0" X_CMP_RNOS ) ;		// inc rax ; cmp
+        done = jit_fwd8( "\x7d" ) ;				// jge
+        J( X_RAX_RTOS ) ;
+        if( op == op_LoopBr ){
+          jit_jump( "\xe9", target - pfa ) ;
+          jit_land8( done ) ;
+          J( X_RDROP2 ) ;
+        } else {
+          J( "\x48\x83\xc3\x08\x48\xc7\x03\x00\x00\x00\x00" ) ;	// push 0
+          next = jit_fwd8( "\xeb" ) ;
+          jit_land8( done ) ;
+          J( X_RDROP2 ) ;
+          J( "\x48\x83\xc3\x08\x48\xc7\x03\x01\x00\x00\x00" ) ;	// push 1
+          jit_land8( next ) ;
+        }
+        break ;
+      }
+      case op_PLoop:
+      case op_PLoopBr: {
+        uByt_t *neg, *up, *down, *out, *end ;
 
-		if( InputStack[ in_This ].file < 0 )
-		{
-			in_This-- ;
-			throw( err_NoFile ) ;
-		}
-	}
+        if( op == op_PLoopBr ){
+          jit_need( 1, wp ) ;
+        }
+        J( X_POP_RCX X_RTOS_RAX "\x48\x01\xc8\x48\x85\xc9" ) ;	// add rax,rcx ; test rcx,rcx
+        neg = jit_fwd8( "\x7e" ) ;				// jle
+        J( X_CMP_RNOS ) ;
+        up = jit_fwd8( "\x7c" ) ;				// jl
+        out = jit_fwd8( "\xeb" ) ;
+        jit_land8( neg ) ;
+        J( X_CMP_RNOS ) ;
+        down = jit_fwd8( "\x7f" ) ;				// jg
+        jit_land8( out ) ;
+        J( X_RDROP2 ) ;
+        if( op == op_PLoop ){
+          J( "\x48\x83\xc3\x08\x48\xc7\x03\x01\x00\x00\x00" ) ;
+        }
+        end = jit_fwd8( "\xeb" ) ;
+        jit_land8( up ) ;
+        jit_land8( down ) ;
+        J( X_RAX_RTOS ) ;
+        if( op == op_PLoop ){
+          J( "\x48\x83\xc3\x08\x48\xc7\x03\x00\x00\x00\x00" ) ;
+        } else {
+          jit_jump( "\xe9", target - pfa ) ;
+        }
+        jit_land8( end ) ;
+        break ;
+      }
+      case op_I:
+        J( X_RTOS_RAX X_PUSH_RAX ) ;
+        break ;
+      case op_Leave:
+        jit_jump( "\xe9", jit_L ) ;
+        break ;
+      case op_ToR:
+        jit_need( 1, wp ) ;
+        J( X_POP_RAX "\x49\x83\xc4\x08" X_RAX_RTOS ) ;
+        break ;
+      case op_RFrom:
+        J( X_RTOS_RAX "\x49\x83\xec\x08" X_PUSH_RAX ) ;
+        break ;
+      case op_Add:
+        jit_need( 2, wp ) ;
+        J( X_POP_RAX "\x48\x01\x03" ) ;
+        break ;
+      case op_Sub:
+        jit_need( 2, wp ) ;
+        J( X_POP_RAX "\x48\x29\x03" ) ;
+        break ;
+      case op_Dup:
+        jit_need( 1, wp ) ;
+        J( "\x48\x8b\x03" X_PUSH_RAX ) ;
+        break ;
+      case op_Drop:
+        jit_need( 1, wp ) ;
+        J( "\x48\x83\xeb\x08" ) ;
+        break ;
+      case op_Swap:
+        jit_need( 2, wp ) ;
+        J( "\x48\x8b\x03\x48\x8b\x4b\xf8\x48\x89\x0b\x48\x89\x43\xf8" ) ;
+        break ;
+      case op_Over:
+        jit_need( 2, wp ) ;
+        J( "\x48\x8b\x43\xf8" X_PUSH_RAX ) ;
+        break ;
+      case op_Inc:
+        J( "\x48\x83\x03\x01" ) ;
+        break ;
+      case op_Dec:
+        J( "\x48\x83\x2b\x01" ) ;
+        break ;
+      case op_Eq:
+      case op_Ne:
+      case op_Lt:
+      case op_Gt:
+      case op_LitEq:
+      case op_LitNe:
+      case op_LitLt:
+      case op_LitGt:
+        if( op >= op_LitEq ){
+          jit_need( 1, wp ) ;
+          jit_imm( X_RAX, ip[1] ) ;
+        } else {
+          jit_need( 2, wp ) ;
+          J( X_POP_RAX ) ;
+        }
+        cc = (op == op_Eq || op == op_LitEq) ? 0x94 : (op == op_Ne || op == op_LitNe) ? 0x95 :
+             (op == op_Lt || op == op_LitLt) ? 0x9c : 0x9f ;
+        J( X_CMP_SET "\x0f" ) ;
+        jit_emit( &cc, 1 ) ;
+        J( "\xc1" X_RCX_TOS ) ;			// setcc cl ; mov [rbx],rcx
+        break ;
+      case op_Fetch: {
+        uByt_t *ok ;
+
+        jit_need( 1, wp ) ;
+        J( "\x48\x8b\x03\x48\x85\xc0" ) ;
+        ok = jit_fwd8( "\x75" ) ;
+        J( "\x48\x83\xeb\x08" ) ;
+        jit_fault( err_NullPtr ) ;
+        jit_land8( ok ) ;
+        J( "\x48\x8b\x00\x48\x89\x03" ) ;
+        break ;
+      }
+      case op_Store: {
+        uByt_t *ok ;
+
+        jit_need( 2, wp ) ;
+        J( "\x48\x8b\x03\x48\x85\xc0" ) ;
+        ok = jit_fwd8( "\x75" ) ;
+        J( "\x48\x83\xeb\x10" ) ;
+        jit_fault( err_NullPtr ) ;
+        jit_land8( ok ) ;
+        J( "\x48\x8b\x4b\xf8\x48\x89\x08\x48\x83\xeb\x10" ) ;
+        break ;
+      }
+      case op_LitAdd:
+      case op_LitSub:
+        jit_need( 1, wp ) ;
+        jit_imm( X_RAX, ip[1] ) ;
+        if( op == op_LitAdd )
+          J( "\x48\x01\x03" ) ;
+        else
+          J( "\x48\x29\x03" ) ;
+        break ;
+      case op_LitEqBr:
+      case op_LitNeBr:
+      case op_LitLtBr:
+      case op_LitGtBr:
+        jit_need( 1, wp ) ;
+        J( X_POP_RCX ) ;
+        jit_imm( X_RAX, ip[1] ) ;
+        J( "\x48\x39\xc1" ) ;			// cmp rcx,rax
+        jit_jump( (op == op_LitEqBr) ? "\x0f\x85" : (op == op_LitNeBr) ? "\x0f\x84" :
+                  (op == op_LitLtBr) ? "\x0f\x8d" : "\x0f\x8e", target - pfa ) ;
+        break ;
+      case op_DupBr:
+        jit_need( 1, wp ) ;
+        J( "\x48\x83\x3b\x00" ) ;
+        jit_jump( "\x0f\x84", target - pfa ) ;
+        break ;
+      case op_VarFetch:
+        jit_imm( X_RAX, (Cell_t) ((Dict_t *) ip[1]) ->pfa ) ;
+        J( "\x48\x8b\x00" X_PUSH_RAX ) ;
+        break ;
+      case op_VarStore:
+        jit_need( 1, wp ) ;
+        J( X_POP_RCX ) ;
+        jit_imm( X_RAX, (Cell_t) ((Dict_t *) ip[1]) ->pfa ) ;
+        J( "\x48\x89\x08" ) ;
+        break ;
+      case op_Execute:
+        jit_checked_call( execute ) ;
+        break ;
+      case op_Tail:
+        if( (Dict_t *) ip[1] == wp ){
+          jit_jump( "\xe9", 0 ) ;
+        } else {
+          jit_word( (Dict_t *) ip[1], wp, start ) ;
+          jit_jump( "\xe9", jit_L ) ;
+        }
+        break ;
+      default:
+        jit_word( dp, wp, start ) ;
+        break ;
+    }
+  }
 
-	return ;
+  jit_Map[ jit_L ] = jit_P - start ;
+  J( X_SAVE ) ;
+  jit_Map[ jit_L + 1 ] = jit_P - start ;
+  J( "\x41\x5f\x41\x5e\x41\x5d\x41\x5c\x5b\xc3" ) ;	// pop r15 .. rbx ; ret
 
-  } 
+  for( i = 0 ; i < jit_nFix ; i++ ){
+    k = jit_Fix[ i ].idx ;
+    if( k < 0 || k > jit_L + 1 || jit_Map[ k ] == jit_NoTarget ){
+      goto done ;
+    }
+    n = (start + jit_Map[ k ]) - (jit_Fix[ i ].at + 4) ;
+    str_copy( (Str_t) jit_Fix[ i ].at, (Str_t) &n, 4 ) ;
+  }
 
-  throw( err_InStack ) ;
-  return ;
+  code = (Fptr_t) start ;
+  jit_Here = (uByt_t *) (((Cell_t) jit_P + 15) & ~15) ;
+  wp ->jit = code ;
+  wp ->op = op_Jit ;
 
-#endif
+done:
+  mprotect( jit_Base, sz_JIT, PROT_READ | PROT_EXEC ) ;
+  return code ;
 }
+#endif
 
-void filename()
+void jit() // ( xt -- f )
 {
-	push( (Str_t) InputStack[ in_This ].name ) ;
+#ifdef JIT
+  Dict_t *dp ;
+
+  chk( 1 ) ;
+  dp = (Dict_t *) pop() ;
+  push( !isNul( dp ) && !isNul( jit_compile( dp ) ) ) ;
+#else
+  chk( 1 ) ;
+  *tos = 0 ;
+#endif
 }
 
-void outfile()
+void jit_auto() // ( -- adr )
+{
+#ifdef JIT
+  push( (Cell_t) &Jit_Auto ) ;
+#else
+  static Cell_t off = 0 ;
+
+  push( (Cell_t) &off ) ;
+#endif
+}
+
+// a colon word compiled last, with nothing branching past it, becomes
+// (tail) word so that it runs without nesting ...
+void tail_call( void )
+{
+  Dict_t *dp ;
+
+  if( !Fusion || peep_Here != Here || peep_Last != Here - 1 ){
+    return ;
+  }
+  dp = (Dict_t *) *peep_Last ;
+  if( dp ->cfa != doColon || isNul( dp ->pfa ) ){
+    return ;
+  }
+  *peep_Last = (Cell_t) lookup( "(tail)" ) ;
+  push( (Cell_t) dp ) ;
+  comma() ;
+  peep_barrier() ;
+}
+
+void semicolon()
+{
+
+  if( state != state_Compiling ){
+    throw( err_BadState );
+    return ;
+  }
+  tail_call() ;
+  push( 0 ) ; /* next is NULL */
+  comma() ;
+  --promptVal ;
+  state = state_Interactive ;
+  stk_effect( &Colon_Defs[n_ColonDefs-1] ) ;
+#ifdef TOKENS
+  tok_pack( &Colon_Defs[n_ColonDefs-1] ) ;
+#endif
+#ifdef JIT
+  if( Jit_Auto ){
+    jit_compile( &Colon_Defs[n_ColonDefs-1] ) ;
+  }
+#endif
+}
+
+void tick()
+{
+  Str_t tkn ; 
+
+  chk( 0 ) ; 
+  word() ;
+  tkn = (Str_t) pop() ;
+  push( (Cell_t) lookup( tkn ) ) ;
+  if( *tos == 0 ){
+    put_str( tkn ) ;
+    throw( err_NoWord ) ;
+  }
+  if( state == state_Compiling )
+  {
+    emit_lit( pop() ) ;
+  }
+}
+
+void nfa()
+{
+  Dict_t *dp ;
+
+  chk( 1 ) ; 
+  dp = (Dict_t *) pop();
+  push( (Cell_t) dp ->nfa ) ;
+}
+
+void cfa()
+{
+  Dict_t *dp ;
+
+  chk( 1 ) ; 
+  dp = (Dict_t *) pop();
+  push( (Cell_t) dp ->cfa ) ;
+}
+
+void pfa()
+{
+  Dict_t *dp ;
+
+  chk( 1 ) ; 
+  dp = (Dict_t *) pop() ;
+  push( (Cell_t) dp ->pfa ) ;
+}
+
+void decimal()
+{
+  Base = 10 ; 
+}
+
+void hex()
+{
+  Base = 16 ; 
+}
+
+void sigvar()
 {
 #ifdef HOSTED
-  Str_t fn ;
-  Cell_t fd, fexists ;
-  uCell_t fflg = O_CREAT | O_RDWR | O_APPEND ;
+  push( (Cell_t) &sigval ); 
+#endif
+}
+
+void errvar()
+{
+  push( (Cell_t) &error_code ); 
+}
+
+void errval()
+{
+  errvar();
+  wrd_fetch();
+}
+
+void errstr()
+{
+
+  register Cell_t err = pop() ;
+
+  if( err >= err_OK && err <= err_Undefined )
+     push( errors[ err ] ) ;
+  else
+     throw( err_Range ) ;
+  return ;
+}
+
+void errmax()
+{
+  push( err_Undefined ) ;
+}
+
+// the last error caught, after the reset that followed it; reading
+// it clears it, so a test can look for the one it provoked ...
+void errlast()
+{
+  push( error_last ) ;
+  error_last = err_OK ;
+}
+
+void ring_on() // ( -- )
+{
+  Trace |= trc_Ring ;
+}
+
+void ring_off() // ( -- )
+{
+  Trace &= ~trc_Ring ;
+}
+
+void dotring() // ( n -- )
+{
+  chk( 1 ) ;
+  tr_dump( pop() ) ;
+}
+
+// a copy of the last n entries, oldest first, 4 cells each of word,
+// depth, top and clock ...
+void ring_snap() // ( addr n -- m )
+{
+  Cell_t *a, n, i ;
+  Trace_t *t ;
+
+  chk( 2 ) ;
+  n = pop() ;
+  a = (Cell_t *) pop() ;
+  n = (n < (Cell_t) tr_Next) ? n : (Cell_t) tr_Next ;
+  n = (n < sz_RING) ? n : sz_RING ;
+  for( i = 0 ; i < n ; i++, a += 4 ){
+    t = &tr_Ring[ (tr_Next - n + i) & (sz_RING - 1) ] ;
+    a[0] = (Cell_t) t ->tr_dp ;
+    a[1] = t ->tr_depth ;
+    a[2] = t ->tr_top ;
+    a[3] = (Cell_t) t ->tr_clock ;
+  }
+  push( (n > 0) ? n : 0 ) ;
+}
+
+#ifdef HOSTED
+// the ring to a file, oldest first, in records of a fixed size which
+// carry the word's name, for reading elsewhere ...
+typedef struct {
+  uint64_t tf_clock ;
+  int64_t  tf_depth ;
+  int64_t  tf_top ;
+  char     tf_name[ 24 ] ;
+} Trace_File_t ;
+
+void ring_save() // ( <file> -- )
+{
+  Trace_File_t rec ;
+  Trace_t *t ;
+  uCell_t i, n ;
+  Wrd_t fd, len ;
+  Str_t fn, nm ;
 
+  word() ;
   fn = (Str_t) pop() ;
-  if( !isNul( fn ) ){
-#if !defined( __WIN32__ )
-    uCell_t fprm = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH ;
-    fd = open( fn, fflg, fprm ) ;
+  fd = open( fn, O_CREAT | O_WRONLY | O_TRUNC, 0644 ) ;
+  if( fd < 0 ){
+    throw( err_NoFile ) ;
+    return ;
+  }
+  n = (tr_Next < sz_RING) ? tr_Next : sz_RING ;
+  for( i = tr_Next - n ; i != tr_Next ; i++ ){
+    t = &tr_Ring[ i & (sz_RING - 1) ] ;
+    str_set( (Str_t) &rec, 0, sizeof( rec ) ) ;
+    rec.tf_clock = t ->tr_clock ;
+    rec.tf_depth = t ->tr_depth ;
+    rec.tf_top = t ->tr_top ;
+    nm = isNul( t ->tr_dp ) ? "next" : t ->tr_dp ->nfa ;
+    len = str_length( nm ) ;
+    str_copy( rec.tf_name, nm, (len < (Wrd_t) sizeof( rec.tf_name )) ? len : sizeof( rec.tf_name ) - 1 ) ;
+    if( out_write( fd, (Str_t) &rec, sizeof( rec ) ) != sizeof( rec ) ){
+      close( fd ) ;
+      throw( err_SysCall ) ;
+      return ;
+    }
+  }
+  close( fd ) ;
+}
+#endif
+
+void trace()
+{
+  push( (Cell_t) &Trace ); 
+}
+
+void base()
+{
+  push( (Cell_t) &Base ); 
+}
+
+void resetter()
+{
+  put_str( "-- Warm start." ) ; cr();
+  q_reset() ;
+#ifdef HOSTED
+  longjmp( env, rst_user ) ;
+#endif
+}
+
+void cold()
+{
+  put_str( "-- Cold start." ) ; cr();
+  q_reset() ;
+  forget() ;
+#ifdef HOSTED
+  longjmp( env, rst_coldstart ) ;
 #else
-    fd = open( fn, fflg ) ;
 #endif
-    if( fd < 0 ){
-      throw( err_NoFile ) ;
+}
+
+void see()
+{
+  register Dict_t *p, *r ; 
+  Fusion_t *fp ;
+  Cell_t *ptr, n ; 
+
+  chk( 1 ) ; 
+
+  p = (Dict_t *) pop() ;
+  if( isNul( p ->pfa ) ){
+    n = fmt_out( "-- %s (%x) flg: %d is coded in C (%x).\n", p ->nfa, p, p->flg, p ->cfa ) ;
+    return ;
+  } else {
+    if( p ->cfa == (Fptr_t) doConstant ){
+      n = fmt_out( "-- %s constant value (0x%x).\n", p ->nfa, *p->pfa ) ;
+      return ;
+    }
+    if( p ->cfa == (Fptr_t) pushPfa ){
+      n = fmt_out( "-- %s variable value (0x%x).\n", p ->nfa, *p->pfa ) ;
+      return ;
+    }
+    if( p ->cfa == (Fptr_t) doNative ){
+      n = fmt_out( "-- %s native (0x%x) takes %d args.\n", p ->nfa, *p->pfa, p ->pfa[1] ) ;
+      return ;
+    }
+    n = fmt_out( "-- %s (%x) word flg: %d.\n", p ->nfa, p, p->flg ) ;
+    if( p ->op == op_Jit ){
+      n = fmt_out( "-- jitted to native code at %x.\n", p ->jit ) ;
+    }
+    if( eff_Known( p ) ){
+      n = fmt_out( "-- takes %d leaves %d.\n", eff_In( p ), eff_Out( p ) ) ;
+    }
+#ifdef TOKENS
+    if( p ->cfa == (Fptr_t) doTokens ){
+      tok_see( p ) ;
       return ;
     }
-    out_files[++out_This] = fd ;
-    return ;
-  } 
 #endif
+  }
+  ptr = p ->pfa ; 
+  while( !isNul( ptr ) ){
+    r = (Dict_t *) *ptr ;
+    if( isNul( r ) ){			/* next == NULL */
+      n = fmt_out( "%x  next\n", ptr ) ;
+      break ;
+    }
+    Str_t buf = tb_get( TB ) ;
+    fp = fuse_find( r ->cfa ) ;
+    if( !isNul( fp ) ){
+      switch( fp ->kind ){
+        case fz_Lit:
+          n = str_format( buf, tb_bufsize( TB ), "%x  %s %d\n", ptr, r ->nfa, *(ptr+1) ) ;
+          ptr++ ;
+          break ;
+        case fz_LitBranch:
+          n = str_format( buf, tb_bufsize( TB ), "%x  %s %d -> %x\n", ptr, r ->nfa, *(ptr+1), *(ptr+2) ) ;
+          ptr += 2 ;
+          break ;
+        case fz_Branch:
+          n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", ptr, r ->nfa, *(ptr+1) ) ;
+          ptr++ ;
+          break ;
+        case fz_Var:
+          n = str_format( buf, tb_bufsize( TB ), "%x  %s %s\n", ptr, r ->nfa, ((Dict_t *) *(ptr+1)) ->nfa ) ;
+          ptr++ ;
+          break ;
+      }
+    } else if( r ->cfa  == (Fptr_t) branch ){
+      n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", ptr, r ->nfa, *(ptr+1) ) ;
+      ptr++ ;
+    } else  if( r ->cfa  == (Fptr_t) q_branch ){
+      n = str_format( buf, tb_bufsize( TB ), "%x  %s -> %x\n", ptr, r ->nfa, *(ptr+1) ) ;
+      ptr++ ;
+    } else if( r ->cfa  == (Fptr_t) tail ){
+      n = str_format( buf, tb_bufsize( TB ), "%x  %s %s\n", ptr, r ->nfa, ((Dict_t *) *(ptr+1)) ->nfa ) ;
+      ptr++ ;
+    } else if( r ->cfa  == (Fptr_t) doLiteral ){
+      n = str_format( buf, tb_bufsize( TB ), "%x  %s = %d\n", ptr, r ->nfa, *(ptr+1) ) ;
+      ptr++ ;
+    } else {
+      n = str_format( buf, tb_bufsize( TB ), "%x  %s\n", ptr, r ->nfa ) ;
+    }
+    outp( OUTPUT, (Str_t) buf, n ) ;
+    ptr++ ;
+  }
+}
+
+/*
+  -- I/O routines --
+
+  must be written for the Atmel AVR's, but
+  any HOSTED (Linux/Unix/Windows) system can simply use read/write.
+  key and ?key are special cases (len == 1), 
+  and cbreak has been added for processing for tty's.
+
+  For Native ARM based systems, we will be implementing uart put/get functions
+  and a get without echo (for key) ... 
+
+*/
+
+Wrd_t fmt_out( Str_t fmt, ... )
+{
+  va_list  ap ;
+  Wrd_t    nx, siz ;
+  Str_t    buf = tb_get( TB );
+
+  siz = tb_bufsize( TB ) ;
+  va_start( ap, fmt );
+   nx = str_format_ap( buf, siz, fmt, ap ) ;
+  va_end( ap ) ;
+
+  outp( OUTPUT, buf, nx );
+  return nx ;
+}
+
+// straight to fd 2, for what goes wrong before the VM is set up ...
+Wrd_t err_out( Str_t fmt, ... )
+{
+  va_list  ap ;
+  Wrd_t    nx ;
+  Byt_t    buf[ 256 ] ;
+
+  va_start( ap, fmt );
+  nx = str_format_ap( (Str_t) buf, sizeof( buf ), fmt, ap ) ;
+  va_end( ap ) ;
+
+  return write( 2, buf, nx ) ;
+}
+
+Wrd_t put_str( Str_t s )
+{
+  register Cell_t n = 0;
+
+  if( !isNul( s ) ){
+    n = str_length( s ) ; 
+    outp( OUTPUT, s, n ) ;
+    outp( OUTPUT, " ", 1 ) ;
+  }
+  return n ;
+}
+
+Wrd_t get_str( Wrd_t fd, Str_t buf, Wrd_t len )
+{
+  Byt_t ch ;
+  Wrd_t i, crlf = 0 ;
+
+  str_set( buf, 0, len ) ;
+
+  i = 0 ; 
+  do {
+    if( i > (len - 1) ){
+      return i ;
+    }
+
+    if( fd == INPUT ){
+      key() ; ch = pop() & 0xff ;
+    } else if( !io_wait( fd, -1 ) || inp( fd, (Str_t) &ch, 1 ) < 1 ){
+      ch = 0 ;
+    }
+    if( ch == 0 )
+    {
+      return i ;
+    }
+
+    if( ch_matches( ch, "\r\n" ) ){ 
+       crlf++ ;
+    }
+
+    buf[i++] = (Byt_t) ch ;
+
+  } while( crlf < 1 ) ;
+  return i ;
+}
+
+Wrd_t io_cbreak( int fd )
+{
+#if defined( HOSTED ) 
+#if !defined(__WIN32__)
+  static int inCbreak = v_Off ;
+  static struct termios tty_state, *tty_orig = (struct termios *) NULL ; 
+  int rv ;
+
+  if( isNul( tty_orig ) ){
+    rv = tcgetattr( fd, &tty_normal_state );
+    tty_orig = &tty_normal_state ;
+  } 
+
+  switch( inCbreak ){
+    case v_Off:
+      rv = tcgetattr( fd, &tty_state ) ;
+      cfmakeraw( &tty_state ) ;
+      rv = tcsetattr( fd, TCSANOW, &tty_state ) ; 
+      inCbreak = v_On ;
+      break ;
+    case v_On:
+      rv = tcsetattr( fd, TCSANOW, tty_orig ) ; 
+      inCbreak = v_Off ;
+  }
+  return inCbreak ;
+#endif
+#else
+  return v_On ;
+#endif
+}
+
+void waitrdy() // fd secs usecs -- flag )
+{
+#ifdef HOSTED
+#if !defined( __WIN32__ )
+  Wrd_t rv, fd, secs, usecs ;
+  fd_set fds ;
+  struct timeval tmo ;
+
+  usecs = pop() ;
+  secs = pop() ;
+  fd = pop() ;
+  if( io_busy() ){
+    push( io_wait( fd, (Cell_t) secs * 1000000 + usecs ) ) ;
+    return ;
+  }
+ 
+  FD_ZERO( &fds ) ;
+  FD_SET( fd, &fds ) ;
+
+  tmo.tv_sec = secs ;
+  tmo.tv_usec = usecs ;
+  rv = select( fd+1, &fds, NULL, NULL, &tmo ) ;  
+  if( rv < 0 ){
+    throw( err_SysCall ) ;
+  }
+  push( FD_ISSET( fd, &fds ) ) ;
+#endif
+#endif
+}
+
+void sndtty() // ( fd ptr -- nx )
+{
+  Str_t str ;
+  Wrd_t fd, len ;
+
+  chk( 2 ) ; 
+  
+  len = str_length( (Str_t) *tos ) ;
+  str = (Str_t) pop() ;
+  fd = pop() ;
+  push( (Cell_t) outp( fd, str, len ) ) ;
+}
+
+#ifdef HOSTED
+void rcvtty() // ( fd n -- buf n )
+{
+  Str_t buf ;
+  Wrd_t n, nr, fd ;
+
+  chk( 2 ) ; 
+
+  n = pop() ;
+  fd = pop() ;
+  here() ; buf = (Str_t) pop() + 8 * sizeof( Cell_t ) ;
+  nr = get_str( fd, buf, n ) ;
+  push( (Cell_t) buf ) ;
+  push( (Cell_t) nr ) ;
+  return ;
+}
+#endif
+
+void opentty()	// ( str -- fd )
+{
+#ifdef HOSTED
+#if !defined(__WIN32__)
+  Str_t fn ;
+  Wrd_t rv, fd ;
+  struct termios tty_state ;
+
+  chk( 1 ) ; 
+
+  fn = (Str_t) pop() ;
+  if( !isNul( fn ) ){
+    fd = open( fn, O_RDWR | O_NDELAY | O_NONBLOCK | O_NOCTTY ) ;
+    if( fd < 0 ){
+      throw( err_SysCall ) ;
+      return ;
+    }
+    rv = tcgetattr( fd, &tty_state ) ;
+    cfsetspeed( &tty_state, B115200 ) ; 
+    tty_state.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG ) ;
+    cfmakeraw( &tty_state ) ; 
+    rv = tcsetattr( fd, TCSANOW, &tty_state ) ;
+    if( rv < 0 ){
+      throw( err_SysCall ) ;
+      return ;
+    }
+  } 
+  push( fd ) ; 
+#endif
+#endif
+}
+
+void closetty() // ( fd -- )
+{
+#ifdef HOSTED
+  chk( 1 ) ; 
+  close( (Wrd_t) pop() ) ;
+#endif
+}
+
+#ifdef EVENTS
+/*
+  -- events: fds watched by one epoll (or kqueue) set per VM, each
+  with the xt run ( fd -- ) when it is ready, and non blocking
+  sockets to go with them.  Buffers are plain addresses, so data may
+  go straight to and from pad, here or a buffer of allot'd flash.
+
+	fd xt ev-read		( -- )  run xt when fd has input
+	fd xt ev-write		( -- )  or when it can take output
+	fd ev-del		( -- )  stop watching fd
+	msecs run-events	( -- n )  dispatch till idle for msecs
+*/
+Event_t *ev_find( Wrd_t fd )
+{
+  Cell_t i ;
+
+  for( i = 0 ; i < sz_EVENTS ; i++ ){
+    if( !isNul( Events[ i ].ev_xt ) && Events[ i ].ev_sock == fd ){
+      return &Events[ i ] ;
+    }
+  }
+  return (Event_t *) NULL ;
+}
+
+void ev_unwatch( Event_t *ep )
+{
+#if defined( __linux__ )
+  struct epoll_event ev ;
+
+  epoll_ctl( ev_Poll, EPOLL_CTL_DEL, ep ->ev_sock, &ev ) ;
+#else
+  struct kevent kev ;
+
+  EV_SET( &kev, ep ->ev_sock, ep ->ev_out ? EVFILT_WRITE : EVFILT_READ, EV_DELETE, 0, 0, NULL ) ;
+  kevent( ev_Poll, &kev, 1, NULL, 0, NULL ) ;
+#endif
+}
+
+void ev_watch( Wrd_t out )
+{
+  Dict_t *xt ;
+  Event_t *ep ;
+  Wrd_t fd, rv ;
+  Cell_t i ;
+
+  chk( 2 ) ;
+  xt = (Dict_t *) pop() ;
+  fd = pop() ;
+  if( ev_Poll < 0 ){
+#if defined( __linux__ )
+    ev_Poll = epoll_create1( EPOLL_CLOEXEC ) ;
+#else
+    ev_Poll = kqueue() ;
+#endif
+    if( ev_Poll < 0 ){
+      throw( err_SysCall ) ;
+      return ;
+    }
+  }
+  ep = ev_find( fd ) ;
+  if( isNul( ep ) ){
+    for( i = 0 ; i < sz_EVENTS && !isNul( Events[ i ].ev_xt ) ; i++ ) ;
+    if( i == sz_EVENTS ){
+      throw( err_NoSpace ) ;
+      return ;
+    }
+    ep = &Events[ i ] ;
+    n_Events++ ;
+  } else {
+    ev_unwatch( ep ) ;
+  }
+  ep ->ev_sock = fd ;
+  ep ->ev_xt = xt ;
+  ep ->ev_out = out ;
+#if defined( __linux__ )
+  struct epoll_event ev ;
+
+  ev.events = out ? EPOLLOUT : EPOLLIN ;
+  ev.data.u64 = ep - Events ;
+  rv = epoll_ctl( ev_Poll, EPOLL_CTL_ADD, fd, &ev ) ;
+#else
+  struct kevent kev ;
+
+  EV_SET( &kev, fd, out ? EVFILT_WRITE : EVFILT_READ, EV_ADD, 0, 0, (void *) (ep - Events) ) ;
+  rv = kevent( ev_Poll, &kev, 1, NULL, 0, NULL ) ;
+#endif
+  if( rv < 0 ){
+    ep ->ev_xt = (Dict_t *) NULL ;
+    n_Events-- ;
+    throw( err_SysCall ) ;
+  }
+}
+
+void ev_read() // ( fd xt -- )
+{
+  ev_watch( 0 ) ;
+}
+
+void ev_write() // ( fd xt -- )
+{
+  ev_watch( 1 ) ;
+}
+
+void ev_del() // ( fd -- )
+{
+  Event_t *ep ;
+
+  chk( 1 ) ;
+  ep = ev_find( (Wrd_t) pop() ) ;
+  if( !isNul( ep ) ){
+    ev_unwatch( ep ) ;
+    ep ->ev_xt = (Dict_t *) NULL ;
+    n_Events-- ;
+  }
+}
+
+// drop every watch, their xts are going (see forget()) ...
+void ev_reset( void )
+{
+  Cell_t i ;
+
+  for( i = 0 ; i < sz_EVENTS ; i++ ){
+    if( !isNul( Events[ i ].ev_xt ) ){
+      ev_unwatch( &Events[ i ] ) ;
+      Events[ i ].ev_xt = (Dict_t *) NULL ;
+    }
+  }
+  n_Events = 0 ;
+}
+
+void run_events() // ( msecs -- n )
+{
+  Cell_t msecs, wait, i, n, k, done = 0 ;
+  Event_t *ep ;
+#if defined( __linux__ )
+  struct epoll_event evs[ sz_EVENTS ] ;
+#else
+  struct kevent evs[ sz_EVENTS ] ;
+  struct timespec ts, *tp ;
+#endif
+
+  chk( 1 ) ;
+  msecs = pop() ;
+  while( n_Events > 0 ){
+    wait = io_busy() ? 0 : msecs ;
+    if( !io_wait( ev_Poll, (msecs < 0) ? -1 : msecs * 1000 ) ){
+      break ;
+    }
+#if defined( __linux__ )
+    n = epoll_wait( ev_Poll, evs, sz_EVENTS, wait ) ;
+#else
+    tp = (wait < 0) ? NULL : &ts ;
+    ts.tv_sec = wait / 1000 ;
+    ts.tv_nsec = (wait % 1000) * 1000000 ;
+    n = kevent( ev_Poll, NULL, 0, evs, sz_EVENTS, tp ) ;
+#endif
+    if( n < 0 && errno == EINTR ){
+      continue ;
+    }
+    if( n < 0 ){
+      throw( err_SysCall ) ;
+      return ;
+    }
+    if( n == 0 ){
+      break ;
+    }
+    for( k = 0 ; k < n ; k++ ){
+#if defined( __linux__ )
+      i = (Cell_t) evs[ k ].data.u64 ;
+#else
+      i = (Cell_t) evs[ k ].udata ;
+#endif
+      ep = &Events[ i ] ;
+      if( isNul( ep ->ev_xt ) ){	// dropped by an earlier callback
+        continue ;
+      }
+      push( ep ->ev_sock ) ;
+      push( (Cell_t) ep ->ev_xt ) ;
+      execute() ;
+      if( error_code != err_OK ){
+        return ;
+      }
+      done++ ;
+    }
+  }
+  push( done ) ;
+}
+
+// the address of host (a name or a number) and port ...
+Wrd_t sock_addr( Str_t host, Wrd_t port, Wrd_t type, struct sockaddr_in *sa )
+{
+  struct addrinfo hints, *res ;
+
+  str_set( (Str_t) sa, 0, sizeof( *sa ) ) ;
+  sa ->sin_family = AF_INET ;
+  sa ->sin_port = htons( port ) ;
+  if( isNul( host ) ){
+    sa ->sin_addr.s_addr = htonl( INADDR_ANY ) ;
+    return 1 ;
+  }
+  if( inet_pton( AF_INET, host, &sa ->sin_addr ) == 1 ){
+    return 1 ;
+  }
+  str_set( (Str_t) &hints, 0, sizeof( hints ) ) ;
+  hints.ai_family = AF_INET ;
+  hints.ai_socktype = type ;
+  if( getaddrinfo( host, NULL, &hints, &res ) != 0 ){
+    return 0 ;
+  }
+  sa ->sin_addr = ((struct sockaddr_in *) res ->ai_addr) ->sin_addr ;
+  freeaddrinfo( res ) ;
+  return 1 ;
+}
+
+// a non blocking socket, bound (listening for streams) or connected ...
+Wrd_t sock_open( Wrd_t family, Wrd_t type, struct sockaddr *sa, socklen_t len, Wrd_t bound )
+{
+  Wrd_t fd ;
+  int on = 1 ;
+
+  fd = socket( family, type, 0 ) ;
+  if( fd < 0 ){
+    throw( err_SysCall ) ;
+    return -1 ;
+  }
+  fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK ) ;
+  fcntl( fd, F_SETFD, FD_CLOEXEC ) ;
+  if( bound ){
+    setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof( on ) ) ;
+    if( bind( fd, sa, len ) < 0 || (type == SOCK_STREAM && listen( fd, SOMAXCONN ) < 0) ){
+      close( fd ) ;
+      throw( err_SysCall ) ;
+      return -1 ;
+    }
+  } else if( connect( fd, sa, len ) < 0 && errno != EINPROGRESS ){
+    close( fd ) ;
+    throw( err_SysCall ) ;
+    return -1 ;
+  }
+  return fd ;
+}
+
+void sock_inet( Wrd_t type, Wrd_t bound )
+{
+  struct sockaddr_in sa ;
+  Str_t host = (Str_t) NULL ;
+  Wrd_t port ;
+
+  chk( bound ? 1 : 2 ) ;
+  port = pop() ;
+  if( !bound ){
+    host = (Str_t) pop() ;
+  }
+  if( !sock_addr( host, port, type, &sa ) ){
+    throw( err_BadString ) ;
+    return ;
+  }
+  push( sock_open( AF_INET, type, (struct sockaddr *) &sa, sizeof( sa ), bound ) ) ;
+}
+
+void sock_unix( Wrd_t bound )
+{
+  struct sockaddr_un sa ;
+  Str_t path ;
+
+  chk( 1 ) ;
+  path = (Str_t) pop() ;
+  if( isNul( path ) || str_length( path ) >= sizeof( sa.sun_path ) ){
+    throw( err_BadString ) ;
+    return ;
+  }
+  str_set( (Str_t) &sa, 0, sizeof( sa ) ) ;
+  sa.sun_family = AF_UNIX ;
+  str_copy( sa.sun_path, path, str_length( path ) ) ;
+  if( bound ){
+    unlink( path ) ;
+  }
+  push( sock_open( AF_UNIX, SOCK_STREAM, (struct sockaddr *) &sa, sizeof( sa ), bound ) ) ;
+}
+
+void tcp_listen() // ( port -- fd )
+{
+  sock_inet( SOCK_STREAM, 1 ) ;
+}
+
+void tcp_connect() // ( host port -- fd )
+{
+  sock_inet( SOCK_STREAM, 0 ) ;
+}
+
+void udp_open() // ( port -- fd )
+{
+  sock_inet( SOCK_DGRAM, 1 ) ;
+}
+
+void unix_listen() // ( path -- fd )
+{
+  sock_unix( 1 ) ;
+}
+
+void unix_connect() // ( path -- fd )
+{
+  sock_unix( 0 ) ;
+}
+
+// the result of a non blocking call, -1 when it would have blocked ...
+Wrd_t sock_result( Wrd_t rv )
+{
+  if( rv < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ){
+    throw( err_SysCall ) ;
+  }
+  return rv ;
+}
+
+void sock_accept() // ( fd -- fd' | -1 )
+{
+  Wrd_t fd ;
+
+  chk( 1 ) ;
+  fd = sock_result( accept( (Wrd_t) pop(), NULL, NULL ) ) ;
+  if( fd >= 0 ){
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK ) ;
+    fcntl( fd, F_SETFD, FD_CLOEXEC ) ;
+  }
+  push( fd ) ;
+}
+
+void sock_recv() // ( fd buf n -- nr | 0 | -1 )
+{
+  Wrd_t fd, n ;
+  Str_t buf ;
+
+  chk( 3 ) ;
+  n = pop() ;
+  buf = (Str_t) pop() ;
+  fd = pop() ;
+  push( sock_result( recv( fd, buf, n, 0 ) ) ) ;
+}
+
+void sock_send() // ( fd buf n -- nx | -1 )
+{
+  Wrd_t fd, n ;
+  Str_t buf ;
+
+  chk( 3 ) ;
+  n = pop() ;
+  buf = (Str_t) pop() ;
+  fd = pop() ;
+  push( sock_result( send( fd, buf, n, MSG_NOSIGNAL ) ) ) ;
+}
+
+void udp_sendto() // ( fd buf n host port -- nx | -1 )
+{
+  struct sockaddr_in sa ;
+  Wrd_t fd, n, port ;
+  Str_t buf, host ;
+
+  chk( 5 ) ;
+  port = pop() ;
+  host = (Str_t) pop() ;
+  n = pop() ;
+  buf = (Str_t) pop() ;
+  fd = pop() ;
+  if( !sock_addr( host, port, SOCK_DGRAM, &sa ) ){
+    throw( err_BadString ) ;
+    return ;
+  }
+  push( sock_result( sendto( fd, buf, n, MSG_NOSIGNAL, (struct sockaddr *) &sa, sizeof( sa ) ) ) ) ;
+}
+
+void sock_close() // ( fd -- )
+{
+  Wrd_t fd ;
+
+  chk( 1 ) ;
+  fd = (Wrd_t) *tos ;
+  ev_del() ;
+  close( fd ) ;
+}
+
+/*
+  -- the server: with -s <port or path> everything is loaded once, as
+  for a script, and sealed.  Then the master forks -w workers from the
+  warmed image and refills the pool as they exit.  A worker takes a
+  connection for its stdin and stdout and interprets it as it would a
+  terminal; its end of input is the end of the request (see Eof()).
+  After -m requests the worker exits, so with the default of 1 every
+  request starts with the dictionary just as it was loaded.  A larger
+  -m saves the forks, but later requests see what earlier ones left.
+*/
+pid_t srv_Pids[ sz_WORKERS ] ;
+
+void srv_stop( int sig )
+{
+  Cell_t i ;
+
+  for( i = 0 ; i < in_Workers ; i++ ){
+    if( srv_Pids[ i ] > 0 ){
+      kill( srv_Pids[ i ], SIGTERM ) ;
+    }
+  }
+  _exit( 0 ) ;
+}
+
+// the next connection, or the worker is done ...
+void srv_take( void )
+{
+  Wrd_t fd ;
+
+  out_flushall() ;
+  if( srv_Left < in_Requests ){
+    shutdown( 1, SHUT_RDWR ) ;		// the last one is answered
+  }
+  if( srv_Left-- < 1 ){
+    exit( 0 ) ;
+  }
+  do {
+    fd = accept( srv_Fd, NULL, NULL ) ;
+  } while( fd < 0 && (errno == EINTR || errno == ECONNABORTED) ) ;
+  if( fd < 0 ){
+    exit( 1 ) ;
+  }
+  dup2( fd, 0 ) ;
+  dup2( fd, 1 ) ;
+  close( fd ) ;
+  out_mode[ 0 ] = buf_Full ;		// flushed at the end of the request
+  push( (Cell_t) "stdin" ) ;
+  infile() ;
+  q_reset() ;
+}
+
+void srv_run( void )
+{
+  Str_t p ;
+  pid_t pid ;
+  Cell_t i ;
+  int status ;
+
+  error_code = err_OK ;			// whatever loading left
+  for( p = in_Serve ; *p >= '0' && *p <= '9' ; p++ ) ;
+  push( (Cell_t) in_Serve ) ;
+  if( *p == '\0' ){
+    *tos = (Cell_t) strtol( in_Serve, NULL, 10 ) ;
+    sock_inet( SOCK_STREAM, 1 ) ;
+  } else {
+    sock_unix( 1 ) ;
+  }
+  if( error_code != err_OK ){
+    fmt_out( "-- cannot serve on %s: %s\n", in_Serve, strerror( errno ) ) ;
+    exit( 1 ) ;
+  }
+  srv_Fd = (Wrd_t) pop() ;
+  fcntl( srv_Fd, F_SETFL, fcntl( srv_Fd, F_GETFL ) & ~O_NONBLOCK ) ;	// the workers block in accept()
+  signal( SIGINT, srv_stop ) ;
+  signal( SIGTERM, srv_stop ) ;
+  signal( SIGHUP, srv_stop ) ;
+  out_flushall() ;
+  for( ;; ){
+    for( i = 0 ; i < in_Workers ; i++ ){
+      if( srv_Pids[ i ] > 0 ){
+        continue ;
+      }
+      if( (pid = fork()) == 0 ){	// the master's handlers and pids are not the worker's
+        signal( SIGTERM, SIG_DFL ) ;
+        signal( SIGINT, sig_hdlr ) ;
+        signal( SIGHUP, sig_hdlr ) ;
+        str_set( (Str_t) srv_Pids, 0, sizeof( srv_Pids ) ) ;
+#ifdef TIMERS
+        tm_Armed = 0 ;			// the posix timer stayed in the master
+#endif
+        srv_Left = in_Requests ;
+        srv_take() ;
+        return ;
+      }
+      srv_Pids[ i ] = pid ;
+    }
+    pid = wait( &status ) ;
+    for( i = 0 ; i < in_Workers ; i++ ){
+      if( pid > 0 && srv_Pids[ i ] == pid ){
+        srv_Pids[ i ] = 0 ;
+      }
+    }
+    if( pid < 0 && errno == ECHILD ){	// the forks failed, try again soon
+      sleep( 1 ) ;
+    }
+  }
+}
+#endif
+
+// infile only pushes the file, it is read in place of the tokens
+// after it; include reads all of it before it returns, so a word can
+// run a file, and the lines read are added to _ops ...
+void include() // ( str -- )
+{
+  Wrd_t level = in_This ;
+
+  infile() ;
+  if( in_This == level ){
+    return ;
+  }
+  while( in_This > level && error_code == err_OK ){
+    q_token() ;
+  }
+  _ops += InputStack[ level + 1 ].in_line ;
+}
+
+void infile()
+{
+  chk( 1 ) ;
+
+  Str_t fn = (Str_t) pop() ;
+
+  if( isMatch( fn, "stdin" ) ) // intialize ...
+  {
+	in_This = 0 ;
+	InputStack[ in_This ].file = 0 ; 
+	InputStack[ in_This ].bytes_read = -1 ; 
+	InputStack[ in_This ].bytes_this = -1 ; 
+	InputStack[ in_This ].in_line = 0 ; 
+	InputStack[ in_This ].name = str_cache( fn ) ;
+	InputStack[ in_This ].bytes = (Str_t) inbuf[ in_This ] ; 
+	InputStack[ in_This ].map = (Str_t) NULL ; 
+	return ;
+  }
+
+#ifdef HOSTED
+
+  if( in_This < sz_FILES ) // push a new input file ...
+  {
+	if( !isNul( fn ) )
+	{
+		in_This += 1 ;
+		InputStack[ in_This ].bytes_read = -1 ; 
+		InputStack[ in_This ].bytes_this = -1 ; 
+		InputStack[ in_This ].in_line = 0 ; 
+		InputStack[ in_This ].name = str_cache( fn ) ;
+		InputStack[ in_This ].bytes = (Str_t) inbuf[ in_This ] ; 
+		InputStack[ in_This ].file = open( InputStack[ in_This ].name , O_RDONLY ) ;
+
+		if( InputStack[ in_This ].file < 0 )
+		{
+			str_uncache( fn ) ;
+			if( !isNul( off_path ) ) // add the file path and try again ...
+			{
+				Str_t buf = tb_get( TB ) ;
+				str_format( buf, tb_bufsize( TB ), "%s/%s", (Str_t) off_path, (Str_t) fn ) ;
+    				InputStack[ in_This ].name = str_cache( (Str_t) buf ) ;
+				InputStack[ in_This ].file = open( InputStack[ in_This ].name , O_RDONLY ) ;
+			} 
+		}
+
+		if( InputStack[ in_This ].file < 0 )
+		{
+			in_This-- ;
+			throw( err_NoFile ) ;
+			return ;
+		}
+#ifdef IN_MMAP
+		in_map( &InputStack[ in_This ] ) ;
+#endif
+	}
+
+	return ;
+
+  } 
+
+  throw( err_InStack ) ;
+  return ;
+
+#endif
+}
+
+#ifdef IN_MMAP
+// regular files are mapped whole and tokenized in place (see
+// str_mapslice()), anything else is read through inp() as before.
+void in_map( Input_t *input )
+{
+  struct stat sbuf ;
+  Str_t map ;
+
+  input->map = (Str_t) NULL ;
+  input->map_size = input->map_this = 0 ;
+  if( fstat( input->file, &sbuf ) < 0 || !S_ISREG( sbuf.st_mode ) || sbuf.st_size < 1 )
+  {
+    return ;
+  }
+  map = (Str_t) mmap( NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, input->file, 0 ) ;
+  if( map == (Str_t) MAP_FAILED )
+  {
+    return ;
+  }
+  madvise( map, sbuf.st_size, MADV_SEQUENTIAL ) ;
+  input->map = map ;
+  input->map_size = sbuf.st_size ;
+}
+
+void in_unmap( Input_t *input )
+{
+  if( !isNul( input->map ) )
+  {
+    munmap( input->map, input->map_size ) ;
+    input->map = (Str_t) NULL ;
+  }
+}
+
+void in_showline( Input_t *input )
+{
+  uByt_t *s, *e, *start, *end ;
+
+  start = (uByt_t *) input->map ;
+  end = start + input->map_size ;
+  s = start + input->map_this ;
+  if( s > start && (ch_class[ s[-1] ] & cc_Eol) )
+    s-- ;
+  while( s > start && !(ch_class[ s[-1] ] & cc_Eol) )
+    s-- ;
+  for( e = s ; e < end && !(ch_class[ *e ] & cc_Eol) ; e++ ) ;
+  fmt_out( "-- Last input: " ) ;
+  outp( OUTPUT, (Str_t) s, e - s ) ;
+  fmt_out( "\n" ) ;
+}
+#endif
+
+void filename()
+{
+	push( (Str_t) InputStack[ in_This ].name ) ;
+}
+
+void outfile()
+{
+#ifdef HOSTED
+  Str_t fn ;
+  Cell_t fd, fexists ;
+  uCell_t fflg = O_CREAT | O_RDWR | O_APPEND ;
+
+  fn = (Str_t) pop() ;
+  if( !isNul( fn ) ){
+#if !defined( __WIN32__ )
+    uCell_t fprm = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH ;
+    fd = open( fn, fflg, fprm ) ;
+#else
+    fd = open( fn, fflg ) ;
+#endif
+    if( fd < 0 ){
+      throw( err_NoFile ) ;
+      return ;
+    }
+    out_files[++out_This] = fd ;
+    out_len[out_This] = 0 ;
+    out_mode[out_This] = buf_Full ;
+    return ;
+  } 
+#endif
+}
+
+void closeout()
+{
+#ifdef HOSTED
+  if( out_This > 0 ){
+    out_flush( out_This ) ;
+    close( OUTPUT ) ;
+    out_This-- ;
+  }
+#endif
+}
+
+void isfile()
+{
+#ifdef HOSTED
+  struct stat sbuf ;
+  Cell_t rv ;
+  Str_t fn = (Str_t) pop() ;
+
+  if( !isNul( fn ) )
+  {
+    rv = stat( (const Str_t ) fn, &sbuf ) ;
+    if( rv < 0 )
+    {
+      throw( err_SysCall ) ;
+    }
+  }
+  push( (rv == 0) ? 1 : 0 ) ; 
+#endif
+}
+
+// the output, and the block buffers as the standard flush does
+void flush()
+{
+  out_flushall() ;
+  save_buffers() ;
+  if( error_code == err_OK ){
+    empty_buffers() ;
+  }
+}
+
+void unbuffered()
+{
+#ifdef HOSTED
+  out_flush( out_This ) ;
+  out_mode[out_This] = buf_None ;
+#endif
+}
+
+void buffered()
+{
+#ifdef HOSTED
+  out_mode[out_This] = isatty( OUTPUT ) ? buf_Line : buf_Full ;
+#endif
+}
+
+/*
+  -- blocks: block n gives the address of a buffer holding the
+  blk_Size bytes of block n, read in if it is not there already.  The
+  sz_BUFFERS buffers are shared by the blocks least recently used
+  first, one that was updated is written back before it is reused.
+  HOSTED builds keep the blocks in the file open-blocks opened, read
+  and written with pread()/pwrite() so the file need not be sized up
+  front, and read-ahead asks the kernel for the blocks after one read
+  in sequence.  NATIVE builds keep sz_BLOCKS of them in blk_Flash,
+  after flash, so the same words run on both.
+*/
+
+// read or write block n of the backing store, 0 on an error thrown
+Wrd_t blk_io( Block_t *b, Wrd_t writing )
+{
+#ifdef HOSTED
+  off_t at = (off_t) b ->bk_blk * blk_Size ;
+  ssize_t nx ;
+
+  if( blk_Fd < 0 ){
+    throw( err_NoFile ) ;
+    return 0 ;
+  }
+  if( writing ){
+    nx = pwrite( blk_Fd, b ->bk_data, blk_Size, at ) ;
+  } else {
+    nx = pread( blk_Fd, b ->bk_data, blk_Size, at ) ;
+    if( nx >= 0 && nx < blk_Size ){	// past the end reads as blanks
+      str_set( (Str_t) b ->bk_data + nx, ' ', blk_Size - nx ) ;
+      nx = blk_Size ;
+    }
+  }
+  if( nx != blk_Size ){
+    throw( err_SysCall ) ;
+    return 0 ;
+  }
+#else
+  if( b ->bk_blk >= sz_BLOCKS ){
+    throw( err_Range ) ;
+    return 0 ;
+  }
+  if( writing ){
+    str_copy( (Str_t) blk_Flash[ b ->bk_blk ], (Str_t) b ->bk_data, blk_Size ) ;
+  } else {
+    str_copy( (Str_t) b ->bk_data, (Str_t) blk_Flash[ b ->bk_blk ], blk_Size ) ;
+  }
+#endif
+  return 1 ;
+}
+
+// the buffer for block n, read in when reading is set
+Block_t *blk_get( Cell_t n, Wrd_t reading )
+{
+  Block_t *b, *lru = NULL ;
+  Wrd_t i, j ;
+
+  if( n < 0 ){
+    throw( err_Range ) ;
+    return NULL ;
+  }
+  if( !isNul( blk_Cur ) && blk_Cur ->bk_blk == n ){
+    blk_Cur ->bk_used = ++blk_Clock ;
+    return blk_Cur ;
+  }
+  for( i = 0 ; i < sz_BUFFERS ; i++ ){
+    b = &blk_Bufs[ i ] ;
+    if( b ->bk_blk == n ){
+      b ->bk_used = ++blk_Clock ;
+      return blk_Cur = b ;
+    }
+    for( j = 0 ; j <= in_This && blk_Load[ j ] != b ; j++ ) ;
+    if( j > in_This && (isNul( lru ) || b ->bk_used < lru ->bk_used) ){
+      lru = b ;			// and not being loaded ...
+    }
+  }
+  if( isNul( lru ) ){
+    throw( err_NoSpace ) ;
+    return NULL ;
+  }
+  if( lru ->bk_dirty && !blk_io( lru, 1 ) ){
+    return NULL ;
+  }
+  lru ->bk_dirty = 0 ;
+  lru ->bk_blk = n ;
+  lru ->bk_used = ++blk_Clock ;
+  blk_Cur = lru ;
+  if( !reading ){
+    str_set( (Str_t) lru ->bk_data, ' ', blk_Size ) ;
+    return lru ;
+  }
+  if( !blk_io( lru, 0 ) ){
+    lru ->bk_blk = -1 ;
+    blk_Cur = NULL ;
+    return NULL ;
+  }
+#if defined( HOSTED ) && defined( POSIX_FADV_WILLNEED )
+  if( blk_Ahead > 0 && n == blk_Next ){
+    posix_fadvise( blk_Fd, (off_t) (n + 1) * blk_Size, (off_t) blk_Ahead * blk_Size, POSIX_FADV_WILLNEED ) ;
+  }
+#endif
+  blk_Next = n + 1 ;
+  return lru ;
+}
+
+void block()
+{
+  Block_t *b ;
+
+  chk( 1 ) ;
+  b = blk_get( *tos, 1 ) ;
+  *tos = isNul( b ) ? 0 : (Cell_t) b ->bk_data ;
+}
+
+void buffer()
+{
+  Block_t *b ;
+
+  chk( 1 ) ;
+  b = blk_get( *tos, 0 ) ;
+  *tos = isNul( b ) ? 0 : (Cell_t) b ->bk_data ;
+}
+
+void update()
+{
+  if( isNul( blk_Cur ) ){
+    throw( err_BadState ) ;
+    return ;
+  }
+  blk_Cur ->bk_dirty = 1 ;
+}
+
+void save_buffers()
+{
+  Wrd_t i ;
+
+  for( i = 0 ; i < sz_BUFFERS ; i++ ){
+    if( blk_Bufs[ i ].bk_dirty ){
+      if( !blk_io( &blk_Bufs[ i ], 1 ) ){
+        return ;
+      }
+      blk_Bufs[ i ].bk_dirty = 0 ;
+    }
+  }
+}
+
+void empty_buffers()
+{
+  Wrd_t i ;
+
+  for( i = 0 ; i < sz_BUFFERS ; i++ ){
+    blk_Bufs[ i ].bk_blk = -1 ;
+    blk_Bufs[ i ].bk_dirty = 0 ;
+    blk_Bufs[ i ].bk_used = 0 ;
+  }
+  blk_Cur = NULL ;
+}
+
+// interpret block n, its buffer is left alone until the input is
+// popped, see in_pop() ...
+void load()
+{
+#ifdef IN_MMAP
+  Input_t *input ;
+  Block_t *b ;
+  Cell_t n ;
+
+  chk( 1 ) ;
+  if( in_This >= sz_FILES - 1 ){
+    throw( err_InStack ) ;
+    return ;
+  }
+  b = blk_get( pop(), 1 ) ;
+  if( isNul( b ) ){
+    return ;
+  }
+  input = &InputStack[ ++in_This ] ;
+  input ->file = input ->bytes_read = input ->bytes_this = -1 ;
+  input ->in_line = 0 ;
+  input ->name = "block" ;
+  input ->bytes = (Str_t) inbuf[ in_This ] ;
+  input ->map = (Str_t) b ->bk_data ;
+  for( n = 0 ; n < blk_Size && b ->bk_data[ n ] ; n++ ) ;	// a hole in the file ends it
+  input ->map_size = n ;
+  input ->map_this = 0 ;
+  blk_Load[ in_This ] = b ;
+#else
+  chk( 1 ) ;
+  drop() ;
+  throw( err_InStack ) ;
+#endif
+}
+
+void open_blocks()
+{
+#ifdef HOSTED
+  Str_t fn ;
+  Wrd_t fd ;
+
+  chk( 1 ) ;
+  fn = (Str_t) pop() ;
+  if( isNul( fn ) ){
+    throw( err_NullPtr ) ;
+    return ;
+  }
+#if !defined( __WIN32__ )
+  fd = open( fn, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH ) ;
+#else
+  fd = open( fn, O_CREAT | O_RDWR ) ;
+#endif
+  if( fd < 0 ){
+    throw( err_NoFile ) ;
+    return ;
+  }
+  blk_close() ;
+  blk_Fd = fd ;
+#else
+  chk( 1 ) ;
+  drop() ;
+#endif
+}
+
+void read_ahead()
+{
+  chk( 1 ) ;
+  blk_Ahead = pop() ;
+}
+
+// save the buffers and let go of the file, at exit too, see main()
+void blk_close( void )
+{
+  if( isNul( vm ) ){
+    return ;
+  }
+  save_buffers() ;
+  if( error_code != err_OK ){
+    return ;
+  }
+  empty_buffers() ;
+#ifdef HOSTED
+  if( blk_Fd >= 0 ){
+    close( blk_Fd ) ;
+  }
+  blk_Fd = -1 ;
+#endif
+}
+
+#ifdef HOSTED
+Wrd_t out_write( Wrd_t fd, Str_t buf, Wrd_t len )
+{
+  Wrd_t nx, done = 0 ;
+
+  while( done < len )
+  {
+    nx = write( fd, buf + done, len - done ) ;
+    if( nx < 0 )
+    {
+      if( errno == EINTR )
+        continue ;
+      return done ? done : nx ;
+    }
+    done += nx ;
+  }
+  return done ;
+}
+#endif
+
+void out_flush( Wrd_t slot )
+{
+#ifdef HOSTED
+  if( out_len[slot] > 0 )
+  {
+    out_write( out_files[slot], (Str_t) output_buffer[slot], out_len[slot] ) ;
+    out_len[slot] = 0 ;
+  }
+#endif
+}
+
+void out_flushall( void )
+{
+#ifdef HOSTED
+  Wrd_t i ;
+
+  if( isNul( vm ) )
+    return ;
+  for( i = out_This ; i >= 0 ; i-- )
+  {
+    out_flush( i ) ;
+  }
+#endif
+#ifdef NATIVE
+  uart_flush() ;
+#endif
+}
+
+// HOSTED output goes through a buffer for each of the out_files,
+// written when full, at a newline for a tty, or on a flush, key,
+// accept, prompt or exit.  Any other fd is written straight through.
+Wrd_t outp( Wrd_t fd, Str_t buf, Wrd_t len )
+{
+#ifdef HOSTED
+  Wrd_t slot, i, eol = 0 ;
+  Byt_t *dst ;
+
+  for( slot = out_This ; slot >= 0 ; slot-- )
+  {
+    if( out_files[slot] == fd )
+      break ;
+  }
+  if( slot < 0 || out_mode[slot] == buf_None )
+  {
+    out_flushall() ;
+    return out_write( fd, buf, len ) ;
+  }
+
+  if( out_len[slot] + len > sz_OUTBUF )
+  {
+    out_flush( slot ) ;
+  }
+  if( len >= sz_OUTBUF )
+  {
+    return out_write( fd, buf, len ) ;
+  }
+  dst = &output_buffer[slot][out_len[slot]] ;
+  for( i = 0 ; i < len ; i++ )
+  {
+    eol |= ( (*dst++ = buf[i]) == '\n' ) ;
+  }
+  out_len[slot] += len ;
+  if( eol && out_mode[slot] == buf_Line )
+  {
+    out_flush( slot ) ;
+  }
+  return len ; 
+
+#endif
+#ifdef NATIVE
+  Wrd_t i ;
+
+  for( i = 0 ; i < len; i++ )
+  {
+    uart_putc( (unsigned) buf[i]&0xff );
+  }
+  return i ;
+
+#endif
+}
+
+Wrd_t inp( Wrd_t fd, Str_t buf, Wrd_t len )
+{
+
+#ifdef HOSTED
+  Wrd_t nx ;
+
+ again:
+  nx = read( fd, buf, len ) ;
+  if( nx < 0 )
+  {
+    if( errno == EINTR )
+      goto again ;
+  }
+  return nx ; 
+#endif
+
+#ifdef NATIVE
+  Cell_t c, x, i = 0 ;
+  
+  str_set( buf, 0, len ) ;
+  while( i < len )
+  {
+    buf[i++] = c = uart_getc();
+    if( c == 0x15 ) // NAK
+    {
+       str_set( buf, 0, len ) ;
+       int slen = str_length( buf ) ;
+       uart_putc( 0x0a ) ;
+       for( x = 0 ; x < slen; x++ )
+           uart_putc( 0x20 ) ;
+       uart_putc( 0x0a ) ;
+       i = 0 ;
+       continue ;
+    }
+    if( c == 0x08 || c == 0x7f ) // backspace || delete
+    {
+       buf[--i] = 0x00 ; // backspace
+       buf[--i] = 0x00 ; // bad char
+       i = i < 0 ? 0 : i ;
+       uart_putc( 0x20 ) ; // space
+       uart_putc( 0x08 ) ; // backspace
+       continue ;
+    }
+    if( c == 0x0d ) // return 
+    {
+       uart_putc( 0x0a ) ; // newline
+       break ;
+    }
+  }
+  return i ;
+#endif
+}
+
+#if defined avr || defined AVR
+Wrd_t read( Wrd_t fd, Str_t buf, Wrd_t len ) {}
+Wrd_t write( Wrd_t fd, Str_t buf, Wrd_t len ) {}
+#endif
+
+#ifdef HOSTED 
+Cell_t native_find( Cell_t value )
+{
+  Cell_t i ;
+
+  for( i = n_Natives - 1 ; i >= 0 ; i-- ){
+    if( Natives[ i ].value == value ){
+      return i ;
+    }
+  }
+  return -1 ;
+}
+
+void native_note( Cell_t lib, Str_t name, Cell_t value )
+{
+  Native_t *np ;
+  Byt_t *p ;
+
+  if( value == 0 || native_find( value ) >= 0 || n_Natives >= sz_NATIVES ){
+    return ;
+  }
+  p = (Byt_t *) name ;
+  if( !isNul( name ) && (p < (Byt_t *) String_Data || p >= (Byt_t *) &flash[ sz_FLASH ]) ){
+    name = str_cache( name ) ;
+  }
+  np = &Natives[ n_Natives++ ] ;
+  np ->lib = lib ;
+  np ->name = name ;
+  np ->value = value ;
+}
+
+// the next native again, from a saved library index and name
+void native_resolve( Cell_t lib, Str_t name )
+{
+  Cell_t v ;
+
+  if( lib < 0 ){
+    v = (Cell_t) dlopen( name, RTLD_NOW | RTLD_GLOBAL ) ;
+  } else if( lib < n_Natives && Natives[ lib ].value ){
+    v = (Cell_t) dlsym( (Opq_t) Natives[ lib ].value, name ) ;
+  } else {
+    v = 0 ;
+  }
+  if( v == 0 ){
+    fmt_out( "-- Unresolved native: %s\n", isNul( name ) ? "(null)" : name ) ;
+  }
+  Natives[ n_Natives ].lib = lib ;
+  Natives[ n_Natives ].name = name ;
+  Natives[ n_Natives ].value = v ;
+  n_Natives++ ;
+}
+
+void qdlopen()
+{
+  Str_t lib ;
+  Opq_t opaque ;
+
+  chk( 1 ) ; 
+  lib = (Str_t) pop() ;
+  opaque = dlopen( lib, RTLD_NOW | RTLD_GLOBAL ) ;
+  native_note( -1, lib, (Cell_t) opaque ) ;
+  push( (Cell_t) opaque ) ;
+}
+
+void qdlclose()
+{
+  Opq_t opaque ;
+
+  chk( 1 ) ; 
+  opaque = (Opq_t) pop() ;
+  push( (Cell_t) dlclose( opaque ) ) ;
+}
+
+void qdlsym()
+{
+  Str_t symbol ;
+  Opq_t handle, opaque ;
+
+  chk( 2 ) ; 
+  symbol = (Str_t) pop() ;
+  handle = (Opq_t) pop() ;
+  opaque = dlsym( handle, symbol ) ;
+  if( native_find( (Cell_t) handle ) >= 0 ){
+    native_note( native_find( (Cell_t) handle ), symbol, (Cell_t) opaque ) ;
+  }
+  push( (Cell_t) opaque ) ;
+}
+
+void qdlerror()
+{
+  push( (Cell_t) dlerror() ) ;
+}
+
+#ifdef IN_MMAP
+// save-image writes the dictionary and flash to a file that -I can
+// map back in place of a cold start.  Pointers into Primitives[],
+// Colon_Defs[] and flash, primitive code addresses and dlopen/dlsym
+// results are stored as indexes or offsets, anything else as is.
+#define IMG_MAGIC	0x4f464649	// "OFFI"
+#define IMG_VERSION	1
+
+typedef struct {
+  Cell_t magic ;
+  Cell_t version ;
+  Cell_t cellsize ;
+  Cell_t flashsize ;
+  Cell_t n_prims ;
+  Cell_t prim_sig ;
+  Cell_t n_defs ;
+  Cell_t n_natives ;
+  Cell_t here ;		// cells
+  Cell_t dictptr ;	// cells
+  Cell_t strings ;	// byte offset of String_Data
+  Cell_t base ;
+} Image_t ;
+
+typedef struct {
+  Cell_t cfa ;		// Primitives[] index
+  Cell_t nfa ;		// flash offset or -1
+  Cell_t flg ;
+  Cell_t pfa ;		// flash offset or -1
+} Image_Def_t ;
+
+typedef struct {
+  Cell_t lib ;
+  Cell_t name ;		// flash offset or -1
+} Image_Native_t ;
+
+#define img_Chunk	512
+#define img_Pad( n )	((((n) + sizeof( Cell_t ) - 1) / sizeof( Cell_t )) * sizeof( Cell_t ))
+
+Cell_t img_sig( void )
+{
+  uCell_t h = 5381 ;
+  Dict_t *p ;
+  uByt_t *s ;
+
+  for( p = StartOf( Primitives ) ; p ->nfa ; p++ ){
+    for( s = (uByt_t *) p ->nfa ; *s ; s++ ){
+      h = ((h << 5) + h) ^ *s ;
+    }
+  }
+  return (Cell_t) h ;
+}
+
+Cell_t img_offset( void *ptr )
+{
+  Byt_t *p = (Byt_t *) ptr ;
+
+  if( p < (Byt_t *) flash || p > (Byt_t *) &flash[ sz_FLASH ] ){
+    return -1 ;
+  }
+  return p - (Byt_t *) flash ;
+}
+
+Cell_t img_prim( Fptr_t cfa )
+{
+  Cell_t i ;
+
+  for( i = 0 ; i < n_Primitives - 1 ; i++ ){
+    if( Primitives[ i ].cfa == cfa ){
+      return i ;
+    }
+  }
+  return -1 ;
+}
+
+Cell_t img_encode( Cell_t c, Byt_t *tag )
+{
+  Byt_t *p = (Byt_t *) c ;
+  Cell_t v ;
+
+  *tag = img_Raw ;
+  if( c == 0 ){
+    return c ;
+  }
+  if( p >= (Byt_t *) Primitives && p < (Byt_t *) &Primitives[ n_Primitives ] &&
+      (p - (Byt_t *) Primitives) % sizeof( Dict_t ) == 0 ){
+    *tag = img_Prim ;
+    return (Dict_t *) p - Primitives ;
+  }
+  if( p >= (Byt_t *) Colon_Defs && p < (Byt_t *) &Colon_Defs[ n_ColonDefs ] &&
+      (p - (Byt_t *) Colon_Defs) % sizeof( Dict_t ) == 0 ){
+    *tag = img_Colon ;
+    return (Dict_t *) p - Colon_Defs ;
+  }
+  if( (v = img_offset( p )) >= 0 ){
+    *tag = img_Flash ;
+    return v ;
+  }
+  if( (v = img_prim( (Fptr_t) c )) >= 0 ){
+    *tag = img_Code ;
+    return v ;
+  }
+  if( (v = native_find( c )) >= 0 ){
+    *tag = img_Native ;
+    return v ;
+  }
+  return c ;
+}
+
+Wrd_t img_put( Wrd_t fd, void *buf, Wrd_t len )
+{
+  return out_write( fd, (Str_t) buf, len ) == len ;
+}
+
+void save_image()
+{
+  Image_t hdr ;
+  Image_Def_t def ;
+  Image_Native_t nat ;
+  Byt_t tags[ img_Chunk ] ;
+  Cell_t cells[ img_Chunk ] ;
+  Cell_t i, j, n, n_here ;
+  Wrd_t fd, ok ;
+  Str_t fn ;
+
+  word() ;
+  fn = (Str_t) pop() ;
+#ifdef TOKENS
+  if( tok_packed() ){
+    throw( err_BadState ) ;
+    return ;
+  }
+#endif
+  fd = open( fn, O_CREAT | O_WRONLY | O_TRUNC, 0644 ) ;
+  if( fd < 0 )
+  {
+    throw( err_NoFile ) ;
+    return ;
+  }
+
+  n_here = Here - flash ;
+  hdr.magic = IMG_MAGIC ;
+  hdr.version = IMG_VERSION ;
+  hdr.cellsize = sizeof( Cell_t ) ;
+  hdr.flashsize = sz_FLASH ;
+  hdr.n_prims = n_Primitives ;
+  hdr.prim_sig = img_sig() ;
+  hdr.n_defs = n_ColonDefs ;
+  hdr.n_natives = n_Natives ;
+  hdr.here = n_here ;
+  hdr.dictptr = DictPtr - flash ;
+  hdr.strings = img_offset( String_Data ) ;
+  hdr.base = Base ;
+  ok = img_put( fd, &hdr, sizeof( hdr ) ) ;
+
+  for( i = 0 ; ok && i < n_ColonDefs ; i++ ){
+    def.cfa = img_prim( Colon_Defs[ i ].cfa ) ;
+    def.nfa = isNul( Colon_Defs[ i ].nfa ) ? -1 : img_offset( Colon_Defs[ i ].nfa ) ;
+    def.flg = Colon_Defs[ i ].flg ;
+    def.pfa = isNul( Colon_Defs[ i ].pfa ) ? -1 : img_offset( Colon_Defs[ i ].pfa ) ;
+    ok = img_put( fd, &def, sizeof( def ) ) ;
+  }
+
+  for( i = 0 ; ok && i < n_Natives ; i++ ){
+    nat.lib = Natives[ i ].lib ;
+    nat.name = isNul( Natives[ i ].name ) ? -1 : img_offset( Natives[ i ].name ) ;
+    ok = img_put( fd, &nat, sizeof( nat ) ) ;
+  }
+
+  for( i = 0 ; ok && i < n_here ; i += n ){	// the tags, then the cells ...
+    n = (n_here - i < img_Chunk) ? n_here - i : img_Chunk ;
+    for( j = 0 ; j < n ; j++ ){
+      img_encode( flash[ i + j ], &tags[ j ] ) ;
+    }
+    ok = img_put( fd, tags, n ) ;
+  }
+  str_set( (Str_t) tags, 0, sizeof( Cell_t ) ) ;
+  if( ok && img_Pad( n_here ) > n_here ){
+    ok = img_put( fd, tags, img_Pad( n_here ) - n_here ) ;
+  }
+  for( i = 0 ; ok && i < n_here ; i += n ){
+    n = (n_here - i < img_Chunk) ? n_here - i : img_Chunk ;
+    for( j = 0 ; j < n ; j++ ){
+      cells[ j ] = img_encode( flash[ i + j ], &tags[ j ] ) ;
+    }
+    ok = img_put( fd, cells, n * sizeof( Cell_t ) ) ;
+  }
+
+  if( ok ){					// and the strings as they are
+    ok = img_put( fd, String_Data, (sz_FLASH * sizeof( Cell_t )) - hdr.strings ) ;
+  }
+  if( close( fd ) < 0 || !ok )
+  {
+    throw( err_SysCall ) ;
+  }
+}
+
+/*
+  compile-c writes what save-image would as C, with each colon word
+  turned into a function that calls the primitives in its thread and
+  branches with goto.  Built in with
+
+	cc -D AOT=\"prog.c\" OneFileForth.c	(or make aot)
+
+  the words are there at boot, run as if jitted.  A primitive that
+  moves ip off the thread (does> say) has the rest of the word run
+  threaded.
+*/
+Cell_t aot_operands( Cell_t *ip )
+{
+  Fusion_t *fp ;
+  Dict_t *dp ;
+  Byt_t tag ;
+
+  img_encode( *ip, &tag ) ;
+  if( tag != img_Prim ){
+    return 0 ;
+  }
+  dp = (Dict_t *) *ip ;
+  fp = fuse_find( dp ->cfa ) ;
+  if( !isNul( fp ) ){
+    return (fp ->kind == fz_LitBranch) ? 2 : 1 ;
+  }
+  if( dp ->cfa == branch || dp ->cfa == q_branch || dp ->cfa == tail || dp ->cfa == doLiteral ){
+    return 1 ;
+  }
+#ifdef PARDO
+  if( dp ->cfa == par_do ){	// moves ip, the rest runs threaded
+    return 2 ;
+  }
+#endif
+  return 0 ;
+}
+
+Cell_t *aot_target( Dict_t *wp, Cell_t *ip )
+{
+  Fusion_t *fp ;
+  Dict_t *dp ;
+  Byt_t tag ;
+
+  img_encode( *ip, &tag ) ;
+  if( tag != img_Prim ){
+    return NULL ;
+  }
+  dp = (Dict_t *) *ip ;
+  fp = fuse_find( dp ->cfa ) ;
+  if( !isNul( fp ) ){
+    return (fp ->kind == fz_LitBranch) ? (Cell_t *) ip[2] : (fp ->kind == fz_Branch) ? (Cell_t *) ip[1] : NULL ;
+  }
+  if( dp ->cfa == branch || dp ->cfa == q_branch ){
+    return (Cell_t *) ip[1] ;
+  }
+  if( dp ->cfa == tail && (Dict_t *) ip[1] == wp ){
+    return wp ->pfa ;
+  }
+  return NULL ;
+}
+
+void aot_str( Str_t s )
+{
+  uByt_t *p ;
+
+  fmt_out( "\"" ) ;
+  for( p = (uByt_t *) s ; *p ; p++ ){
+    if( *p < ' ' || *p > '~' || *p == '"' || *p == '\\' ){
+      fmt_out( "\\%c%c%c", '0' + (*p >> 6), '0' + ((*p >> 3) & 7), '0' + (*p & 7) ) ;
+    } else {
+      fmt_out( "%c", *p ) ;
+    }
+  }
+  fmt_out( "\"" ) ;
+}
+
+// a cell of the image as a C expression
+void aot_cell( Cell_t c, uByt_t *used )
+{
+  Cell_t v ;
+  Byt_t tag ;
+
+  v = img_encode( c, &tag ) ;
+  switch( tag ){
+    case img_Prim:
+      used[ v ] = 1 ;
+      fmt_out( "(Cell_t) aot_P[ %d ]", v ) ;
+      break ;
+    case img_Colon:
+      fmt_out( "(Cell_t) &Colon_Defs[ %d ]", v ) ;
+      break ;
+    case img_Flash:
+      fmt_out( "(Cell_t) aot_F( %d )", v ) ;
+      break ;
+    case img_Code:
+      used[ v ] = 1 ;
+      fmt_out( "(Cell_t) aot_P[ %d ] ->cfa", v ) ;
+      break ;
+    case img_Native:
+      fmt_out( "(Cell_t) aot_N( %d )", v ) ;
+      break ;
+    default:
+      fmt_out( "(Cell_t) 0x%x", c ) ;
+  }
+}
+
+// the ops doColon() inlines, as C
+Str_t aot_inline( uByt_t op )
+{
+  switch( op ){
+    case op_Do:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  rpush( pop() ) ;\n  rpush( n ) ;\n" ;
+    case op_Loop:
+      return "  if( *rtos + 1 < *rnos ){\n    *rtos += 1 ;\n    push( 0 ) ;\n  } else {\n    rtos -= 2 ;\n    push( 1 ) ;\n  }\n" ;
+    case op_PLoop:
+      return "  n = pop() ;\n  if( (n > 0) ? (*rtos + n < *rnos) : (*rtos + n > *rnos) ){\n    *rtos += n ;\n    push( 0 ) ;\n  } else {\n    rtos -= 2 ;\n    push( 1 ) ;\n  }\n" ;
+    case op_I:
+      return "  push( *rtos ) ;\n" ;
+    case op_Leave:
+      return "  return ;\n" ;
+    case op_ToR:
+      return "  aot_Chk( 1 ) ;\n  rpush( pop() ) ;\n" ;
+    case op_RFrom:
+      return "  push( rpop() ) ;\n" ;
+    case op_Add:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos += n ;\n" ;
+    case op_Sub:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos -= n ;\n" ;
+    case op_Dup:
+      return "  aot_Chk( 1 ) ;\n  n = *tos ;\n  push( n ) ;\n" ;
+    case op_Drop:
+      return "  aot_Chk( 1 ) ;\n  tos-- ;\n" ;
+    case op_Swap:
+      return "  aot_Chk( 2 ) ;\n  n = *tos ;\n  *tos = nos ;\n  nos = n ;\n" ;
+    case op_Over:
+      return "  aot_Chk( 2 ) ;\n  n = nos ;\n  push( n ) ;\n" ;
+    case op_Inc:
+      return "  *tos += 1 ;\n" ;
+    case op_Dec:
+      return "  *tos -= 1 ;\n" ;
+    case op_Eq:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos = (*tos == n) ? 1 : 0 ;\n" ;
+    case op_Ne:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos = (*tos != n) ? 1 : 0 ;\n" ;
+    case op_Lt:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos = (*tos < n) ? 1 : 0 ;\n" ;
+    case op_Gt:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  *tos = (*tos > n) ? 1 : 0 ;\n" ;
+    case op_Fetch:
+      return "  aot_Chk( 1 ) ;\n  n = pop() ;\n  aot_Null( n ) ;\n  push( *(Cell_t *) n ) ;\n" ;
+    case op_Store:
+      return "  aot_Chk( 2 ) ;\n  n = pop() ;\n  aot_Null( n ) ;\n  *(Cell_t *) n = pop() ;\n" ;
+  }
+  return NULL ;
+}
+
+// run cfa as the cell at ip, or the rest of the word threaded if it
+// is not a primitive
+void aot_call( Fptr_t cfa, Cell_t *ip, Cell_t *next, uByt_t *used )
+{
+  Cell_t k = isNul( cfa ) ? -1 : img_prim( cfa ) ;
+  Str_t c ;
+
+  if( k < 0 ){
+    fmt_out( "  rpush( (Cell_t) aot_F( %d ) ) ;\n  doColon() ;\n  return ;\n", img_offset( ip ) ) ;
+    return ;
+  }
+  c = aot_inline( Primitives[ k ].op ) ;
+  if( !isNul( c ) ){
+    fmt_out( "%s", c ) ;
+    return ;
+  }
+  used[ k ] = 1 ;
+  fmt_out( "  if( aot_run( aot_P[ %d ], aot_F( %d ) ) ) return ;\n", k, img_offset( next ) ) ;
+}
+
+void aot_goto( Cell_t *pfa, Cell_t *end, Cell_t *to )
+{
+  if( to >= pfa && to <= end ){
+    fmt_out( " goto L%d ;\n", to - pfa ) ;
+    return ;
+  }
+  fmt_out( "{\n    rpush( (Cell_t) aot_F( %d ) ) ;\n    doColon() ;\n    return ;\n  }\n", img_offset( to ) ) ;
+}
+
+void aot_op( Dict_t *wp, Cell_t *ip, Cell_t *end, uByt_t *used )
+{
+  Cell_t *next, v ;
+  Fusion_t *fp ;
+  Dict_t *dp ;
+  Byt_t tag ;
+
+  if( *ip == 0 ){
+    fmt_out( "  return ;\n" ) ;
+    return ;
+  }
+  v = img_encode( *ip, &tag ) ;
+  dp = (Dict_t *) *ip ;
+  next = ip + 1 + aot_operands( ip ) ;
+  if( tag == img_Colon ){
+    if( dp ->cfa == doColon && !isNul( dp ->pfa ) ){
+      fmt_out( "  aot_w%d() ;\n", v ) ;
+    } else if( dp ->cfa == pushPfa ){
+      fmt_out( "  push( Colon_Defs[ %d ].pfa ) ;\n", v ) ;
+    } else if( dp ->cfa == doConstant ){
+      fmt_out( "  push( *Colon_Defs[ %d ].pfa ) ;\n", v ) ;
+    } else {
+      fmt_out( "  if( aot_run( &Colon_Defs[ %d ], aot_F( %d ) ) ) return ;\n", v, img_offset( next ) ) ;
+    }
+    return ;
+  }
+  if( tag != img_Prim ){
+    aot_call( NULL, ip, next, used ) ;
+    return ;
+  }
+  fp = fuse_find( dp ->cfa ) ;
+  if( !isNul( fp ) ){
+    switch( fp ->kind ){
+      case fz_Lit:
+        fmt_out( "  push( " ) ;
+        aot_cell( ip[1], used ) ;
+        fmt_out( " ) ;\n" ) ;
+        aot_call( fp ->next, ip, next, used ) ;
+        break ;
+      case fz_LitBranch:
+        fmt_out( "  push( " ) ;
+        aot_cell( ip[1], used ) ;
+        fmt_out( " ) ;\n" ) ;
+        aot_call( fuse_find( fp ->first ) ->next, ip, next, used ) ;
+        fmt_out( "  tm_Safe() ;\n  if( !pop() )" ) ;
+        aot_goto( wp ->pfa, end, (Cell_t *) ip[2] ) ;
+        break ;
+      case fz_Branch:
+        aot_call( fp ->first, ip, next, used ) ;
+        fmt_out( "  tm_Safe() ;\n  if( !pop() )" ) ;
+        aot_goto( wp ->pfa, end, (Cell_t *) ip[1] ) ;
+        break ;
+      case fz_Var:
+        fmt_out( "  push( ((Dict_t *) " ) ;
+        aot_cell( ip[1], used ) ;
+        fmt_out( ") ->pfa ) ;\n" ) ;
+        aot_call( fp ->next, ip, next, used ) ;
+        break ;
+    }
+    return ;
+  }
+  if( dp ->cfa == doLiteral ){
+    fmt_out( "  push( " ) ;
+    aot_cell( ip[1], used ) ;
+    fmt_out( " ) ;\n" ) ;
+  } else if( dp ->cfa == branch ){
+    fmt_out( "  tm_Safe() ;\n " ) ;
+    aot_goto( wp ->pfa, end, (Cell_t *) ip[1] ) ;
+  } else if( dp ->cfa == q_branch ){
+    fmt_out( "  tm_Safe() ;\n  if( !pop() )" ) ;
+    aot_goto( wp ->pfa, end, (Cell_t *) ip[1] ) ;
+  } else if( dp ->cfa == tail ){
+    fmt_out( "  tm_Safe() ;\n" ) ;
+    if( (Dict_t *) ip[1] == wp ){
+      fmt_out( "  goto L0 ;\n" ) ;
+    } else {
+      aot_op( wp, ip + 1, end, used ) ;
+      fmt_out( "  return ;\n" ) ;
+    }
+#ifdef PARDO
+  } else if( dp ->cfa == par_do ){	// it reads its operands from ip
+    aot_call( dp ->cfa, ip, ip + 1, used ) ;
+#endif
+  } else {
+    aot_call( dp ->cfa, ip, next, used ) ;
+  }
+}
+
+void aot_word( Cell_t w, uByt_t *used )
+{
+  Dict_t *wp = &Colon_Defs[ w ] ;
+  Cell_t *ip, *end, *to ;
+  uByt_t *mark ;
+
+  for( end = wp ->pfa ; end < Here && *end ; end += 1 + aot_operands( end ) ) ;
+  mark = (uByt_t *) calloc( end - wp ->pfa + 1, 1 ) ;
+  if( isNul( mark ) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  for( ip = wp ->pfa ; ip < end ; ip += 1 + aot_operands( ip ) ){
+    to = aot_target( wp, ip ) ;
+    if( to >= wp ->pfa && to <= end ){
+      mark[ to - wp ->pfa ] = 1 ;
+    }
+  }
+  fmt_out( "\nstatic void aot_w%d( void )\t// ", w ) ;
+  aot_str( wp ->nfa ) ;
+  fmt_out( "\n{\n  Cell_t UNUSED( n ) ;\n\n" ) ;
+  for( ip = wp ->pfa ; ip <= end ; ip += 1 + aot_operands( ip ) ){
+    if( mark[ ip - wp ->pfa ] ){
+      fmt_out( "L%d:\n", ip - wp ->pfa ) ;
+    }
+    if( ip == end && *ip ){
+      fmt_out( "  return ;\n" ) ;
+      break ;
+    }
+    aot_op( wp, ip, end, used ) ;
+  }
+  fmt_out( "}\n" ) ;
+  free( mark ) ;
+}
+
+Wrd_t aot_isword( Cell_t i )
+{
+  return Colon_Defs[ i ].cfa == doColon && !isNul( Colon_Defs[ i ].pfa ) ;
+}
+
+void compile_c()
+{
+  Cell_t i, n_here, strings, base ;
+  uByt_t *used ;
+  Byt_t tag ;
+  Wrd_t fd ;
+  Str_t fn ;
+
+  word() ;
+  fn = (Str_t) pop() ;
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    if( img_prim( Colon_Defs[ i ].cfa ) < 0 ){
+      throw( err_BadState ) ;
+      return ;
+    }
+  }
+#ifdef TOKENS
+  if( tok_packed() ){
+    throw( err_BadState ) ;
+    return ;
+  }
+#endif
+  used = (uByt_t *) calloc( n_Primitives, 1 ) ;
+  if( isNul( used ) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  fd = open( fn, O_CREAT | O_WRONLY | O_TRUNC, 0644 ) ;
+  if( fd < 0 ){
+    free( used ) ;
+    throw( err_NoFile ) ;
+    return ;
+  }
+  out_files[++out_This] = fd ;
+  out_len[out_This] = 0 ;
+  out_mode[out_This] = buf_Full ;
+  base = Base ;
+  Base = 10 ;
+
+  n_here = Here - flash ;
+  strings = img_offset( String_Data ) ;
+  fmt_out( "// written by compile-c, build OneFileForth.c with -D AOT=\\\"%s\\\"\n\n", fn ) ;
+  fmt_out( "#define aot_F( x )\t((Cell_t *) ((Byt_t *) flash + (x) + (((x) >= aot_Strings) ? aot_Delta : 0)))\n\n" ) ;
+  fmt_out( "Cell_t aot_Cell = %d ;\n", (Cell_t) sizeof( Cell_t ) ) ;
+  fmt_out( "Cell_t aot_Here = %d ;\n", n_here ) ;
+  fmt_out( "Cell_t aot_DictPtr = %d ;\n", (Cell_t) (DictPtr - flash) ) ;
+  fmt_out( "Cell_t aot_Strings = %d ;\n", strings ) ;
+  fmt_out( "Cell_t aot_StrLen = %d ;\n", (Cell_t) (sz_FLASH * sizeof( Cell_t )) - strings ) ;
+  fmt_out( "Cell_t aot_Base = %d ;\n", base ) ;
+  fmt_out( "Cell_t aot_Words = %d ;\n", n_ColonDefs ) ;
+  fmt_out( "Cell_t aot_Prims = %d ;\n", n_Primitives ) ;
+  fmt_out( "Cell_t aot_Delta ;\n" ) ;
+  fmt_out( "Dict_t *aot_P[ %d ] ;\n\n", n_Primitives ) ;
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    if( aot_isword( i ) ){
+      fmt_out( "static void aot_w%d( void ) ;\n", i ) ;
+    }
+  }
+  for( i = 0 ; i < n_ColonDefs && !error_code ; i++ ){
+    if( aot_isword( i ) ){
+      aot_word( i, used ) ;
+    }
+  }
+
+  fmt_out( "\nCell_t aot_Defs[][ 4 ] = {\t// cfa nfa flg pfa, as save-image\n" ) ;
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    used[ img_prim( Colon_Defs[ i ].cfa ) ] = 1 ;
+    fmt_out( "  { %d, %d, %d, %d },\n", img_prim( Colon_Defs[ i ].cfa ),
+             isNul( Colon_Defs[ i ].nfa ) ? -1 : img_offset( Colon_Defs[ i ].nfa ), (Cell_t) Colon_Defs[ i ].flg,
+             isNul( Colon_Defs[ i ].pfa ) ? -1 : img_offset( Colon_Defs[ i ].pfa ) ) ;
+  }
+  fmt_out( "  { 0 }\n} ;\n\nuByt_t aot_Tags[] = {" ) ;
+  for( i = 0 ; i < n_here ; i++ ){
+    img_encode( flash[ i ], &tag ) ;
+    fmt_out( "%s%d,", (i % 16) ? " " : "\n  ", (Cell_t) tag ) ;
+  }
+  fmt_out( "\n  0\n} ;\n\nCell_t aot_Cells[] = {" ) ;
+  for( i = 0 ; i < n_here ; i++ ){
+    fmt_out( "%s(Cell_t) 0x%x,", (i % 4) ? " " : "\n  ", img_encode( flash[ i ], &tag ) ) ;
+    if( tag == img_Prim || tag == img_Code ){
+      used[ img_encode( flash[ i ], &tag ) ] = 1 ;
+    }
+  }
+  fmt_out( "\n  0\n} ;\n\nuByt_t aot_Str[] = {" ) ;
+  for( i = strings ; i < (Cell_t) (sz_FLASH * sizeof( Cell_t )) ; i++ ){
+    fmt_out( "%s%d,", ((i - strings) % 16) ? " " : "\n  ", (Cell_t) ((uByt_t *) flash)[ i ] ) ;
+  }
+  fmt_out( "\n  0\n} ;\n\nStr_t aot_Names[] = {\t// the primitives it calls\n" ) ;
+  for( i = 0 ; i < n_Primitives ; i++ ){
+    if( used[ i ] && !isNul( Primitives[ i ].nfa ) ){
+      fmt_out( "  " ) ;
+      aot_str( Primitives[ i ].nfa ) ;
+      fmt_out( ",\n" ) ;
+    } else {
+      fmt_out( "  NULL,\n" ) ;
+    }
+  }
+  fmt_out( "} ;\n\nCell_t aot_Natives = %d ;\nCell_t aot_Libs[][ 2 ] = {\t// lib name, as save-image\n", n_Natives ) ;
+  for( i = 0 ; i < n_Natives ; i++ ){
+    fmt_out( "  { %d, %d },\n", Natives[ i ].lib, isNul( Natives[ i ].name ) ? -1 : img_offset( Natives[ i ].name ) ) ;
+  }
+  fmt_out( "  { 0 }\n} ;\n\nFptr_t aot_Code[] = {\n" ) ;
+  for( i = 0 ; i < n_ColonDefs ; i++ ){
+    if( aot_isword( i ) ){
+      fmt_out( "  aot_w%d,\n", i ) ;
+    } else {
+      fmt_out( "  NULL,\n" ) ;
+    }
+  }
+  fmt_out( "  NULL\n} ;\n" ) ;
+
+  Base = base ;
+  closeout() ;
+  free( used ) ;
+}
+
+Err_t img_load( Str_t fn )
+{
+  struct stat sbuf ;
+  Image_t *hdr ;
+  Image_Def_t *def ;
+  Image_Native_t *nat ;
+  Byt_t *map, *tags ;
+  Cell_t *cells, i, v, size ;
+  Wrd_t fd ;
+  Err_t err = err_BadImage ;
+
+  if( (fd = open( fn, O_RDONLY )) < 0 ){
+    return err_NoFile ;
+  }
+  if( fstat( fd, &sbuf ) < 0 || sbuf.st_size < (off_t) sizeof( Image_t ) ){
+    close( fd ) ;
+    return err_BadImage ;
+  }
+  map = (Byt_t *) mmap( NULL, sbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0 ) ;
+  close( fd ) ;
+  if( map == (Byt_t *) MAP_FAILED ){
+    return err_SysCall ;
+  }
+
+  hdr = (Image_t *) map ;
+  def = (Image_Def_t *) (hdr + 1) ;
+  nat = (Image_Native_t *) (def + hdr ->n_defs) ;
+  tags = (Byt_t *) (nat + hdr ->n_natives) ;
+  cells = (Cell_t *) (tags + img_Pad( hdr ->here )) ;
+
+  if( hdr ->magic != IMG_MAGIC || hdr ->version != IMG_VERSION ||
+      hdr ->cellsize != sizeof( Cell_t ) || hdr ->flashsize != sz_FLASH ||
+      hdr ->n_prims != n_Primitives || hdr ->prim_sig != img_sig() ||
+      hdr ->n_defs < 0 || hdr ->n_defs > sz_ColonDefs ||
+      hdr ->n_natives < 0 || hdr ->n_natives > sz_NATIVES ||
+      hdr ->here < 0 || hdr ->here > sz_FLASH ||
+      hdr ->dictptr < 0 || hdr ->dictptr > sz_FLASH ||
+      hdr ->strings < hdr ->here * (Cell_t) sizeof( Cell_t ) || hdr ->strings > (Cell_t) (sz_FLASH * sizeof( Cell_t )) ){
+    goto done ;
+  }
+  size = (Byt_t *) (cells + hdr ->here) - map + (sz_FLASH * sizeof( Cell_t )) - hdr ->strings ;
+  if( size != sbuf.st_size ){
+    goto done ;
+  }
+
+  String_Data = (Byt_t *) flash + hdr ->strings ;
+  str_copy( (Str_t) String_Data, (Str_t) (cells + hdr ->here), (sz_FLASH * sizeof( Cell_t )) - hdr ->strings ) ;
+
+  for( i = 0 ; i < hdr ->n_defs ; i++ ){
+    if( def[ i ].cfa < 0 || def[ i ].cfa >= n_Primitives - 1 ){
+      goto done ;
+    }
+    Colon_Defs[ i ].cfa = Primitives[ def[ i ].cfa ].cfa ;
+    Colon_Defs[ i ].nfa = def[ i ].nfa < 0 ? NULL : (Str_t) flash + def[ i ].nfa ;
+    Colon_Defs[ i ].flg = (Flag_t) def[ i ].flg ;
+    Colon_Defs[ i ].pfa = def[ i ].pfa < 0 ? NULL : (Cell_t *) ((Byt_t *) flash + def[ i ].pfa) ;
+    Colon_Defs[ i ].lnk = (Dict_t *) NULL ;
+    Colon_Defs[ i ].op = op_Call ;
+    Colon_Defs[ i ].jit = NULL ;
+    Colon_Defs[ i ].eff_in = 0 ;
+  }
+
+  n_Natives = 0 ;
+  for( i = 0 ; i < hdr ->n_natives ; i++ ){	// re-resolve the natives ...
+    native_resolve( nat[ i ].lib, nat[ i ].name < 0 ? NULL : (Str_t) flash + nat[ i ].name ) ;
+  }
+
+  for( i = 0 ; i < hdr ->here ; i++ ){		// and relocate the cells
+    v = cells[ i ] ;
+    switch( tags[ i ] ){
+      case img_Raw:
+        break ;
+      case img_Prim:
+        if( v < 0 || v >= n_Primitives ) goto done ;
+        v = (Cell_t) &Primitives[ v ] ;
+        break ;
+      case img_Colon:
+        if( v < 0 || v >= hdr ->n_defs ) goto done ;
+        v = (Cell_t) &Colon_Defs[ v ] ;
+        break ;
+      case img_Flash:
+        if( v < 0 || v > (Cell_t) (sz_FLASH * sizeof( Cell_t )) ) goto done ;
+        v = (Cell_t) ((Byt_t *) flash + v) ;
+        break ;
+      case img_Code:
+        if( v < 0 || v >= n_Primitives - 1 ) goto done ;
+        v = (Cell_t) Primitives[ v ].cfa ;
+        break ;
+      case img_Native:
+        if( v < 0 || v >= n_Natives ) goto done ;
+        v = Natives[ v ].value ;
+        break ;
+      default:
+        goto done ;
+    }
+    flash[ i ] = v ;
+  }
+
+  Here = flash + hdr ->here ;
+  DictPtr = flash + hdr ->dictptr ;
+  n_ColonDefs = hdr ->n_defs ;
+  Base = hdr ->base ;
+  err = err_OK ;
+
+done:
+  if( err != err_OK ){
+    forget() ;
+  }
+  dict_rehash() ;
+  peep_barrier() ;
+  munmap( map, sbuf.st_size ) ;
+  return err ;
+}
+
+#endif
+
+void last_will()
+{
+  Opq_t cmd ;
+
+  chk( 1 ) ; 
+  cmd = (Opq_t) pop() ;
+  atexit( cmd ) ;
+}
+
+void spinner()
+{
+  static Wrd_t ix = 0 ;
+  Byt_t f[4] = { '-', '\\', '|', '/' } ;
+
+  push( f[ ix++ % 4 ] ) ;
+  emit();
+  push( '\r' ) ;
+  emit();
+
+}
+#endif /* HOSTED */
+
+void callout()
+{
+  Cptr_t fun ;
+  Cell_t n, rv ;
+
+  fun = (Cptr_t) pop() ;
+  n = pop() ;
+
+  chk( n ) ; /* really need n+2 items ... */
+  if( n < 0 || n > sz_NARGS ){
+    throw( err_Range ) ;
+    return ;
+  }
+
+  rv = ffi_call( fun, tos - n + 1, n ) ;
+  tos -= n ;
+  push( rv ) ;
+  return ;
+}
+
+// typed bindings, `bind' and `import' build a word whose pfa holds
+// { fn, nargs, rtype } and whose cfa (doNative) takes the arguments
+// straight off the stack, see ffi_sig() for the signature strings.
+typedef enum {
+  ffi_Cell = 0,		// c or p, a full cell
+  ffi_Int,		// i, a sign extended int
+  ffi_UInt,		// u, a zero extended int
+  ffi_Void		// v, nothing is pushed
+} Ffi_t ;
+
+Cell_t ffi_call( Cptr_t fun, Cell_t *a, Cell_t n )
+{
+  Cell_t i, x[ sz_NARGS ] ;
+
+  switch( n ){
+    case 0:
+      return (*fun)() ;
+    case 1:
+      return (*fun)( a[0] ) ;
+    case 2:
+      return (*fun)( a[0], a[1] ) ;
+    case 3:
+      return (*fun)( a[0], a[1], a[2] ) ;
+    case 4:
+      return (*fun)( a[0], a[1], a[2], a[3] ) ;
+    case 5:
+      return (*fun)( a[0], a[1], a[2], a[3], a[4] ) ;
+    case 6:
+      return (*fun)( a[0], a[1], a[2], a[3], a[4], a[5] ) ;
+  }
+  // past the argument registers a full frame costs the same ...
+  for( i = 0 ; i < sz_NARGS ; i++ ){
+    x[i] = (i < n) ? a[i] : 0 ;
+  }
+  return (*fun)( x[0], x[1], x[2], x[3], x[4], x[5], x[6], x[7],
+                 x[8], x[9], x[10], x[11], x[12], x[13], x[14], x[15] ) ;
+}
+
+Cell_t ffi_ret( Cell_t rv, Cell_t rtype )
+{
+  switch( rtype ){
+    case ffi_Int:
+      return (Cell_t) (int32_t) rv ;
+    case ffi_UInt:
+      return (Cell_t) (uint32_t) rv ;
+    case ffi_Void:
+      return 0 ;
+  }
+  return rv ;
+}
+
+void doNative()
+{
+  Cell_t *p, rv ;
+
+  p = (Cell_t *) rpop() ;
+  chk( p[1] ) ;
+  rv = ffi_call( (Cptr_t) p[0], tos - p[1] + 1, p[1] ) ;
+  tos -= p[1] ;
+  if( p[2] != ffi_Void ){
+    push( ffi_ret( rv, p[2] ) ) ;
+  }
+}
+
+// "<args>:<ret>", each arg is one of i u c p, ret one of i u c p v,
+// so labs is " c:c" and getpid " :i" ... the argument letters only
+// count, every argument is passed as a full cell whatever its letter.
+void ffi_sig( Str_t sig, Cell_t *n, Cell_t *rtype )
+{
+  Str_t p ;
+
+  *n = 0 ;
+  *rtype = ffi_Cell ;
+  for( p = sig ; *p && *p != ':' ; p++ ){
+    if( !ch_matches( *p, "iucp" ) ){
+      throw( err_BadString ) ;
+      return ;
+    }
+    (*n)++ ;
+  }
+  if( *n > sz_NARGS ){
+    throw( err_Range ) ;
+    return ;
+  }
+  if( *p == ':' && *(++p) ){
+    switch( *p ){
+      case 'i': *rtype = ffi_Int ; break ;
+      case 'u': *rtype = ffi_UInt ; break ;
+      case 'v': *rtype = ffi_Void ; break ;
+      case 'c':
+      case 'p': break ;
+      default:
+        throw( err_BadString ) ;
+    }
+  }
+}
+
+void ffi_define( Cell_t fn, Str_t sig )
+{
+  Cell_t n, rtype ;
+
+  ffi_sig( sig, &n, &rtype ) ;
+  if( error_code ){
+    drop() ;
+    return ;
+  }
+  lambda() ;
+  push( fn ) ;
+  comma() ;
+  push( n ) ;
+  comma() ;
+  push( rtype ) ;
+  comma() ;
+  Colon_Defs[n_ColonDefs-1].cfa = doNative ;
+}
+
+void qbind() // ( fnptr sig <name> -- )
+{
+  Str_t sig ;
+  Cell_t fn ;
+
+  chk( 2 ) ;
+  sig = (Str_t) pop() ;
+  fn = pop() ;
+  word() ;
+  ffi_define( fn, sig ) ;
+}
+
+#ifdef HOSTED
+void import() // ( lib sig <name> -- ) binds the symbol <name>
+{
+  Str_t sig, name ;
+  Opq_t lib, fn ;
+  Cell_t i ;
+
+  chk( 2 ) ;
+  sig = (Str_t) pop() ;
+  lib = (Opq_t) pop() ;
+  word() ;
+  name = (Str_t) *tos ;
+  // only handles from dlopen, so a saved image can open the library again
+  if( (i = native_find( (Cell_t) lib )) < 0 || Natives[ i ].lib >= 0 ){
+    drop() ;
+    throw( err_BadState ) ;
+    return ;
+  }
+  fn = dlsym( lib, name ) ;
+  if( isNul( fn ) ){
+    drop() ;
+    fmt_out( "-- %s\n", dlerror() ) ;
+    throw( err_NoWord ) ;
+    return ;
+  }
+  native_note( i, name, (Cell_t) fn ) ;
+  ffi_define( (Cell_t) fn, sig ) ;
+}
+#endif
+
+void bind_map() // ( args count results xt -- ) one call per tuple of args
+{
+  Dict_t *dp ;
+  Cell_t *args, *results, *p ;
+  Cell_t i, count, rv ;
+
+  chk( 4 ) ;
+  dp = (Dict_t *) pop() ;
+  results = (Cell_t *) pop() ;
+  count = pop() ;
+  args = (Cell_t *) pop() ;
+  if( isNul( dp ) || dp ->cfa != doNative ){
+    throw( err_BadState ) ;
+    return ;
+  }
+  p = dp ->pfa ;
+  for( i = 0 ; i < count ; i++, args += p[1] ){
+    rv = ffi_call( (Cptr_t) p[0], args, p[1] ) ;
+    if( !isNul( results ) ){
+      results[i] = ffi_ret( rv, p[2] ) ;
+    }
+  }
+}
+
+void clkspersec()
+{
+#ifdef HOSTED
+  push( CLOCKS_PER_SEC ) ;
+#else
+  push( 1000000 ) ;			// utime is in usecs, see native_usecs()
+#endif
+}
+
+/*
+  -- tasks --
+
+  round robin and cooperative, in the classic style.  Each task has
+  its own data, return and user stacks and its own C stack, and runs
+  until it pauses, stops or waits for input (see io_wait()), so key,
+  accept, rcvtty, waitrdy and the interpreter's own reads let the
+  other tasks run.  The dictionary, base and files are shared.
+
+	task <name>		( -- )  name a task
+	' word <name> activate	( xt task -- )  run word in it
+	pause			( -- )  let the others run
+	stop			( -- )  end the running task
+*/
+#if defined( TASKS ) || defined( TIMERS )
+uCell_t clk_usecs( void )
+{
+#ifdef NATIVE
+  return native_usecs() ;
+#else
+  struct timespec ts ;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts ) ;
+  return (uCell_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000 ;
+#endif
+}
+#endif
+
+#ifdef TASKS
+
+void task_save( Task_t *t )
+{
+  t ->tk_stack = stack ;
+  t ->tk_rstack = rstack ;
+  t ->tk_ustack = ustack ;
+  t ->tk_tos = tos ;
+  t ->tk_rtos = rtos ;
+  t ->tk_utos = utos ;
+  str_copy( (Str_t) t ->tk_arena, (Str_t) Arenas, sizeof( t ->tk_arena ) ) ;
+  str_copy( (Str_t) t ->tk_env, (Str_t) env, sizeof( jmp_buf ) ) ;
+#ifdef STK_TRUST
+  t ->tk_chk = chk_Ok ;
+#endif
+}
+
+void task_load( Task_t *t )
+{
+  stack = t ->tk_stack ;
+  rstack = t ->tk_rstack ;
+  ustack = t ->tk_ustack ;
+  tos = t ->tk_tos ;
+  rtos = t ->tk_rtos ;
+  utos = t ->tk_utos ;
+  str_copy( (Str_t) Arenas, (Str_t) t ->tk_arena, sizeof( t ->tk_arena ) ) ;
+  str_copy( (Str_t) env, (Str_t) t ->tk_env, sizeof( jmp_buf ) ) ;
+#ifdef STK_TRUST
+  chk_Ok = t ->tk_chk ;
+#endif
+}
+
+void task_switch( Cell_t n )
+{
+  Task_t *from = Tasks[ task_This ], *to = Tasks[ n ] ;
+
+  if( n == task_This ){
+    return ;
+  }
+  out_flushall() ;
+  task_save( from ) ;
+  task_This = n ;
+  task_load( to ) ;
+  swapcontext( &from ->tk_ctx, &to ->tk_ctx ) ;
+}
+
+// the next task to run after this one, polling for the input the
+// waiting tasks want, and sleeping when none of them can run ...
+Cell_t task_next( void )
+{
+  struct pollfd fds[ sz_TASKS ] ;
+  Cell_t who[ sz_TASKS ], i, k, n, busy, tmo, wait ;
+  uCell_t now ;
+  Task_t *t ;
+
+  for( ;; ){
+    tm_Safe() ;
+    now = clk_usecs() ;
+    n = busy = 0 ;
+    tmo = -1 ;
+#ifdef TIMERS
+    if( n_Timers > 0 ){
+      tmo = (tm_Key( 0 ) > now) ? (tm_Key( 0 ) - now + 999) / 1000 : 0 ;
+    }
+#endif
+    for( i = 0 ; i < sz_TASKS ; i++ ){
+      t = Tasks[ i ] ;
+      if( isNul( t ) || t ->tk_run != task_Ready ){
+        continue ;
+      }
+      if( t ->tk_fd < 0 && t ->tk_until == 0 ){
+        busy++ ;
+        continue ;
+      }
+      if( t ->tk_until != 0 ){
+        if( t ->tk_until <= now ){	// timed out
+          t ->tk_fd = -1 ;
+          t ->tk_until = 0 ;
+          t ->tk_ready = 0 ;
+          busy++ ;
+          continue ;
+        }
+        wait = (t ->tk_until - now + 999) / 1000 ;
+        tmo = (tmo < 0 || wait < tmo) ? wait : tmo ;
+      }
+      if( t ->tk_fd >= 0 ){
+        fds[ n ].fd = t ->tk_fd ;
+        fds[ n ].events = POLLIN ;
+        fds[ n ].revents = 0 ;
+        who[ n++ ] = i ;
+      }
+    }
+    if( busy ){
+      tmo = 0 ;
+    }
+    if( (n > 0 || tmo > 0) && poll( fds, n, tmo ) < 0 && errno != EINTR ){
+      throw( err_SysCall ) ;
+      return 0 ;
+    }
+    for( k = 0 ; k < n ; k++ ){
+      if( fds[ k ].revents ){
+        t = Tasks[ who[ k ] ] ;
+        t ->tk_fd = -1 ;
+        t ->tk_until = 0 ;
+        t ->tk_ready = 1 ;
+        busy++ ;
+      }
+    }
+    for( k = 1 ; busy && k <= sz_TASKS ; k++ ){
+      i = (task_This + k) % sz_TASKS ;
+      t = Tasks[ i ] ;
+      if( !isNul( t ) && t ->tk_run == task_Ready && t ->tk_fd < 0 && t ->tk_until == 0 ){
+        return i ;
+      }
+    }
+  }
+}
+
+void task_run( void )
+{
+  Task_t *t = Tasks[ task_This ] ;
+
+  if( setjmp( env ) == 0 ){	// an error stops the task, see catch()
+    push( (Cell_t) t ->tk_xt ) ;
+    execute() ;
+  }
+  stop() ;
+}
+
+Task_t *task_alloc( void )
+{
+  Task_t *t ;
+  Cell_t len ;
+
+  t = (Task_t *) mmap( NULL, sizeof( Task_t ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) ;
+  if( t == (Task_t *) MAP_FAILED ){
+    return (Task_t *) NULL ;
+  }
+  t ->tk_stack = (Cell_t *) arena_reserve( &t ->tk_arena[ ar_Stack ], (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  t ->tk_rstack = (Cell_t *) arena_reserve( &t ->tk_arena[ ar_RStack ], (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  t ->tk_ustack = (Cell_t *) arena_reserve( &t ->tk_arena[ ar_UStack ], (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  arena_reserve( &t ->tk_cstack, sz_CSTACK, NULL ) ;
+  return t ;
+}
+
+void task_free( void )
+{
+  Cell_t i, id ;
+  Task_t *t ;
+
+  for( i = 1 ; i < sz_TASKS ; i++ ){
+    t = Tasks[ i ] ;
+    if( !isNul( t ) ){
+      for( id = ar_Stack ; id <= ar_UStack ; id++ ){
+        munmap( t ->tk_arena[ id ].lo, t ->tk_arena[ id ].hi - t ->tk_arena[ id ].lo ) ;
+      }
+      munmap( t ->tk_cstack.lo, t ->tk_cstack.hi - t ->tk_cstack.lo ) ;
+      munmap( t, sizeof( Task_t ) ) ;
+      Tasks[ i ] = (Task_t *) NULL ;
+    }
+  }
+}
+
+// stop every task but the running one (see forget()) ...
+void task_reset( void )
+{
+  Cell_t i ;
+
+  for( i = 1 ; i < sz_TASKS ; i++ ){
+    if( i != task_This && !isNul( Tasks[ i ] ) && Tasks[ i ] ->tk_run == task_Ready ){
+      Tasks[ i ] ->tk_run = task_Stopped ;
+      task_Count-- ;
+    }
+  }
+  n_Tasks = 0 ;
+}
+#endif
+
+// wait until fd has input or usecs (-1 for ever) pass, running the
+// other tasks meanwhile ... 0 when it timed out.  With no other task
+// to run it returns at once, and the caller blocks as it always did.
+Wrd_t io_wait( Wrd_t fd, Cell_t usecs )
+{
+#ifdef TASKS
+  Task_t *t ;
+
+  if( task_Count > 0 ){
+    t = Tasks[ task_This ] ;
+    t ->tk_fd = fd ;
+    t ->tk_until = (usecs < 0) ? 0 : clk_usecs() + usecs ;
+    t ->tk_ready = 0 ;
+    task_switch( task_next() ) ;
+    return t ->tk_ready ;
+  }
+#endif
+#ifdef TIMERS
+  if( n_Timers > 0 ){
+    return tm_wait( fd, usecs ) ;
+  }
+#endif
+  return 1 ;
+}
+
+// does io_wait() do the waiting ...
+Wrd_t io_busy( void )
+{
+#ifdef TASKS
+  if( task_Count > 0 ){
+    return 1 ;
+  }
+#endif
+#ifdef TIMERS
+  if( n_Timers > 0 ){
+    return 1 ;
+  }
+#endif
+  return 0 ;
+}
+
+void task() // ( <name> -- )
+{
+#ifdef TASKS
+  if( n_Tasks >= sz_TASKS - 1 ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  push( ++n_Tasks ) ;
+#else
+  push( 0 ) ;
+#endif
+  constant() ;
+}
+
+void activate() // ( xt task -- )
+{
+#ifdef TASKS
+  Dict_t *xt ;
+  Task_t *t ;
+  Cell_t n ;
+
+  chk( 2 ) ;
+  n = pop() ;
+  xt = (Dict_t *) pop() ;
+  if( n < 1 || n >= sz_TASKS || n == task_This || isNul( xt ) ){
+    throw( err_Range ) ;
+    return ;
+  }
+  if( isNul( Tasks[ 0 ] ) ){
+    Tasks[ 0 ] = &task_Main ;
+    task_Main.tk_run = task_Ready ;
+    task_Main.tk_fd = -1 ;
+  }
+  if( isNul( Tasks[ n ] ) ){
+    Tasks[ n ] = task_alloc() ;
+  }
+  if( isNul( Tasks[ n ] ) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  t = Tasks[ n ] ;
+  if( t ->tk_run == task_Ready ){	// start it again
+    task_Count-- ;
+  }
+  t ->tk_tos = StartOf( t ->tk_stack ) ;
+  t ->tk_rtos = StartOf( t ->tk_rstack ) ;
+  t ->tk_utos = StartOf( t ->tk_ustack ) ;
+  t ->tk_fd = -1 ;
+  t ->tk_until = 0 ;
+#ifdef STK_TRUST
+  t ->tk_chk = 0 ;
+#endif
+  t ->tk_xt = xt ;
+  getcontext( &t ->tk_ctx ) ;
+  t ->tk_ctx.uc_stack.ss_sp = t ->tk_cstack.base ;
+  t ->tk_ctx.uc_stack.ss_size = t ->tk_cstack.bytes ;
+  t ->tk_ctx.uc_link = NULL ;
+  makecontext( &t ->tk_ctx, task_run, 0 ) ;
+  t ->tk_run = task_Ready ;
+  task_Count++ ;
+#else
+  chk( 2 ) ;
+  tos -= 2 ;
+  throw( err_BadState ) ;
+#endif
+}
+
+void Pause() // ( -- )
+{
+#ifdef TASKS
+  if( task_Count > 0 ){
+    task_switch( task_next() ) ;
+  }
+#endif
+}
+
+void stop() // ( -- )
+{
+#ifdef TASKS
+  if( task_This > 0 ){
+    Tasks[ task_This ] ->tk_run = task_Stopped ;
+    task_Count-- ;
+    task_switch( task_next() ) ;		// and never back
+  }
+#endif
+  throw( err_BadState ) ;			// the interpreter can't stop
+}
+
+void plusplus()
+{
+  *(tos) += 1; 
+}
+
+void minusminus()
+{
+  *(tos) -= 1; 
+}
+
+void utime()
+{
+#ifdef HOSTED
+  struct timeval tv ;
+  uint64_t rv = 0ULL ;
+
+  gettimeofday( &tv, NULL ) ;
+  push( ( tv.tv_sec * 1000000 ) + tv.tv_usec ) ;
+#else
+  push( native_usecs() ) ;
+#endif
+}
+
+#ifdef NATIVE
+void cycles()
+{
+  push( native_cycles() ) ;
+}
+#endif
+
+void ops()
+{
+   push( _ops ) ; 
+}
+
+void noops()
+{
+   _ops = 0 ; 
+}
+
+#if defined( PROFILE ) || defined( SAMPLER )
+// a slot for each dictionary entry, for the profiler and sampler
+Cell_t prof_index( Dict_t *dp )
+{
+  if( dp >= Primitives && dp < &Primitives[ n_Primitives ] ){
+    return dp - Primitives ;
+  }
+  if( dp >= Colon_Defs && dp < &Colon_Defs[ sz_ColonDefs ] ){
+    return n_Primitives + (dp - Colon_Defs) ;
+  }
+  return -1 ;
+}
+
+Dict_t *prof_dict( Cell_t i )
+{
+  if( i < n_Primitives ){
+    return &Primitives[ i ] ;
+  }
+  return &Colon_Defs[ i - n_Primitives ] ;
+}
+#endif
+
+#ifdef PROFILE
+/*
+  -- the profiler --
+
+  counts, inclusive and exclusive time for every dictionary entry;
+  a shadow stack of the words being run charges each word's time to
+  its caller as child time.  Time is in nanoseconds on HOSTED builds,
+  in inner interpreter operations on NATIVE ones.  The counts and the
+  shadow stack are the VM's, so pardo workers and embedded VMs do not
+  share them, and a VM profiles only what it runs itself.
+*/
+
+uCell_t prof_clock( void )
+{
+#ifdef HOSTED
+  struct timespec ts ;
+
+  clock_gettime( CLOCK_MONOTONIC, &ts ) ;
+  return (uCell_t) ts.tv_sec * 1000000000 + ts.tv_nsec ;
+#else
+  return _ops ;
+#endif
+}
+
+void prof_enter( Dict_t *dp )
+{
+  if( !Profile ){
+    return ;
+  }
+  if( prof_Depth < sz_PSTACK ){
+    prof_Stack[ prof_Depth ].idx = prof_index( dp ) ;
+    prof_Stack[ prof_Depth ].child = 0 ;
+    prof_Stack[ prof_Depth ].start = prof_clock() ;
+  }
+  prof_Depth++ ;
+}
+
+void prof_leave( void )
+{
+  uCell_t t ;
+  Prof_t *pp ;
+
+  if( !Profile || prof_Depth < 1 ){
+    return ;
+  }
+  if( --prof_Depth >= sz_PSTACK ){
+    return ;
+  }
+  t = prof_clock() - prof_Stack[ prof_Depth ].start ;
+  if( prof_Stack[ prof_Depth ].idx >= 0 ){
+    pp = &Profile_Data[ prof_Stack[ prof_Depth ].idx ] ;
+    pp ->count++ ;
+    pp ->incl += t ;
+    pp ->excl += t - prof_Stack[ prof_Depth ].child ;
+  }
+  if( prof_Depth > 0 ){
+    prof_Stack[ prof_Depth - 1 ].child += t ;
+  }
+}
+
+// after a reset the words on the shadow stack are gone ...
+void prof_leave_all( void )
+{
+  prof_Depth = 0 ;
+}
+
+void profile_on()
+{
+  prof_Depth = 0 ;
+  Profile = 1 ;
+}
+
+void profile_off()
+{
+  Profile = 0 ;
+  prof_Depth = 0 ;
+}
+
+void profile_reset()
+{
+  str_set( (Str_t) Profile_Data, 0, (n_Primitives + sz_ColonDefs) * sizeof( Prof_t ) ) ;
+}
+
+void dotprofile() // ( n -- ) the top n words by exclusive time
+{
+  Cell_t i, j, k, n, top[ 64 ] ;
+
+  chk( 1 ) ;
+  n = pop() ;
+  n = (n < 1 || n > 64) ? 64 : n ;
+  for( k = i = 0 ; i < n_Primitives + n_ColonDefs ; i++ ){
+    if( Profile_Data[ i ].count < 1 ){
+      continue ;
+    }
+    for( j = (k < n) ? k++ : n ; j > 0 && Profile_Data[ top[ j - 1 ] ].excl < Profile_Data[ i ].excl ; j-- ){
+      if( j < n ){
+        top[ j ] = top[ j - 1 ] ;
+      }
+    }
+    if( j < n ){
+      top[ j ] = i ;
+    }
+  }
+  fmt_out( "-- calls\tincl\texcl\tword\n" ) ;
+  for( i = 0 ; i < k ; i++ ){
+    fmt_out( "%u\t%u\t%u\t%s\n", Profile_Data[ top[i] ].count,
+      Profile_Data[ top[i] ].incl, Profile_Data[ top[i] ].excl, prof_dict( top[i] ) ->nfa ) ;
+  }
+}
+#endif
+
+#ifdef SAMPLER
+/*
+  -- the sampler --
+
+  a statistical profile for the runs prof_enter() would slow down too
+  much.  SIGPROF comes every so many usecs of cpu time and sm_sample()
+  notes the word running, and the return addresses on rstack, in a
+  buffer; that is all it does, like tm_alarm() it leaves the rest to
+  the interpreter.  The addresses are mapped back to colon words when
+  the samples are shown.
+
+	1000 sample-on		( usecs -- )  start afresh
+	sample-off		( -- )
+	samples			( -- n )  how many were taken
+	20 .samples		( n -- )  the top n by samples in the word
+	.folded			( -- )  stacks for flamegraph.pl
+*/
+void sm_sample( int sig )
+{
+  Sample_t *s ;
+  Cell_t *r, n = 0 ;
+
+  if( isNul( vm ) || !sm_On ){
+    return ;
+  }
+  if( sm_Count >= sz_SAMPLES ){
+    sm_Lost++ ;
+    return ;
+  }
+  s = &sm_Buf[ sm_Count ] ;
+  s ->sm_dp = isNul( sm_Ip ) ? sm_Word : (Dict_t *) sm_Ip[ -1 ] ;
+  if( !isNul( sm_Ip ) ){
+    s ->sm_at[ n++ ] = (Cell_t) sm_Ip ;
+  }
+  for( r = rtos ; r > StartOf( rstack ) && n < sz_SAMPLEDEPTH ; r-- ){
+    if( *r >= (Cell_t) flash && *r < (Cell_t) Here && *r != (Cell_t) sm_Ip ){
+      s ->sm_at[ n++ ] = *r ;
+    }
+  }
+  s ->sm_n = n ;
+  sm_Count++ ;
+}
+
+void sample_on() // ( usecs -- )
+{
+  struct itimerval it ;
+  struct sigaction sa ;
+  Cell_t usecs ;
+
+  chk( 1 ) ;
+  usecs = pop() ;
+  usecs = (usecs > 0) ? usecs : 1000 ;
+  if( isNul( sm_Buf ) ){
+    sm_Buf = (Sample_t *) mmap( NULL, sz_SAMPLES * sizeof( Sample_t ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) ;
+    if( sm_Buf == (Sample_t *) MAP_FAILED ){
+      sm_Buf = NULL ;
+      throw( err_NoSpace ) ;
+      return ;
+    }
+  }
+  sm_Count = sm_Lost = sm_Done = 0 ;
+  sm_Usecs = usecs ;
+  str_set( (Str_t) &sa, 0, sizeof( sa ) ) ;
+  sa.sa_handler = sm_sample ;
+  sa.sa_flags = SA_RESTART ;
+  sigemptyset( &sa.sa_mask ) ;
+  sigaction( SIGPROF, &sa, NULL ) ;
+  it.it_interval.tv_sec = usecs / 1000000 ;
+  it.it_interval.tv_usec = usecs % 1000000 ;
+  it.it_value = it.it_interval ;
+  sm_On = 1 ;
+  if( setitimer( ITIMER_PROF, &it, NULL ) ){
+    sm_On = 0 ;
+    throw( err_SysCall ) ;
+  }
+}
+
+void sample_off() // ( -- )
+{
+  struct itimerval it ;
+
+  sm_On = 0 ;
+  str_set( (Str_t) &it, 0, sizeof( it ) ) ;
+  setitimer( ITIMER_PROF, &it, NULL ) ;
+}
+
+int sm_by_pfa( const void *a, const void *b )
+{
+  Cell_t *x = (*(Dict_t **) a) ->pfa, *y = (*(Dict_t **) b) ->pfa ;
+
+  return (x < y) ? -1 : (x > y) ;
+}
+
+// the colon word a return address is in, the last to start before it
+void sm_resolve( void )
+{
+  Dict_t **defs ;
+  Cell_t i, j, n, lo, hi, mid ;
+  Sample_t *s ;
+
+  defs = (Dict_t **) calloc( n_ColonDefs + 1, sizeof( Dict_t * ) ) ;
+  if( isNul( defs ) ){
+    return ;
+  }
+  for( n = i = 0 ; i < n_ColonDefs ; i++ ){
+    if( Colon_Defs[ i ].cfa == doColon && !isNul( Colon_Defs[ i ].pfa ) ){
+      defs[ n++ ] = &Colon_Defs[ i ] ;
+    }
+  }
+  qsort( defs, n, sizeof( Dict_t * ), sm_by_pfa ) ;
+  for( ; sm_Done < sm_Count ; sm_Done++ ){
+    s = &sm_Buf[ sm_Done ] ;
+    for( j = 0 ; j < s ->sm_n ; j++ ){
+      for( lo = 0, hi = n ; lo < hi ; ){
+        mid = (lo + hi) / 2 ;
+        if( defs[ mid ] ->pfa < (Cell_t *) s ->sm_at[ j ] ){
+          lo = mid + 1 ;
+        } else {
+          hi = mid ;
+        }
+      }
+      s ->sm_at[ j ] = (lo > 0) ? (Cell_t) defs[ lo - 1 ] : 0 ;
+    }
+  }
+  free( defs ) ;
+}
+
+void samples() // ( -- n )
+{
+  sm_resolve() ;
+  push( sm_Done ) ;
+}
+
+Str_t sm_name( Dict_t *dp )
+{
+  return (isNul( dp ) || isNul( dp ->nfa )) ? "?" : dp ->nfa ;
+}
+
+void dotsamples() // ( n -- ) the top n words by samples in them
+{
+  uCell_t *self, *total ;
+  Cell_t i, j, k, n, m, x, top[ 64 ] ;
+  Sample_t *s ;
+
+  chk( 1 ) ;
+  n = pop() ;
+  n = (n < 1 || n > 64) ? 64 : n ;
+  m = n_Primitives + sz_ColonDefs ;
+  self = (uCell_t *) calloc( 2 * m, sizeof( uCell_t ) ) ;
+  if( isNul( self ) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  total = self + m ;
+  sm_resolve() ;
+  for( i = 0 ; i < sm_Done ; i++ ){
+    s = &sm_Buf[ i ] ;
+    if( (x = prof_index( s ->sm_dp )) >= 0 ){
+      self[ x ]++ ;
+      total[ x ]++ ;
+    }
+    for( j = 0 ; j < s ->sm_n ; j++ ){	// once each, for recursion
+      for( k = 0 ; k < j && s ->sm_at[ k ] != s ->sm_at[ j ] ; k++ ) ;
+      if( k == j && (Dict_t *) s ->sm_at[ j ] != s ->sm_dp && (x = prof_index( (Dict_t *) s ->sm_at[ j ] )) >= 0 ){
+        total[ x ]++ ;
+      }
+    }
+  }
+  for( k = i = 0 ; i < m ; i++ ){
+    if( total[ i ] < 1 ){
+      continue ;
+    }
+    for( j = (k < n) ? k++ : n ; j > 0 && self[ top[ j - 1 ] ] < self[ i ] ; j-- ){
+      if( j < n ){
+        top[ j ] = top[ j - 1 ] ;
+      }
+    }
+    if( j < n ){
+      top[ j ] = i ;
+    }
+  }
+  fmt_out( "-- %d samples every %d usecs, %d lost\n", sm_Done, sm_Usecs, sm_Lost ) ;
+  fmt_out( "-- self\ttotal\tword\n" ) ;
+  for( i = 0 ; i < k ; i++ ){
+    fmt_out( "%u\t%u\t%s\n", self[ top[i] ], total[ top[i] ], prof_dict( top[i] ) ->nfa ) ;
+  }
+  free( self ) ;
+}
+
+int sm_by_stack( const void *a, const void *b )
+{
+  const Sample_t *x = (const Sample_t *) a, *y = (const Sample_t *) b ;
+  Cell_t i ;
+
+  if( x ->sm_n != y ->sm_n ){
+    return (x ->sm_n < y ->sm_n) ? -1 : 1 ;
+  }
+  for( i = 0 ; i < x ->sm_n ; i++ ){
+    if( x ->sm_at[ i ] != y ->sm_at[ i ] ){
+      return (x ->sm_at[ i ] < y ->sm_at[ i ]) ? -1 : 1 ;
+    }
+  }
+  return (x ->sm_dp < y ->sm_dp) ? -1 : (x ->sm_dp > y ->sm_dp) ;
+}
+
+// one line for each distinct stack, outermost first, and its count
+void dotfolded() // ( -- )
+{
+  Cell_t i, j, n ;
+  Sample_t *s ;
+
+  sm_resolve() ;
+  qsort( sm_Buf, sm_Done, sizeof( Sample_t ), sm_by_stack ) ;
+  for( i = 0 ; i < sm_Done ; i += n ){
+    s = &sm_Buf[ i ] ;
+    for( n = 1 ; i + n < sm_Done && sm_by_stack( s, s + n ) == 0 ; n++ ) ;
+    for( j = s ->sm_n - 1 ; j >= 0 ; j-- ){
+      fmt_out( "%s;", sm_name( (Dict_t *) s ->sm_at[ j ] ) ) ;
+    }
+    fmt_out( "%s %d\n", sm_name( s ->sm_dp ), n ) ;
+  }
+}
+#endif
+
+void qdo()
+{
+  emit_op( lookup( "(do)" ) ) ;
+  bkw_mark();
+}
+
+void do_do()
+{
+  Cell_t nxt ;
+
+  chk( 2 ) ;
+  nxt = rpop() ;
+  swap() ;
+  rpush( pop() ) ; /* end point */
+  rpush( pop() ) ; /* index */
+  rpush( nxt ) ; 
+}
+
+void do_loop()
+{
+  Cell_t nxt ;
+
+  nxt = (Cell_t ) rpop() ;	// save nxt
+  if ( *(rtos)+1 < *(rnos) ){	// if i < n
+    *rtos += 1; 		// ++i
+    rpush( nxt ) ; 		// restore nxt
+    push( 0 ) ;			// flag for ?branch
+    return ;
+  }
+
+  rtos-- ; rtos-- ;		// drop i, n
+  rpush( nxt ) ;		// restore nxt
+  push( 1 ) ;			// flag for ?branch
+
+}
+
+void loop()
+{
+
+  emit_op( lookup( "(loop)" ) ) ;
+
+  emit_op( lookup( "?branch" ) ) ;
+  bkw_resolve() ;
+
+}
+
+void do_I()
+{
+  push( *rnos );
+}
+
+void ploop()
+{
+
+  emit_op( lookup( "(+loop)" ) ) ;
+
+  emit_op( lookup( "?branch" ) ) ;
+  bkw_resolve() ;
+
+}
+
+void do_ploop()
+{
+  Cell_t nxt, inc ;
+
+  inc = pop() ;
+  nxt = (Cell_t ) rpop() ;
+  if ( inc > 0 ) /* positive increment */
+  {
+    if ( ( *(rtos) + inc )< *(rnos) ){
+      *rtos += inc ;
+      rpush( nxt ) ; 
+      push( 0 ) ;
+      return ;
+    }
+
+  } else { /* negative increment */
+    if ( ( *(rtos) + inc )> *(rnos) ){
+      *rtos += inc ;
+      rpush( nxt ) ; 
+      push( 0 ) ;
+      return ;
+    }
+
+  }
+
+  rtos-- ; rtos-- ;		// drop i, n ...
+  rpush( nxt ) ;		// restore nxt ...
+  push( 1 ) ;			// flag for ?branch ...
+
+}
+
+#ifdef ARENA
+// map bytes (rounded up to whole pages) between two guard pages,
+// the usable part is returned aligned to its upper guard ...
+void *arena_map( Arena_Id_t id, Cell_t bytes, Cell_t *rounded )
+{
+  return arena_reserve( &Arenas[ id ], bytes, rounded ) ;
+}
+
+void *arena_reserve( Arena_t *ap, Cell_t bytes, Cell_t *rounded )
+{
+  Cell_t page, len ;
+  Byt_t *p ;
+
+  page = sysconf( _SC_PAGESIZE ) ;
+  len = ((bytes + page - 1) / page) * page ;
+  p = (Byt_t *) mmap( NULL, len + 2 * page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 ) ;
+  if( p == (Byt_t *) MAP_FAILED || mprotect( p + page, len, PROT_READ | PROT_WRITE ) < 0 )
+  {
+    err_out( "-- arena: can't map %d bytes (%s).\n", bytes, (Str_t) strerror( errno ) ) ;
+    exit( 1 ) ;
+  }
+  ap ->lo = p ;
+  ap ->hi = p + len + 2 * page ;
+  ap ->bytes = rounded ? len : bytes ;
+  ap ->base = p + page + len - ap ->bytes ;
+  if( rounded )
+    *rounded = len ;
+  return ap ->base ;
+}
+
+void arena_init( void )
+{
+  Cell_t len ;
+
+  if( !arena_sizes() )
+  {
+    err_out( "-- arena sizes out of range.\n" ) ;
+    exit( 1 ) ;
+  }
+  if( sz_TMPBUFFER > CQ_MAX_BUFFER )
+    sz_TMPBUFFER = CQ_MAX_BUFFER ;
+
+  // stacks index from 1: stack[0], StartOf( stack ), is the first
+  // usable cell, where tos rests when empty, the lower guard page is
+  // just below it and stack[sz_STACK+1] is the first cell of the
+  // upper one ...
+  stack = (Cell_t *) arena_map( ar_Stack, (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  rstack = (Cell_t *) arena_map( ar_RStack, (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  ustack = (Cell_t *) arena_map( ar_UStack, (sz_STACK + 1) * sizeof( Cell_t ), &len ) ;
+  sz_STACK = len / sizeof( Cell_t ) - 1 ;
+  tos = StartOf( stack ) ;
+  rtos = StartOf( rstack ) ;
+  utos = StartOf( ustack ) ;
+
+  flash = (Cell_t *) arena_map( ar_Flash, sz_FLASH * sizeof( Cell_t ), &len ) ;
+  sz_FLASH = len / sizeof( Cell_t ) ;
+  flash_mem = StartOf( flash ) ;
+  *flash = FLASH_INIT_VAL ;
+
+  Colon_Defs = (Dict_t *) arena_map( ar_Defs, sz_ColonDefs * sizeof( Dict_t ), NULL ) ;
+  tmp_buffer = (Byt_t *) arena_map( ar_TmpBuf, sz_TMPBUFFER, NULL ) ;
+#ifdef PROFILE
+  Profile_Data = (Prof_t *) arena_map( ar_Profile, (n_Primitives + sz_ColonDefs) * sizeof( Prof_t ), NULL ) ;
+#endif
+}
+
+void arena_free( void )
+{
+  Cell_t id ;
+
+  for( id = 0 ; id < ar_Max ; id++ ){
+    if( !isNul( Arenas[ id ].lo ) ){
+      munmap( Arenas[ id ].lo, Arenas[ id ].hi - Arenas[ id ].lo ) ;
+    }
+  }
+}
+
+void arena_fault( int sig, siginfo_t *info, void *context )
+{
+  Byt_t *addr = (Byt_t *) info ->si_addr ;
+  Arena_t *ap ;
+  Cell_t id ;
+
+  if( isNul( vm ) ){		// not one of ours
+    signal( sig, SIG_DFL ) ;
+    return ;
+  }
+  for( id = 0 ; id < ar_Max ; id++ ){
+    ap = &Arenas[ id ] ;
+    if( addr >= ap ->lo && addr < ap ->hi ){
+      break ;
+    }
+  }
+
+  switch( id ){
+    case ar_Stack:
+    case ar_RStack:
+    case ar_UStack:
+      if( addr < ap ->base ){
+        throw( err_StackUdr ) ;
+      } else {
+        throw( err_StackOvr ) ;
+      }
+      tos = StartOf( stack ) ;
+      rtos = StartOf( rstack ) ;
+      utos = StartOf( ustack ) ;
+      break ;
+
+    case ar_Defs:
+      if( n_ColonDefs > sz_ColonDefs ){
+        n_ColonDefs = sz_ColonDefs ;
+      }
+    case ar_Flash:
+    case ar_TmpBuf:
+      throw( err_NoSpace ) ;
+      break ;
+
+    default:
+      sig_hdlr( sig ) ;
+      return ;
+  }
+
+  catch() ;
+  q_reset() ;	// catch() may return when quiet, the fault must not
+  longjmp( env, rst_signalhdlr ) ;
+}
+
+void arena_signals( void )
+{
+  struct sigaction action ;
+
+  str_set( (Str_t) &action, 0, sizeof( action ) ) ;
+  action.sa_sigaction = arena_fault ;
+  action.sa_flags = SA_SIGINFO | SA_NODEFER ;
+  sigemptyset( &action.sa_mask ) ;
+  sigaction( SIGSEGV, &action, NULL ) ;
+  sigaction( SIGBUS, &action, NULL ) ;
+}
+#endif
+
+void forget()
+{
+  if( !isNul( TB ) )
+  {
+    TB = tb_destroy( TB ) ;
+  }
+  TB = tb_create( &T, (Byt_t *) tmp_buffer, (Wrd_t) sz_TMPBUFFER, (Wrd_t) nm_TMPBUFFER ) ;
+
+  Here = (Cell_t *) StartOf( flash ) ;		// erase colon defs vars and constants ...
+  DictPtr = (Cell_t *) StartOf( flash ) ;	// set the dictptr to here ...
+  n_ColonDefs = 0 ; 				// uncount the colon defs ... 
+#ifdef JIT
+  jit_release() ;				// and drop their native code
+#endif
+#ifdef HOSTED
+  n_Natives = 0 ;				// and the natives they held
+#endif
+  dict_rehash() ;				// and forget their names
+  peep_barrier() ;
+#ifdef TASKS
+  task_reset() ;				// which the tasks could be running
+#endif
+#ifdef EVENTS
+  ev_reset() ;					// or the events call
+#endif
+#ifdef TIMERS
+  tm_reset() ;					// or the timers
+#endif
+  Base = 10 ;
+  Trace = 0 ;
+  state = state_Interactive ;
+
+  if( isNul( String_LowWater ) )
+	String_Data = (Byt_t *) (&flash[sz_FLASH - 1]) ;	// erase the string data referenced in the dictionary
+  else
+  	String_Data = (Byt_t *) String_LowWater ;
+}
+
+// a VM starts out with its own memory and input, knowing the
+// primitives, or everything the VM it shares knew at the time ...
+void vm_init( VM_t *v, VM_t *shared )
+{
+  Dict_t **base = Prim_Hash ;
+#ifdef TOKENS
+  Dict_t *defs = NULL ;
+#endif
+  Cell_t i ;
+
+  if( !isNul( shared ) )
+  {
+    vm = shared ;
+    base = Dict_Hash ;
+#ifdef TOKENS
+    defs = tok_Defs ;
+#endif
+  }
+  vm = v ;
+  for( i = 0 ; i < sz_FILES ; i++ )
+  {
+    inbuf[ i ] = &input_buffer[ i * sz_INBUF ] ;
+    InputStack[ i ].file = InputStack[ i ].bytes_read = InputStack[ i ].bytes_this = -1 ;
+    InputStack[ i ].bytes = (Str_t) inbuf[ i ] ;
+  }
+  in_This = -1 ;
+#ifdef HOSTED
+  out_files[ 0 ] = 1 ;
+  out_mode[ 0 ] = isatty( out_files[ 0 ] ) ? buf_Line : buf_Full ;
+  blk_Fd = -1 ;
+#endif
+  empty_buffers() ;
+  Base = 10 ;
+  Fusion = 1 ;
+#ifdef EVENTS
+  ev_Poll = -1 ;
+#endif
+#ifdef ARENA
+  arena_init() ;
+#else
+  tos = StartOf( stack ) ;
+  rtos = StartOf( rstack ) ;
+  utos = StartOf( ustack ) ;
+  flash_mem = StartOf( flash ) ;
+  *flash = FLASH_INIT_VAL ;
+#endif
+#ifdef TOKENS
+  tok_Defs = isNul( defs ) ? Colon_Defs : defs ;
+#endif
+  str_copy( (Str_t) Dict_Base, (Str_t) base, sizeof( Dict_Base ) ) ;
+}
+
+#ifdef ARENA
+/*
+ -- embedding: built with -D EMBED, main() becomes off_main() and
+    the program linking this file can run interpreters of its own,
+    the host gets these with OFF_API, see the top of the file,
+
+	VM_t  *off_create( VM_t *shared ) ;
+	Err_t  off_eval( VM_t *v, Str_t src, Cell_t len ) ;
+	Err_t  off_load( VM_t *v, Str_t fn ) ;
+	void   off_push( VM_t *v, Cell_t x ) ;
+	Cell_t off_pop( VM_t *v ) ;
+	void   off_destroy( VM_t *v ) ;
+
+    A VM is used by one thread at a time, any number may run at once.
+    A VM created with a shared one starts out with its words and runs
+    them in place, so the shared VM must outlive it, and define, jit
+    or forget nothing more ... its variables are shared as well.
+*/
+VM_t *off_create( VM_t *shared )
+{
+  VM_t *caller = vm, *v ;
+
+  v = (VM_t *) mmap( NULL, sizeof( VM_t ), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 ) ;
+  if( v == (VM_t *) MAP_FAILED )
+  {
+    return (VM_t *) NULL ;
+  }
+  dict_init() ;
+  vm_init( v, shared ) ;
+  forget() ;
+  q_reset() ;
+
+  in_This = 0 ;				// an empty input at the bottom, 
+  InputStack[ 0 ].name = "embedded" ;	// off_eval() stops above it
+  InputStack[ 0 ].map = "" ;
+  off_path = str_cache( getenv( OFF_PATH ) ) ;
+  Locale = str_cache( (Str_t) setlocale( LC_ALL, NULL ) ) ;
+  str_seal() ;
+
+  vm = caller ;
+  return v ;
+}
+
+void off_destroy( VM_t *v )
+{
+  VM_t *caller = vm ;
+
+  vm = v ;
+  while( in_This > 0 )
+  {
+    in_pop() ;
+  }
+  while( out_This > 0 )
+  {
+    closeout() ;
+  }
+  blk_close() ;
+  out_flushall() ;
+#ifdef JIT
+  if( !isNul( jit_Base ) )
+  {
+    munmap( jit_Base, sz_JIT ) ;
+  }
+#endif
+#ifdef TASKS
+  task_free() ;
+#endif
+#ifdef EVENTS
+  if( ev_Poll >= 0 )
+  {
+    close( ev_Poll ) ;
+  }
+#endif
+#ifdef TIMERS
+  if( tm_Armed )
+  {
+    timer_delete( tm_Posix ) ;
+  }
+#endif
+#ifdef SAMPLER
+  if( !isNul( sm_Buf ) )
+  {
+    sample_off() ;
+    munmap( sm_Buf, sz_SAMPLES * sizeof( Sample_t ) ) ;
+  }
+#endif
+#ifdef PARDO
+  par_free() ;
+#endif
+  arena_free() ;
+  vm = (caller == v) ? (VM_t *) NULL : caller ;
+  munmap( v, sizeof( VM_t ) ) ;
+}
+
+// run an input pushed by off_eval() or off_load() to its end, an
+// error resets the VM (see catch()) and drops the rest of it ...
+Err_t off_run( VM_t *v, Str_t fn, Str_t src, Cell_t len )
+{
+  VM_t *caller = vm ;
+  Input_t *input ;
+  jmp_buf save ;
+  Wrd_t level ;
+  Err_t err ;
+
+  vm = v ;
+  str_copy( (Str_t) save, (Str_t) env, sizeof( jmp_buf ) ) ;
+  level = in_This ;
+  error_code = error_last = err_OK ;
+  if( setjmp( env ) == 0 )
+  {
+    if( !isNul( fn ) )
+    {
+      push( fn ) ;
+      infile() ;
+      catch() ;
+    } else if( in_This < sz_FILES - 1 ) {
+      input = &InputStack[ ++in_This ] ;
+      input ->file = input ->bytes_read = input ->bytes_this = -1 ;
+      input ->in_line = 0 ;
+      input ->name = "eval" ;
+      input ->bytes = (Str_t) inbuf[ in_This ] ;
+      input ->map = src ;
+      input ->map_size = len ;
+      input ->map_this = 0 ;
+    } else {
+      error_last = err_InStack ;
+    }
+    while( in_This > level )
+    {
+      q_token() ;
+    }
+  }
+  while( in_This > level )
+  {
+    in_pop() ;
+  }
+  out_flushall() ;
+  err = error_last ;
+  str_copy( (Str_t) env, (Str_t) save, sizeof( jmp_buf ) ) ;
+  vm = caller ;
+  return err ;
+}
+
+Err_t off_eval( VM_t *v, Str_t src, Cell_t len )
+{
+  return off_run( v, (Str_t) NULL, src, len ) ;
+}
+
+Err_t off_load( VM_t *v, Str_t fn )
+{
+  return off_run( v, fn, (Str_t) NULL, 0 ) ;
+}
+
+void off_push( VM_t *v, Cell_t x )
+{
+  VM_t *caller = vm ;
+
+  vm = v ;
+  push( x ) ;
+  vm = caller ;
+}
+
+Cell_t off_pop( VM_t *v )
+{
+  VM_t *caller = vm ;
+  Cell_t x ;
+
+  vm = v ;
+  x = pop() ;
+  vm = caller ;
+  return x ;
+}
+#endif
+
+#ifdef PARDO
+/*
+  -- parallel loops: pardo ... parloop is do ... loop with the range
+  split in a chunk for each worker, a VM of its own on a thread of
+  its own.  The workers share the dictionary (see off_create()), so
+  the body reaches the same variables and buffers, but has stacks
+  of its own; it should leave them as it found them.  With parreduce
+  each chunk starts with the seed on its stack and leaves a value,
+  and the values are folded, in order, with the word named after it.
+  Every chunk gets the seed, so it must be the reduction's identity,
+  0 for +, 1 for * ... anything else is folded in once per chunk and
+  the answer changes with par-workers; add a start value afterwards.
+
+	limit start pardo ... parloop		( limit start -- )
+	seed limit start pardo ... parreduce +	( seed limit start -- n )
+	n par-workers				( n -- )  1 runs it here
+
+  The body is compiled in line as a thread of its own,
+
+	(pardo) [end] [reduce] (do) ... (loop) ?branch [body] 0 end:
+
+  so the words it calls run threaded in the workers, jit or not.
+*/
+void pardo()
+{
+  emit_op( lookup( "(pardo)" ) ) ;
+  fwd_mark() ;				// past the body
+  push( (Cell_t) Here ) ;		// and the reduction
+  push( 0 ) ;
+  comma() ;
+  emit_op( lookup( "(do)" ) ) ;
+  bkw_mark() ;
+}
+
+// close the body, see pardo() for the marks it left ...
+void par_end( Dict_t *reduce )
+{
+  Cell_t *p ;
+
+  emit_op( lookup( "(loop)" ) ) ;
+  emit_op( lookup( "?branch" ) ) ;
+  bkw_resolve() ;
+  push( 0 ) ;				// the end of the body's thread
+  comma() ;
+  p = (Cell_t *) pop() ;
+  *p = (Cell_t) reduce ;
+  fwd_resolve() ;
+}
+
+void parloop()
+{
+  par_end( NULL ) ;
+}
+
+void parreduce() // ( <word> -- )
+{
+  Dict_t *dp ;
+  Str_t tkn ;
+
+  word() ;
+  tkn = (Str_t) pop() ;
+  dp = lookup( tkn ) ;
+  if( isNul( dp ) ){
+    put_str( tkn ) ;
+    throw( err_NoWord ) ;
+    return ;
+  }
+  par_end( dp ) ;
+}
+
+// a chunk, in the worker's own VM and thread ...
+void *par_thread( void *arg )
+{
+  Par_t *w = (Par_t *) arg ;
+
+  vm = w ->pw_vm ;
+  Base = w ->pw_base ;
+  error_code = error_last = err_OK ;
+  if( setjmp( env ) == 0 ){	// an error stops the chunk, see catch()
+    if( w ->pw_seeded ){
+      push( w ->pw_seed ) ;
+    }
+    push( w ->pw_hi ) ;
+    push( w ->pw_lo ) ;
+    push( (Cell_t) &w ->pw_body ) ;
+    execute() ;
+    if( w ->pw_seeded ){
+      if( tos > (Cell_t *) StartOf( stack ) ){
+        w ->pw_seed = pop() ;
+      } else {
+        error_last = err_StackUdr ;
+      }
+    }
+  }
+  w ->pw_err = error_last ;
+  out_flushall() ;
+  q_reset() ;
+  return NULL ;
+}
+
+// wait for them all, an error may have left some running ...
+void par_join( void )
+{
+  Cell_t k ;
+
+  for( k = 0 ; k < par_Running ; k++ ){
+    if( par_Pool[ k ].pw_started ){
+      pthread_join( par_Pool[ k ].pw_thread, NULL ) ;
+      par_Pool[ k ].pw_started = 0 ;
+    }
+  }
+  par_Running = 0 ;
+}
+
+// the workers, made the first time they are wanted ...
+Wrd_t par_init( Cell_t n )
+{
+  VM_t *caller = vm, *v ;
+  Cell_t k ;
+
+  for( k = 0 ; k < n ; k++ ){
+    if( !isNul( par_Pool[ k ].pw_vm ) ){
+      continue ;
+    }
+    v = off_create( caller ) ;
+    if( isNul( v ) ){
+      return 0 ;
+    }
+    vm = v ;
+    par_Worker = 1 ;
+    quiet = 1 ;				// (pardo) reports what went wrong
+    vm = caller ;
+    par_Pool[ k ].pw_vm = v ;
+  }
+  return 1 ;
+}
+
+void par_free( void )
+{
+  Cell_t k ;
+
+  par_join() ;
+  for( k = 0 ; k < sz_PARDO ; k++ ){
+    if( !isNul( par_Pool[ k ].pw_vm ) ){
+      off_destroy( par_Pool[ k ].pw_vm ) ;
+      par_Pool[ k ].pw_vm = NULL ;
+    }
+  }
+}
+
+void par_do() // ( [seed] limit start -- [n] )
+{
+  Cell_t *ip, *end, lo, hi, n, k ;
+  Dict_t *reduce ;
+  Par_t *w ;
+  Err_t err = err_OK ;
+
+  ip = (Cell_t *) *rtos ;
+  end = (Cell_t *) ip[ 0 ] ;
+  reduce = (Dict_t *) ip[ 1 ] ;
+  chk( isNul( reduce ) ? 2 : 3 ) ;
+  par_join() ;
+  if( par_N < 1 ){
+    par_N = sysconf( _SC_NPROCESSORS_ONLN ) ;
+    par_N = (par_N < 1) ? 1 : (par_N > sz_PARDO) ? sz_PARDO : par_N ;
+  }
+  lo = tos[ 0 ] ;
+  hi = tos[ -1 ] ;
+  n = (hi - lo < par_N) ? hi - lo : par_N ;
+  if( par_Worker || n < 2 || !par_init( n ) ){	// all of it, here
+    w = &par_Pool[ 0 ] ;
+    str_set( (Str_t) &w ->pw_body, 0, sizeof( Dict_t ) ) ;
+    w ->pw_body.cfa = doColon ;
+    w ->pw_body.nfa = "(pardo)" ;
+    w ->pw_body.pfa = ip + 2 ;
+    push( (Cell_t) &w ->pw_body ) ;
+    execute() ;
+    *rtos = (Cell_t) end ;
+    return ;
+  }
+  tos -= 2 ;				// limit and start, the seed stays
+  for( k = 0 ; k < n ; k++ ){
+    w = &par_Pool[ k ] ;
+    str_set( (Str_t) &w ->pw_body, 0, sizeof( Dict_t ) ) ;
+    w ->pw_body.cfa = doColon ;
+    w ->pw_body.nfa = "(pardo)" ;
+    w ->pw_body.pfa = ip + 2 ;
+    w ->pw_lo = lo + (hi - lo) * k / n ;
+    w ->pw_hi = lo + (hi - lo) * (k + 1) / n ;
+    w ->pw_seeded = !isNul( reduce ) ;
+    w ->pw_seed = isNul( reduce ) ? 0 : *tos ;
+    w ->pw_base = Base ;
+    w ->pw_err = err_OK ;
+    w ->pw_started = (pthread_create( &w ->pw_thread, NULL, par_thread, w ) == 0) ;
+    if( !w ->pw_started ){
+      w ->pw_err = err_SysCall ;
+    }
+    par_Running = k + 1 ;
+  }
+  par_join() ;
+  *rtos = (Cell_t) end ;
+  for( k = 0 ; k < n && err == err_OK ; k++ ){
+    err = par_Pool[ k ].pw_err ;
+  }
+  if( err == err_CaughtSignal ){		// sigval went with the worker
+    err = err_BadState ;
+  }
+  if( err != err_OK ){
+    throw( err ) ;
+    return ;
+  }
+  if( isNul( reduce ) ){
+    return ;
+  }
+  *tos = par_Pool[ 0 ].pw_seed ;
+  for( k = 1 ; k < n && error_code == err_OK ; k++ ){
+    push( par_Pool[ k ].pw_seed ) ;
+    push( (Cell_t) reduce ) ;
+    execute() ;
+  }
+}
+
+void par_workers() // ( n -- )
+{
+  Cell_t n ;
+
+  chk( 1 ) ;
+  n = pop() ;
+  if( n < 1 || n > sz_PARDO ){
+    throw( err_Range ) ;
+    return ;
+  }
+  par_N = n ;
+}
+#endif
+
+void fmt_start() 	// ( n -- <ptr> n )
+{
+  Str_t ptr ;
+
+  chk( 1 ) ;
+
+  sign_is_negative = 0 ;
+  ptr = tb_get( TB ) + tb_bufsize( TB ) - 1 ;
+  *(ptr--) = (Byt_t) 0 ;		// drop a null byte at the end of the buffer ...
+  push( ptr ) ;					// back the buffer up for the next char ... 
+  swap() ;						// ( n ptr -- ptr n )
+}
+
+void fmt_digit()	// ( <ptr> n -- <ptr-1> n2 ) : # dup base @ % . base @ / ;
+{
+  register Cell_t n, digit ;
+  Str_t ptr ;
+
+  if( *tos )
+  {
+    // fmt_sign() ;
+    n = pop() ;						//	( ptr n -- ptr )
+    ptr = (Str_t) pop() ;			//  ( ptr -- )
+    digit = ( (Abs( n ) % Base) ) ;
+    n /= Base ;
+    *(ptr--) = digits[digit] ;
+    push( ptr ) ;					// ( ptr -- ptr-1 )
+    push( n ) ;						// ( ptr -- ptr n2 )
+  } else {
+    push( (Cell_t) '0' ) ;			// ( ptr n -- ptr n 0 )
+    fmt_hold() ;					// ( ptr n 0 -- ptr-1 n )
+  }
+}
+
+void fmt_hold() // ( <ptr> x n -- <ptr-1> x )
+{
+  Cell_t n ;
+  Str_t ptr ;
+
+  n = pop() ;						// ( ptr x n -- ptr x )
+  ptr = (Str_t) nos ;				// ( ptr x -- ptr x )
+  *ptr = (Byt_t) n ;				// ( ptr x -- ptr-1 x )
+  nos = (Cell_t) --ptr ;
 }
 
-void closeout()
+void fmt_sign() // ( <ptr> n -- <ptr> n )
 {
-#ifdef HOSTED
-  if( out_This > 0 ){
-    close( OUTPUT ) ;
-    out_This-- ;
+  if( *tos != 0 && *tos < 0 )
+  {
+    sign_is_negative = 1 ;
   }
-#endif
 }
 
-void isfile()
+void fmt_num() // ( <ptr> n -- <ptr*> 0 )
 {
-#ifdef HOSTED
-  struct stat sbuf ;
-  Cell_t rv ;
-  Str_t fn = (Str_t) pop() ;
+  uByt_t *p ;
 
-  if( !isNul( fn ) )
-  {
-    rv = stat( (const Str_t ) fn, &sbuf ) ;
-    if( rv < 0 )
-    {
-      throw( err_SysCall ) ;
-    }
+  if( *tos ){
+    p = (uByt_t *) nos + 1 ;
+    p = str_digits( p, (*tos < 0) ? -(uCell_t) *tos : (uCell_t) *tos, Base ) ;
+    nos = (Cell_t) (p - 1) ;
+    *tos = 0 ;
   }
-  push( (rv == 0) ? 1 : 0 ) ; 
-#endif
 }
 
-Wrd_t outp( Wrd_t fd, Str_t buf, Wrd_t len )
+void fmt_end() // ( <ptr> n -- <ptr> ) 
 {
-#ifdef HOSTED
-  Wrd_t nx ;
-
- again:
-  nx = write( fd, buf, len ) ;
-  if( nx < 0 )
+  if( sign_is_negative )
   {
-    if( errno == EINTR )
-      goto again ;
+    push( (Cell_t) '-' ) ;
+    fmt_hold() ;
   }
-  return nx ; 
+  drop() ;
+  plusplus() ;
+}
 
-#endif
-#ifdef NATIVE
-  Wrd_t i ;
+void utf8_encode() // ( char buf len -- len )
+{
+  Cell_t ch, len ;
+  Str_t  buf ;
 
-  for( i = 0 ; i < len; i++ )
-  {
-    uart_putc( (unsigned) buf[i]&0xff );
-  }
-  return i ;
+  chk( 3 ) ;
+  len = (Wrd_t) pop() ;
+  buf = (Str_t) pop() ;
+  ch  = (Wrd_t) pop() ;
 
-#endif
+  push( (Wrd_t) utf8_encoder( ch, buf, len ) ) ;
 }
 
-Wrd_t inp( Wrd_t fd, Str_t buf, Wrd_t len )
+void qaccept() // ( buf len -- len )
 {
+  Cell_t len ;
+  Str_t  buf ;
 
-#ifdef HOSTED
-  Wrd_t nx ;
-
- again:
-  nx = read( fd, buf, len ) ;
-  if( nx < 0 )
-  {
-    if( errno == EINTR )
-      goto again ;
-  }
-  return nx ; 
-#endif
+  len = (Wrd_t) pop() ;
+  buf = (Str_t) pop() ;
 
-#ifdef NATIVE
-  Cell_t c, x, i = 0 ;
+  out_flushall() ;
+  push( (Wrd_t) get_str( INPUT, buf, len ) ) ;
   
-  str_set( buf, 0, len ) ;
-  while( i < len )
-  {
-    buf[i++] = c = uart_getc();
-    if( c == 0x15 ) // NAK
-    {
-       str_set( buf, 0, len ) ;
-       int slen = str_length( buf ) ;
-       uart_putc( 0x0a ) ;
-       for( x = 0 ; x < slen; x++ )
-           uart_putc( 0x20 ) ;
-       uart_putc( 0x0a ) ;
-       i = 0 ;
-       continue ;
-    }
-    if( c == 0x08 || c == 0x7f ) // backspace || delete
-    {
-       buf[--i] = 0x00 ; // backspace
-       buf[--i] = 0x00 ; // bad char
-       i = i < 0 ? 0 : i ;
-       uart_putc( 0x20 ) ; // space
-       uart_putc( 0x08 ) ; // backspace
-       continue ;
-    }
-    if( c == 0x0d ) // return 
-    {
-       uart_putc( 0x0a ) ; // newline
-       break ;
-    }
-  }
-  return i ;
-#endif
 }
 
-#if defined avr || defined AVR
-Wrd_t read( Wrd_t fd, Str_t buf, Wrd_t len ) {}
-Wrd_t write( Wrd_t fd, Str_t buf, Wrd_t len ) {}
-#endif
-
-#ifdef HOSTED 
-void qdlopen()
+// a dictionary entry, or NULL for a literal, a loop index or whatever
+// else the cell holds ...
+Dict_t *dump_word( Cell_t c )
 {
-  Str_t lib ;
-  Opq_t opaque ;
+  Byt_t *p = (Byt_t *) c ;
 
-  chk( 1 ) ; 
-  lib = (Str_t) pop() ;
-  opaque = dlopen( lib, RTLD_NOW | RTLD_GLOBAL ) ;
-  push( (Cell_t) opaque ) ;
+  if( p >= (Byt_t *) Primitives && p < (Byt_t *) &Primitives[ n_Primitives ] &&
+      (p - (Byt_t *) Primitives) % sizeof( Dict_t ) == 0 ){
+    return (Dict_t *) c ;
+  }
+  if( p >= (Byt_t *) Colon_Defs && p < (Byt_t *) &Colon_Defs[ n_ColonDefs ] &&
+      (p - (Byt_t *) Colon_Defs) % sizeof( Dict_t ) == 0 ){
+    return (Dict_t *) c ;
+  }
+  return NULL ;
 }
 
-void qdlclose()
+// rstack holds loop indices, and under CLASSIC the state a timer
+// callback saved, as well as threads, so only cells in flash are
+// followed ...
+void dump()
 {
-  Opq_t opaque ;
+  Cell_t  **p ;
+  Dict_t *dp ;
 
-  chk( 1 ) ; 
-  opaque = (Opq_t) pop() ;
-  push( (Cell_t) dlclose( opaque ) ) ;
-}
+  if( quiet ) return ;
 
-void qdlsym()
-{
-  Str_t symbol ;
-  Opq_t handle ;
+  fmt_out( "-- Input File: %s Line: %d:\n", InputStack[ in_This ].name, InputStack[ in_This ].in_line ) ;
+  fmt_out( "-- Forth Backtrace:\n" ) ;
+  while( rtos > StartOf( rstack ) )
+  {
+    p = (Cell_t **) rpop() ;
+    if( (Cell_t *) p > flash && (Cell_t *) p < Here )
+    {
+        dp = dump_word( (Cell_t) *p ) ;
+        if( !isNul( dp ) )
+		  fmt_out( "  -- %x %x (%s)\n", (p), dp, dp->nfa ) ;
 
-  chk( 2 ) ; 
-  symbol = (Str_t) pop() ;
-  handle = (Opq_t) pop() ;
-  push( (Cell_t) dlsym( handle, symbol ) ) ;
+        dp = dump_word( (Cell_t) *(p-1) ) ;
+        if( !isNul( dp ) )
+        {
+		  fmt_out( "  -- %x %x (%s)\n", (p-1), dp, dp->nfa ) ;
+        }
+    }
+  }
 }
 
-void qdlerror()
+void find() // ( strptr -- dp|0 )
 {
-  push( (Cell_t) dlerror() ) ;
+  Str_t tkn = (Str_t) pop() ;
+  push( ((Dict_t *) lookup( (Str_t) tkn )) ) ;
 }
 
-void last_will()
+#ifdef HOSTED
+void path()
 {
-  Opq_t cmd ;
-
-  chk( 1 ) ; 
-  cmd = (Opq_t) pop() ;
-  atexit( cmd ) ;
+	push( off_path ) ; 
 }
+#endif
 
-void spinner()
+void version()
 {
-  static Wrd_t ix = 0 ;
-  Byt_t f[4] = { '-', '\\', '|', '/' } ;
-
-  push( f[ ix++ % 4 ] ) ;
-  emit();
-  push( '\r' ) ;
-  emit();
+  push( str_literal( MAJOR, Base ) ) ;
+  push( str_literal( MINOR, Base ) ) ;
+  push( str_literal( REVISION, Base ) ) ;
 
 }
-#endif /* HOSTED */
 
-void callout()
+void data()
 {
-  Cptr_t fun ;
-  Cell_t i, n ;
-  Cell_t args[10] ;
-
-  fun = (Cptr_t) pop() ;
-  n = pop() ;
-
-  chk( n ) ; /* really need n+2 items ... */
-
-  for( i = n-1 ; i >= 0 ; i-- ){
-    args[i] = pop() ;
-  }
+  push( (Cell_t *) Colon_Defs );
+}
 
-  switch( n ){
-    case 0:
-      push( (*fun)() ) ;
-      break ;
-    case 1:
-      push( (*fun)( args[0] ) ) ;
-      break ;
-    case 2:
-      push( (*fun)( args[0], args[1] ) ) ;
-      break ;
-    case 3:
-      push( (*fun)( args[0], args[1], args[2] ) ) ;
-      break ;
-    case 4:
-      push( (*fun)( args[0], args[1], args[2], args[3] ) ) ;
-      break ;
-    case 5:
-      push( (*fun)( args[0], args[1], args[2], args[3], args[4] ) ) ;
-      break ;
-    case 6:
-      push( (*fun)( args[0], args[1], args[2], args[3], args[4], args[5] ) ) ;
-      break ;
-    case 7:
-      push( (*fun)( args[0], args[1], args[2], args[3], args[4], args[5], args[6] ) ) ;
-      break ;
-    case 8:
-      push( (*fun)( args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7] ) ) ;
-      break ;
-    case 9:
-      push( (*fun)( args[0], args[1], args[2], args[3], args[4], args[5], args[6], args[7], args[8] ) ) ;
-      break ;
-  }
-  return ;
+void code()
+{
+  push( (Cell_t *) Primitives );
 }
 
-void clkspersec()
+void align() // ( adr -- adr' )
 {
-#ifdef HOSTED
-  push( CLOCKS_PER_SEC ) ;
-#else
-  push( -1 ) ;
-#endif
+	Cell_t adr = *tos ;
+
+	while( adr % sizeof( Cell_t ) )
+	{
+      adr++;
+	}
+	*tos = adr ;
 }
 
-void plusplus()
+void fill() // ( dst n char -- )
 {
-  *(tos) += 1; 
+  Byt_t ch ;
+  Wrd_t n ;
+  Str_t dst ;
+
+  chk( 3 ) ; 
+  ch = (Byt_t) pop() ;
+  n = (Wrd_t) pop() ;
+  dst = (Str_t) pop() ;
+  str_set( dst, ch, n ) ;
 }
 
-void minusminus()
+void move() // ( src dst n -- )
 {
-  *(tos) -= 1; 
+  Wrd_t n ;
+  Str_t dst ;
+
+  chk( 3 ) ;
+  n = (Wrd_t) pop() ;
+  dst = (Str_t) pop() ;
+  str_move( dst, (Str_t) pop(), n ) ;
+}
+
+void compare() // ( a1 n1 a2 n2 -- n )
+{
+  Wrd_t n1, n2, rv ;
+  Str_t a1, a2 ;
+
+  chk( 4 ) ;
+  n2 = pop() ;
+  a2 = (Str_t) pop() ;
+  n1 = pop() ;
+  a1 = (Str_t) *tos ;
+  rv = str_cmp( a1, a2, (n1 < n2) ? n1 : n2 ) ;
+  *tos = (rv != 0) ? rv : (n1 < n2) ? -1 : (n1 > n2) ? 1 : 0 ;
+}
+
+void search() // ( a1 n1 a2 n2 -- a3 n3 f )
+{
+  Wrd_t n1, n2 ;
+  Str_t a1, a2, p, end ;
+
+  chk( 4 ) ;
+  n2 = pop() ;
+  a2 = (Str_t) pop() ;
+  n1 = tos[0] ;
+  a1 = (Str_t) tos[-1] ;
+  if( n2 > 0 ){
+    end = a1 + n1 - n2 + 1 ;
+    for( p = a1 ; p < end ; p++ ){
+      p = str_scan( p, end - p, *a2, 0 ) ;
+      if( p < end && str_cmp( p, a2, n2 ) == 0 ){
+        tos[-1] = (Cell_t) p ;
+        tos[0] = a1 + n1 - p ;
+        push( 1 ) ;
+        return ;
+      }
+    }
+    push( 0 ) ;
+    return ;
+  }
+  push( 1 ) ;
 }
 
-void utime()
+void scan_skip( Wrd_t skip )
 {
-#ifdef HOSTED
-  struct timeval tv ;
-  uint64_t rv = 0ULL ;
+  Byt_t ch ;
+  Str_t p ;
 
-  gettimeofday( &tv, NULL ) ;
-  push( ( tv.tv_sec * 1000000 ) + tv.tv_usec ) ;
-#else
-  push( -1 ) ;
-#endif
+  chk( 3 ) ;
+  ch = (Byt_t) pop() ;
+  p = str_scan( (Str_t) tos[-1], tos[0], ch, skip ) ;
+  tos[0] -= p - (Str_t) tos[-1] ;
+  tos[-1] = (Cell_t) p ;
 }
 
-void ops()
+void scan() // ( addr n char -- addr' n' )
 {
-   push( _ops ) ; 
+  scan_skip( 0 ) ;
 }
 
-void noops()
+void skip() // ( addr n char -- addr' n' )
 {
-   _ops = 0 ; 
+  scan_skip( 1 ) ;
 }
 
-void qdo()
+void cell_fill() // ( addr n x -- )
 {
-  push( (Cell_t) lookup( "(do)" ) ) ; 
-  comma() ;
-  bkw_mark();
+  Cell_t x, n, *p ;
+
+  chk( 3 ) ;
+  x = pop() ;
+  n = pop() ;
+  for( p = (Cell_t *) pop() ; n-- > 0 ; ){
+    *p++ = x ;
+  }
 }
 
-void do_do()
+// numbers straight from the input into a cell array, in base and
+// separated by white space or commas, without lookup() ... reading
+// stops at n, or at a token which is not a number, left for the
+// interpreter.  m is how many were read.
+void read_cells() // ( addr n -- m )
 {
-  Cell_t nxt ;
+  Input_t *input = &InputStack[ in_This ] ;
+  Cell_t *a, n, m = 0 ;
+  Str_t tkn, p, q, end ;
+  Wrd_t len ;
 
   chk( 2 ) ;
-  nxt = rpop() ;
-  swap() ;
-  rpush( pop() ) ; /* end point */
-  rpush( pop() ) ; /* index */
-  rpush( nxt ) ; 
+  n = pop() ;
+  a = (Cell_t *) pop() ;
+  while( m < n ){
+    tkn = str_slice( input, &len ) ;
+    if( isNul( tkn ) ){
+      continue ;
+    }
+    if( tkn == (Str_t) inEOF ){
+      break ;
+    }
+    end = tkn + len ;
+    for( p = tkn ; p < end && m < n ; p = q + 1 ){
+      for( q = p ; q < end && *q != ',' ; q++ ) ;
+      if( q > p && !isNul( str_number( p, q - p, Base, &a[ m ] ) ) ){
+        break ;
+      }
+      m += (q > p) ;
+    }
+    if( p < end ){		// the interpreter gets the rest
+      in_Back = p ;
+      in_BackLen = end - p ;
+      break ;
+    }
+  }
+  push( m ) ;
 }
 
-void do_loop()
+// and back out, eight to a line ...
+void write_cells() // ( addr n base -- )
 {
-  Cell_t nxt ;
+  Byt_t buf[ 8 * sizeof( Cell_t ) + 2 ] ;
+  Cell_t *a, n, base, i ;
+  Wrd_t len ;
 
-  nxt = (Cell_t ) rpop() ;	// save nxt
-  if ( *(rtos)+1 < *(rnos) ){	// if i < n
-    *rtos += 1; 		// ++i
-    rpush( nxt ) ; 		// restore nxt
-    push( 0 ) ;			// flag for ?branch
-    return ;
+  chk( 3 ) ;
+  base = pop() ;
+  n = pop() ;
+  a = (Cell_t *) pop() ;
+  for( i = 0 ; i < n ; i++ ){
+    len = str_ntoa( (Str_t) buf, sizeof( buf ) - 1, a[ i ], base, 1 ) ;
+    buf[ len++ ] = ((i % 8) == 7 || i == n - 1) ? '\n' : ' ' ;
+    outp( OUTPUT, (Str_t) buf, len ) ;
   }
+}
 
-  rtos-- ; rtos-- ;		// drop i, n
-  rpush( nxt ) ;		// restore nxt
-  push( 1 ) ;			// flag for ?branch
+void cell_move() // ( src dst n -- )
+{
+  Cell_t n, *src, *dst ;
 
+  chk( 3 ) ;
+  n = pop() ;
+  dst = (Cell_t *) pop() ;
+  src = (Cell_t *) pop() ;
+  if( dst <= src || dst >= src + n ){
+    while( n-- > 0 ) *dst++ = *src++ ;
+  } else {
+    while( n-- > 0 ) dst[n] = src[n] ;
+  }
 }
 
-void loop()
-{
+// typed arrays ... a header of element size and count, then the
+// elements, in flash.  The kernels below run over a whole array per
+// call, written as plain loops over the element type so the compiler
+// can vectorize them.  Arrays of different element sizes are combined
+// a chunk at a time through a buffer of cells.
+typedef struct {
+  Cell_t ar_size ;		// bytes per element, 1 2 4 or a cell
+  Cell_t ar_len ;		// number of elements
+  Cell_t ar_data[] ;
+} Array_t ;
 
-  push( (Cell_t) lookup( "(loop)" ) );
-  comma(); 
+typedef enum {
+  arr_Add,
+  arr_Sub,
+  arr_Mul,
+  arr_And,
+  arr_Or,
+  arr_Shl,
+  arr_Shr
+} Arr_Op_t ;
+
+#define sz_ARRCHUNK	128
+
+// gcc only vectorizes cheap loops at -O2, the kernels ask for more
+#if defined( __GNUC__ ) && !defined( __clang__ )
+#define arr_Kernel	__attribute__(( optimize( "tree-vectorize", "vect-cost-model=dynamic" ) ))
+#else
+#define arr_Kernel
+#endif
 
-  push( (Cell_t) lookup( "?branch" ) );
-  comma() ;
-  bkw_resolve() ;
+#define arr_typed( size, ... ) \
+  switch( size ){ \
+    case 1: { typedef int8_t El_t ; __VA_ARGS__ ; } break ; \
+    case 2: { typedef int16_t El_t ; __VA_ARGS__ ; } break ; \
+    case 4: { typedef int32_t El_t ; __VA_ARGS__ ; } break ; \
+    default: { typedef Cell_t El_t ; __VA_ARGS__ ; } break ; \
+  }
 
+#define arr_zip( op, x, y, z, n ) \
+  switch( op ){ \
+    case arr_Add: for( i = 0 ; i < n ; i++ ) z[i] = (uCell_t) x[i] + y[i] ; break ; \
+    case arr_Sub: for( i = 0 ; i < n ; i++ ) z[i] = (uCell_t) x[i] - y[i] ; break ; \
+    case arr_Mul: for( i = 0 ; i < n ; i++ ) z[i] = (uCell_t) x[i] * y[i] ; break ; \
+    case arr_And: for( i = 0 ; i < n ; i++ ) z[i] = x[i] & y[i] ; break ; \
+    case arr_Or:  for( i = 0 ; i < n ; i++ ) z[i] = x[i] | y[i] ; break ; \
+    default: break ; \
+  }
+
+#define arr_map( op, x, k, z, n ) \
+  switch( op ){ \
+    case arr_Mul: for( i = 0 ; i < n ; i++ ) z[i] = (uCell_t) x[i] * k ; break ; \
+    case arr_Shl: for( i = 0 ; i < n ; i++ ) z[i] = (uCell_t) x[i] << k ; break ; \
+    case arr_Shr: for( i = 0 ; i < n ; i++ ) z[i] = (Cell_t) x[i] >> k ; break ; \
+    default: break ; \
+  }
+
+Cell_t arr_min( Array_t *a, Array_t *b )
+{
+  return (a ->ar_len < b ->ar_len) ? a ->ar_len : b ->ar_len ;
 }
 
-void do_I()
+arr_Kernel void arr_load( Array_t *a, Cell_t at, Cell_t n, Cell_t *x )
 {
-  push( *rnos );
+  Cell_t i ;
+
+  arr_typed( a ->ar_size,
+    El_t *p = (El_t *) a ->ar_data + at ;
+    for( i = 0 ; i < n ; i++ ) x[i] = p[i] ) ;
 }
 
-void ploop()
+arr_Kernel void arr_store( Array_t *a, Cell_t at, Cell_t n, Cell_t *x )
 {
+  Cell_t i ;
 
-  push( (Cell_t) lookup( "(+loop)" ) );
-  comma(); 
+  arr_typed( a ->ar_size,
+    El_t *p = (El_t *) a ->ar_data + at ;
+    for( i = 0 ; i < n ; i++ ) p[i] = x[i] ) ;
+}
 
-  push( (Cell_t) lookup( "?branch" ) );
-  comma() ;
-  bkw_resolve() ;
+arr_Kernel void arr_binary( Arr_Op_t op ) // ( a b c -- )
+{
+  Cell_t x[ sz_ARRCHUNK ], y[ sz_ARRCHUNK ] ;
+  Cell_t i, at, n, len ;
+  Array_t *a, *b, *c ;
 
+  chk( 3 ) ;
+  c = (Array_t *) pop() ;
+  b = (Array_t *) pop() ;
+  a = (Array_t *) pop() ;
+  len = arr_min( a, b ) ;
+  len = (len < c ->ar_len) ? len : c ->ar_len ;
+  if( a ->ar_size == c ->ar_size && b ->ar_size == c ->ar_size ){
+    arr_typed( c ->ar_size,
+      El_t *p = (El_t *) a ->ar_data, *q = (El_t *) b ->ar_data ;
+      El_t *r = (El_t *) c ->ar_data ;
+      arr_zip( op, p, q, r, len ) ) ;
+    return ;
+  }
+  for( at = 0 ; at < len ; at += n ){
+    n = (len - at < sz_ARRCHUNK) ? len - at : sz_ARRCHUNK ;
+    arr_load( a, at, n, x ) ;
+    arr_load( b, at, n, y ) ;
+    arr_zip( op, x, y, x, n ) ;
+    arr_store( c, at, n, x ) ;
+  }
 }
 
-void do_ploop()
+arr_Kernel void arr_scalar( Arr_Op_t op ) // ( a k c -- )
 {
-  Cell_t nxt, inc ;
+  Cell_t x[ sz_ARRCHUNK ] ;
+  Cell_t i, at, n, len, k ;
+  Array_t *a, *c ;
 
-  inc = pop() ;
-  nxt = (Cell_t ) rpop() ;
-  if ( inc > 0 ) /* positive increment */
-  {
-    if ( ( *(rtos) + inc )< *(rnos) ){
-      *rtos += inc ;
-      rpush( nxt ) ; 
-      push( 0 ) ;
-      return ;
+  chk( 3 ) ;
+  c = (Array_t *) pop() ;
+  k = pop() ;
+  a = (Array_t *) pop() ;
+  len = arr_min( a, c ) ;
+  if( op == arr_Shl ){
+    if( k < 0 ){
+      op = arr_Shr ;
+      k = -k ;
     }
+    k = (k < 8 * sizeof( Cell_t )) ? k : 8 * sizeof( Cell_t ) - 1 ;
+  }
+  if( a ->ar_size == c ->ar_size ){
+    arr_typed( c ->ar_size,
+      El_t *p = (El_t *) a ->ar_data, *r = (El_t *) c ->ar_data ;
+      arr_map( op, p, k, r, len ) ) ;
+    return ;
+  }
+  for( at = 0 ; at < len ; at += n ){
+    n = (len - at < sz_ARRCHUNK) ? len - at : sz_ARRCHUNK ;
+    arr_load( a, at, n, x ) ;
+    arr_map( op, x, k, x, n ) ;
+    arr_store( c, at, n, x ) ;
+  }
+}
 
-  } else { /* negative increment */
-    if ( ( *(rtos) + inc )> *(rnos) ){
-      *rtos += inc ;
-      rpush( nxt ) ; 
-      push( 0 ) ;
-      return ;
-    }
+void array() // ( n size -- )
+{
+  Cell_t n, size, cells ;
+  Array_t *a ;
 
+  chk( 2 ) ;
+  size = pop() ;
+  n = pop() ;
+  if( n < 0 || size > sizeof( Cell_t ) || (size != 1 && size != 2 && size != 4 && size != sizeof( Cell_t )) ){
+    throw( err_Range ) ;
+    return ;
   }
+  cells = 2 + (n * size + sizeof( Cell_t ) - 1) / sizeof( Cell_t ) ;
+  freespace() ;
+  if( pop() < cells * (Cell_t) sizeof( Cell_t ) ){
+    throw( err_NoSpace ) ;
+    return ;
+  }
+  create() ;
+  a = (Array_t *) Here ;
+  a ->ar_size = size ;
+  a ->ar_len = n ;
+  str_set( (Str_t) a ->ar_data, 0, n * size ) ;
+  Here += cells ;
+}
 
-  rtos-- ; rtos-- ;		// drop i, n ...
-  rpush( nxt ) ;		// restore nxt ...
-  push( 1 ) ;			// flag for ?branch ...
-
+void array_len() // ( arr -- n )
+{
+  chk( 1 ) ;
+  *tos = ((Array_t *) *tos) ->ar_len ;
 }
 
-void forget()
+void array_fetch() // ( i arr -- x )
 {
-  if( !isNul( TB ) )
-  {
-    TB = tb_destroy( TB ) ;
+  Array_t *a ;
+  Cell_t i ;
+
+  chk( 2 ) ;
+  a = (Array_t *) pop() ;
+  i = *tos ;
+  if( i < 0 || i >= a ->ar_len ){
+    throw( err_Range ) ;
+    return ;
   }
-  TB = tb_create( &T, (Byt_t *) tmp_buffer, (Wrd_t) sz_TMPBUFFER, (Wrd_t) nm_TMPBUFFER ) ;
+  arr_load( a, i, 1, tos ) ;
+}
 
-  Here = (Cell_t *) StartOf( flash ) ;		// erase colon defs vars and constants ...
-  DictPtr = (Cell_t *) StartOf( flash ) ;	// set the dictptr to here ...
-  n_ColonDefs = 0 ; 				// uncount the colon defs ... 
-  Base = 10 ;
-  Trace = 0 ;
-  state = state_Interactive ;
+void array_store() // ( x i arr -- )
+{
+  Array_t *a ;
+  Cell_t i ;
 
-  if( isNul( String_LowWater ) )
-	String_Data = (Byt_t *) (&flash[sz_FLASH - 1]) ;	// erase the string data referenced in the dictionary
-  else
-  	String_Data = (Byt_t *) String_LowWater ;
+  chk( 3 ) ;
+  a = (Array_t *) pop() ;
+  i = pop() ;
+  if( i < 0 || i >= a ->ar_len ){
+    throw( err_Range ) ;
+    return ;
+  }
+  arr_store( a, i, 1, tos ) ;
+  drop() ;
 }
 
-int sign_is_negative = 0 ; 
+void array_add() // ( a b c -- )
+{
+  arr_binary( arr_Add ) ;
+}
 
-void fmt_start() 	// ( n -- <ptr> n )
+void array_sub() // ( a b c -- )
 {
-  Str_t ptr ;
+  arr_binary( arr_Sub ) ;
+}
 
-  chk( 1 ) ;
+void array_mul() // ( a b c -- )
+{
+  arr_binary( arr_Mul ) ;
+}
 
-  sign_is_negative = 0 ;
-  ptr = tb_get( TB ) + tb_bufsize( TB ) - 1 ;
-  *(ptr--) = (Byt_t) 0 ;		// drop a null byte at the end of the buffer ...
-  push( ptr ) ;					// back the buffer up for the next char ... 
-  swap() ;						// ( n ptr -- ptr n )
+void array_and() // ( a b c -- )
+{
+  arr_binary( arr_And ) ;
 }
 
-void fmt_digit()	// ( <ptr> n -- <ptr-1> n2 ) : # dup base @ % . base @ / ;
+void array_or() // ( a b c -- )
 {
-  register Cell_t n, digit ;
-  Str_t ptr ;
+  arr_binary( arr_Or ) ;
+}
 
-  if( *tos )
-  {
-    // fmt_sign() ;
-    n = pop() ;						//	( ptr n -- ptr )
-    ptr = (Str_t) pop() ;			//  ( ptr -- )
-    digit = ( (Abs( n ) % Base) ) ;
-    n /= Base ;
-    *(ptr--) = digits[digit] ;
-    push( ptr ) ;					// ( ptr -- ptr-1 )
-    push( n ) ;						// ( ptr -- ptr n2 )
-  } else {
-    push( (Cell_t) '0' ) ;			// ( ptr n -- ptr n 0 )
-    fmt_hold() ;					// ( ptr n 0 -- ptr-1 n )
-  }
+void array_shift() // ( a k c -- )  left for k > 0, arithmetic right for k < 0
+{
+  arr_scalar( arr_Shl ) ;
 }
 
-void fmt_hold() // ( <ptr> x n -- <ptr-1> x )
+void array_scale() // ( a k c -- )
 {
-  Cell_t n ;
-  Str_t ptr ;
+  arr_scalar( arr_Mul ) ;
+}
 
-  n = pop() ;						// ( ptr x n -- ptr x )
-  ptr = (Str_t) nos ;				// ( ptr x -- ptr x )
-  *ptr = (Byt_t) n ;				// ( ptr x -- ptr-1 x )
-  nos = (Cell_t) --ptr ;
+arr_Kernel void array_sum() // ( a -- n )
+{
+  Cell_t i, len, acc = 0 ;
+  Array_t *a ;
+
+  chk( 1 ) ;
+  a = (Array_t *) pop() ;
+  len = a ->ar_len ;
+  arr_typed( a ->ar_size,
+    El_t *p = (El_t *) a ->ar_data ;
+    for( i = 0 ; i < len ; i++ ) acc += p[i] ) ;
+  push( acc ) ;
 }
 
-void fmt_sign() // ( <ptr> n -- <ptr> n )
+arr_Kernel void arr_extreme( Wrd_t max ) // ( a -- n )
 {
-  if( *tos != 0 && *tos < 0 )
-  {
-    sign_is_negative = 1 ;
+  Cell_t i, len, acc = 0 ;
+  Array_t *a ;
+
+  chk( 1 ) ;
+  a = (Array_t *) pop() ;
+  len = a ->ar_len ;
+  if( len > 0 ){
+    arr_typed( a ->ar_size,
+      El_t *p = (El_t *) a ->ar_data, m = p[0] ;
+      if( max ){
+        for( i = 1 ; i < len ; i++ ) m = (p[i] > m) ? p[i] : m ;
+      } else {
+        for( i = 1 ; i < len ; i++ ) m = (p[i] < m) ? p[i] : m ;
+      }
+      acc = m ) ;
   }
+  push( acc ) ;
 }
 
-void fmt_num() // ( <ptr> n -- <ptr*> 0 )
+void array_min() // ( a -- n )
 {
-  while( *tos ) fmt_digit() ;
+  arr_extreme( 0 ) ;
 }
 
-void fmt_end() // ( <ptr> n -- <ptr> ) 
+void array_max() // ( a -- n )
 {
-  if( sign_is_negative )
-  {
-    push( (Cell_t) '-' ) ;
-    fmt_hold() ;
-  }
-  drop() ;
-  plusplus() ;
+  arr_extreme( 1 ) ;
 }
 
-void utf8_encode() // ( char buf len -- len )
+arr_Kernel void array_dot() // ( a b -- n )
 {
-  Cell_t ch, len ;
-  Str_t  buf ;
+  Cell_t x[ sz_ARRCHUNK ], y[ sz_ARRCHUNK ] ;
+  Cell_t i, at, n, len, acc = 0 ;
+  Array_t *a, *b ;
 
-  chk( 3 ) ;
-  len = (Wrd_t) pop() ;
-  buf = (Str_t) pop() ;
-  ch  = (Wrd_t) pop() ;
+  chk( 2 ) ;
+  b = (Array_t *) pop() ;
+  a = (Array_t *) pop() ;
+  len = arr_min( a, b ) ;
+  if( a ->ar_size == b ->ar_size ){
+    arr_typed( a ->ar_size,
+      El_t *p = (El_t *) a ->ar_data, *q = (El_t *) b ->ar_data ;
+      for( i = 0 ; i < len ; i++ ) acc += (uCell_t) p[i] * q[i] ) ;
+  } else {
+    for( at = 0 ; at < len ; at += n ){
+      n = (len - at < sz_ARRCHUNK) ? len - at : sz_ARRCHUNK ;
+      arr_load( a, at, n, x ) ;
+      arr_load( b, at, n, y ) ;
+      for( i = 0 ; i < n ; i++ ) acc += (uCell_t) x[i] * y[i] ;
+    }
+  }
+  push( acc ) ;
+}
 
-  push( (Wrd_t) utf8_encoder( ch, buf, len ) ) ;
+arr_Kernel void array_scan() // ( a c -- )  c[i] = a[0] + ... + a[i]
+{
+  Cell_t x[ sz_ARRCHUNK ] ;
+  Cell_t i, at, n, len, acc = 0 ;
+  Array_t *a, *c ;
+
+  chk( 2 ) ;
+  c = (Array_t *) pop() ;
+  a = (Array_t *) pop() ;
+  len = arr_min( a, c ) ;
+  for( at = 0 ; at < len ; at += n ){
+    n = (len - at < sz_ARRCHUNK) ? len - at : sz_ARRCHUNK ;
+    arr_load( a, at, n, x ) ;
+    for( i = 0 ; i < n ; i++ ) x[i] = acc += x[i] ;
+    arr_store( c, at, n, x ) ;
+  }
 }
 
-void accept() // ( buf len -- len )
+void array_convert() // ( a c -- )  copy, sign extending or truncating
 {
-  Cell_t len ;
-  Str_t  buf ;
+  Cell_t x[ sz_ARRCHUNK ] ;
+  Cell_t at, n, len ;
+  Array_t *a, *c ;
 
-  len = (Wrd_t) pop() ;
-  buf = (Str_t) pop() ;
+  chk( 2 ) ;
+  c = (Array_t *) pop() ;
+  a = (Array_t *) pop() ;
+  len = arr_min( a, c ) ;
+  if( a ->ar_size == c ->ar_size ){
+    str_move( (Str_t) c ->ar_data, (Str_t) a ->ar_data, len * a ->ar_size ) ;
+    return ;
+  }
+  for( at = 0 ; at < len ; at += n ){
+    n = (len - at < sz_ARRCHUNK) ? len - at : sz_ARRCHUNK ;
+    arr_load( a, at, n, x ) ;
+    arr_store( c, at, n, x ) ;
+  }
+}
 
-  push( (Wrd_t) get_str( INPUT, buf, len ) ) ;
-  
+// regions and pools carved out of flash, for data which comes and goes
+// without forget ... a region hands out space from a bump pointer and
+// is released all at once, a pool hands out blocks of one size from a
+// free list.  Both are O(1) and keep usage and high water marks.
+typedef struct {
+  Cell_t rg_size ;		// bytes of space
+  Cell_t rg_used ;
+  Cell_t rg_high ;
+  Cell_t rg_data[] ;
+} Region_t ;
+
+typedef struct {
+  Cell_t pl_size ;		// bytes per block, a multiple of a cell
+  Cell_t pl_count ;		// number of blocks
+  Cell_t pl_fresh ;		// blocks never handed out start here
+  Cell_t pl_used ;
+  Cell_t pl_high ;
+  Cell_t *pl_free ;		// blocks returned by pool-put
+  Cell_t pl_data[] ;
+} Pool_t ;
+
+#define rgn_Cells( n )	(((n) + sizeof( Cell_t ) - 1) / sizeof( Cell_t ))
+
+// take cells for a header and bytes of space from Here ...
+Cell_t *rgn_carve( Cell_t hdr, Cell_t bytes )
+{
+  Cell_t *p, cells ;
+
+  cells = hdr + rgn_Cells( bytes ) ;
+  freespace() ;
+  if( bytes < 0 || pop() < cells * (Cell_t) sizeof( Cell_t ) ){
+    throw( err_NoSpace ) ;
+    return NULL ;
+  }
+  p = Here ;
+  Here += cells ;
+  str_set( (Str_t) p, 0, hdr * sizeof( Cell_t ) ) ;
+  return p ;
 }
 
-void dump()
+void arena_new() // ( bytes -- arena )
 {
-  Cell_t  **p ;
-  Dict_t *dp ;
-
-  if( quiet ) return ;
+  Region_t *r ;
+  Cell_t bytes ;
 
-  fmt_out( "-- Input File: %s Line: %d:\n", InputStack[ in_This ].name, InputStack[ in_This ].in_line ) ;
-  fmt_out( "-- Forth Backtrace:\n" ) ;
-  while( rtos != StartOf( rstack ) )
-  {
-    p = (Cell_t **) rpop() ;
-    if( !isNul( p ) )
-    {
-        dp = (Dict_t *) *p ;
-        if( !isNul( dp ) )
-		  fmt_out( "  -- %x %x (%s)\n", (p), dp, dp->nfa ) ;
+  chk( 1 ) ;
+  bytes = rgn_Cells( *tos ) * sizeof( Cell_t ) ;
+  r = (Region_t *) rgn_carve( rgn_Cells( sizeof( Region_t ) ), bytes ) ;
+  if( !isNul( r ) ){
+    r ->rg_size = bytes ;
+  }
+  *tos = (Cell_t) r ;
+}
 
-        dp = (Dict_t *) *(p-1) ;
-        if( !isNul( dp ) )
-        {
-		  fmt_out( "  -- %x %x (%s)\n", (p-1), dp, dp->nfa ) ;
-        }
-    }
+void arena_alloc() // ( arena n -- addr | 0 )
+{
+  Region_t *r ;
+  Cell_t n ;
+
+  chk( 2 ) ;
+  n = rgn_Cells( pop() ) * sizeof( Cell_t ) ;
+  r = (Region_t *) *tos ;
+  if( n < 0 || n > r ->rg_size - r ->rg_used ){
+    *tos = 0 ;
+    return ;
   }
+  *tos = (Cell_t) ((Str_t) r ->rg_data + r ->rg_used) ;
+  r ->rg_used += n ;
+  r ->rg_high = (r ->rg_used > r ->rg_high) ? r ->rg_used : r ->rg_high ;
 }
 
-void find() // ( strptr -- dp|0 )
+void arena_reset() // ( arena -- )
 {
-  Str_t tkn = (Str_t) pop() ;
-  push( ((Dict_t *) lookup( (Str_t) tkn )) ) ;
+  chk( 1 ) ;
+  ((Region_t *) pop()) ->rg_used = 0 ;
 }
 
-#ifdef HOSTED
-void path()
+void arena_space() // ( arena -- bytes )
 {
-	push( off_path ) ; 
+  Region_t *r ;
+
+  chk( 1 ) ;
+  r = (Region_t *) *tos ;
+  *tos = r ->rg_size - r ->rg_used ;
 }
-#endif
 
-void version()
+void dotarena() // ( arena -- )
 {
-  push( str_literal( MAJOR, Base ) ) ;
-  push( str_literal( MINOR, Base ) ) ;
-  push( str_literal( REVISION, Base ) ) ;
+  Region_t *r ;
 
+  chk( 1 ) ;
+  r = (Region_t *) pop() ;
+  fmt_out( "-- arena: %d used, %d high, %d bytes\n", r ->rg_used, r ->rg_high, r ->rg_size ) ;
 }
 
-void data()
+void pool_new() // ( size count -- pool )
 {
-  push( (Cell_t *) Colon_Defs );
+  Pool_t *pl ;
+  Cell_t size, count ;
+
+  chk( 2 ) ;
+  count = pop() ;
+  size = rgn_Cells( *tos ) * sizeof( Cell_t ) ;
+  size = (size > 0) ? size : sizeof( Cell_t ) ;
+  if( count < 0 ){
+    throw( err_Range ) ;
+    return ;
+  }
+  pl = (Pool_t *) rgn_carve( rgn_Cells( sizeof( Pool_t ) ), size * count ) ;
+  if( !isNul( pl ) ){
+    pl ->pl_size = size ;
+    pl ->pl_count = count ;
+  }
+  *tos = (Cell_t) pl ;
 }
 
-void code()
+void pool_get() // ( pool -- addr | 0 )
 {
-  push( (Cell_t *) Primitives );
+  Pool_t *pl ;
+  Cell_t *p ;
+
+  chk( 1 ) ;
+  pl = (Pool_t *) *tos ;
+  p = pl ->pl_free ;
+  if( !isNul( p ) ){
+    pl ->pl_free = (Cell_t *) *p ;
+  } else if( pl ->pl_fresh < pl ->pl_count ){
+    p = (Cell_t *) ((Str_t) pl ->pl_data + pl ->pl_fresh++ * pl ->pl_size) ;
+  } else {
+    *tos = 0 ;
+    return ;
+  }
+  pl ->pl_used++ ;
+  pl ->pl_high = (pl ->pl_used > pl ->pl_high) ? pl ->pl_used : pl ->pl_high ;
+  *tos = (Cell_t) p ;
 }
 
-void align() // ( adr -- adr' )
+void pool_put() // ( addr pool -- )
 {
-	Cell_t adr = *tos ;
+  Pool_t *pl ;
+  Cell_t *p, off ;
 
-	while( adr % sizeof( Cell_t ) )
-	{
-      adr++;
-	}
-	*tos = adr ;
+  chk( 2 ) ;
+  pl = (Pool_t *) pop() ;
+  p = (Cell_t *) pop() ;
+  off = (Str_t) p - (Str_t) pl ->pl_data ;
+  if( off < 0 || off >= pl ->pl_fresh * pl ->pl_size || off % pl ->pl_size ){
+    throw( err_Range ) ;
+    return ;
+  }
+  *p = (Cell_t) pl ->pl_free ;
+  pl ->pl_free = p ;
+  pl ->pl_used-- ;
 }
 
-void fill() // ( dst n char -- )
+void pool_space() // ( pool -- n )
 {
-  Byt_t ch ;
-  Wrd_t n ;
-  Str_t dst ;
+  Pool_t *pl ;
 
-  chk( 3 ) ; 
-  ch = (Byt_t) pop() ;
-  n = (Wrd_t) pop() ;
-  dst = (Str_t) pop() ;
-  str_set( dst, ch, n ) ;
+  chk( 1 ) ;
+  pl = (Pool_t *) *tos ;
+  *tos = pl ->pl_count - pl ->pl_used ;
+}
+
+void dotpool() // ( pool -- )
+{
+  Pool_t *pl ;
+
+  chk( 1 ) ;
+  pl = (Pool_t *) pop() ;
+  fmt_out( "-- pool: %d used, %d high, %d blocks of %d bytes\n", pl ->pl_used, pl ->pl_high, pl ->pl_count, pl ->pl_size ) ;
 }
 
 // a late addition to OneFileForth is a circular buffer queue designed to
@@ -3959,7 +11900,331 @@ void    *tb_get( Cir_Queue_t *CQ )
   return rv ;
 }
 
+#ifdef TIMERS
+/*
+  -- timers: a heap of deadlines per VM, soonest first, behind one
+  posix timer armed for the soonest.  Its signal only marks the VM
+  (see tm_alarm()), the callbacks run at the next safe point; a taken
+  branch in the inner interpreter or the jit code, a token read by
+  the interpreter, or a wait for input (see io_wait()).  NATIVE builds
+  have the SP804 tick look at the soonest instead, see tick_isr().
+
+	usecs xt after		( -- id )  run xt once, usecs from now
+	usecs xt every		( -- id )  and every usecs after that
+	id cancel		( -- )
+	.timers			( -- )  lateness and overruns so far
+*/
+void tm_swap( Cell_t a, Cell_t b )
+{
+  Cell_t s = tm_Heap[ a ] ;
+
+  tm_Heap[ a ] = tm_Heap[ b ] ;
+  tm_Heap[ b ] = s ;
+  Timers[ tm_Heap[ a ] ].tm_pos = a ;
+  Timers[ tm_Heap[ b ] ].tm_pos = b ;
+}
+
+void tm_up( Cell_t i )
+{
+  while( i > 0 && tm_Key( (i - 1) / 2 ) > tm_Key( i ) ){
+    tm_swap( i, (i - 1) / 2 ) ;
+    i = (i - 1) / 2 ;
+  }
+}
+
+void tm_down( Cell_t i )
+{
+  Cell_t c ;
+
+  for( ;; ){
+    c = 2 * i + 1 ;
+    if( c >= n_Timers ){
+      return ;
+    }
+    if( c + 1 < n_Timers && tm_Key( c + 1 ) < tm_Key( c ) ){
+      c++ ;
+    }
+    if( tm_Key( i ) <= tm_Key( c ) ){
+      return ;
+    }
+    tm_swap( i, c ) ;
+    i = c ;
+  }
+}
+
+void tm_remove( Cell_t s )
+{
+  Cell_t i = Timers[ s ].tm_pos ;
+
+  tm_swap( i, --n_Timers ) ;
+  if( i < n_Timers ){
+    tm_up( i ) ;
+    tm_down( i ) ;
+  }
+  Timers[ s ].tm_id = 0 ;
+}
+
+#ifdef HOSTED
+void tm_alarm( int sig, siginfo_t *info, void *context )
+{
+  VM_t *save = vm ;
+
+  vm = (VM_t *) info ->si_value.sival_ptr ;
+  if( !isNul( vm ) ){
+    tm_Due = 1 ;
+  }
+  vm = save ;
+}
+
+// point the posix timer at the soonest deadline, or disarm it ...
+void tm_arm( void )
+{
+  struct sigaction action ;
+  struct sigevent sev ;
+  struct itimerspec its ;
+
+  if( !tm_Armed ){
+    memset( &action, 0, sizeof( action ) ) ;
+    action.sa_sigaction = tm_alarm ;
+    action.sa_flags = SA_SIGINFO | SA_RESTART ;
+    sigaction( SIGALRM, &action, NULL ) ;
+    memset( &sev, 0, sizeof( sev ) ) ;
+    sev.sigev_notify = SIGEV_SIGNAL ;
+    sev.sigev_signo = SIGALRM ;
+    sev.sigev_value.sival_ptr = vm ;
+    if( timer_create( CLOCK_MONOTONIC, &sev, &tm_Posix ) < 0 ){
+      throw( err_SysCall ) ;
+      return ;
+    }
+    tm_Armed = 1 ;
+  }
+  memset( &its, 0, sizeof( its ) ) ;
+  if( n_Timers > 0 ){
+    its.it_value.tv_sec = tm_Key( 0 ) / 1000000 ;
+    its.it_value.tv_nsec = (tm_Key( 0 ) % 1000000) * 1000 ;
+  }
+  timer_settime( tm_Posix, TIMER_ABSTIME, &its, NULL ) ;
+}
+#else
+void tm_arm( void )
+{
+  tm_Armed = 1 ;
+  tm_Next = (n_Timers > 0) ? tm_Key( 0 ) : 0 ;
+}
+#endif
+
+// the safe point, run whatever is due ...
+void tm_poll( void )
+{
+  Timer_t *t ;
+  Dict_t *xt ;
+  uCell_t now, late, n ;
+
+  tm_Due = 0 ;
+  if( tm_Busy ){		// the callbacks' own loops, see q_reset()
+    return ;
+  }
+  tm_Busy = 1 ;
+  while( n_Timers > 0 && tm_Key( 0 ) <= (now = clk_usecs()) ){
+    t = &Timers[ tm_Heap[ 0 ] ] ;
+    late = now - t ->tm_due ;
+    t ->tm_runs++ ;
+    t ->tm_late += late ;
+    t ->tm_late_max = (late > t ->tm_late_max) ? late : t ->tm_late_max ;
+    xt = t ->tm_xt ;
+    if( t ->tm_period > 0 ){
+      t ->tm_due += t ->tm_period ;
+      if( t ->tm_due <= now ){	// missed some, keep to the period
+        n = (now - t ->tm_due) / t ->tm_period + 1 ;
+        t ->tm_overruns += n ;
+        t ->tm_due += n * t ->tm_period ;
+      }
+      tm_down( 0 ) ;
+    } else {
+      tm_remove( tm_Heap[ 0 ] ) ;
+    }
+    push( (Cell_t) xt ) ;
+    execute() ;
+    if( error_code != err_OK ){
+      break ;
+    }
+  }
+  tm_Busy = 0 ;
+  tm_arm() ;
+}
+
+#ifdef HOSTED
+// wait as io_wait() does, running the timers as they come due ...
+Wrd_t tm_wait( Wrd_t fd, Cell_t usecs )
+{
+  fd_set fds ;
+  struct timespec ts ;
+  uCell_t now, until, next ;
+  Wrd_t rv ;
+
+  until = (usecs < 0) ? 0 : clk_usecs() + usecs ;
+  for( ;; ){
+    if( n_Timers > 0 && tm_Key( 0 ) <= clk_usecs() ){
+      tm_poll() ;
+    }
+    now = clk_usecs() ;
+    if( until != 0 && until <= now ){
+      return 0 ;
+    }
+    next = (until != 0) ? until : (uCell_t) -1 ;
+    if( n_Timers > 0 && tm_Key( 0 ) < next ){
+      next = tm_Key( 0 ) ;
+    }
+    ts.tv_sec = (next - now) / 1000000 ;
+    ts.tv_nsec = ((next - now) % 1000000) * 1000 ;
+    FD_ZERO( &fds ) ;
+    FD_SET( fd, &fds ) ;
+    rv = pselect( fd + 1, &fds, NULL, NULL, (next == (uCell_t) -1) ? NULL : &ts, NULL ) ;
+    if( rv > 0 ){
+      return 1 ;
+    }
+    if( rv < 0 && errno != EINTR ){
+      throw( err_SysCall ) ;
+      return 0 ;
+    }
+  }
+}
+#endif
+
+Cell_t tm_add( Cell_t usecs, Cell_t period, Dict_t *xt )
+{
+  Timer_t *t ;
+  Cell_t s ;
+
+  for( s = 0 ; s < sz_TIMERS && Timers[ s ].tm_id != 0 ; s++ ) ;
+  if( s == sz_TIMERS ){
+    throw( err_NoSpace ) ;
+    return 0 ;
+  }
+  t = &Timers[ s ] ;
+  str_set( (Str_t) t, 0, sizeof( Timer_t ) ) ;
+  t ->tm_due = clk_usecs() + ((usecs > 0) ? usecs : 0) ;
+  t ->tm_period = period ;
+  t ->tm_xt = xt ;
+  t ->tm_id = s + 1 + sz_TIMERS * ++tm_Serial ;	// stale ids cancel nothing
+  tm_Heap[ n_Timers ] = s ;
+  t ->tm_pos = n_Timers ;
+  tm_up( n_Timers++ ) ;
+  tm_arm() ;
+  return t ->tm_id ;
+}
+
+void tm_cancel( Cell_t id )
+{
+  Cell_t s = (id - 1) % sz_TIMERS ;
+
+  if( id > 0 && Timers[ s ].tm_id == id ){
+    tm_remove( s ) ;
+    tm_arm() ;
+  }
+}
+
+// drop every timer, their xts are going (see forget()) ...
+void tm_reset( void )
+{
+  Cell_t s ;
+
+  for( s = 0 ; s < sz_TIMERS ; s++ ){
+    Timers[ s ].tm_id = 0 ;
+  }
+  n_Timers = 0 ;
+  it_Id = 0 ;
+  if( tm_Armed ){
+    tm_arm() ;
+  }
+}
+
+void after() // ( usecs xt -- id )
+{
+  Dict_t *xt ;
+
+  chk( 2 ) ;
+  xt = (Dict_t *) pop() ;
+  *tos = tm_add( *tos, 0, xt ) ;
+}
+
+void every() // ( usecs xt -- id )
+{
+  Dict_t *xt ;
+
+  chk( 2 ) ;
+  xt = (Dict_t *) pop() ;
+  if( *tos < 1 ){
+    throw( err_Range ) ;
+    return ;
+  }
+  *tos = tm_add( *tos, *tos, xt ) ;
+}
+
+void cancel() // ( id -- )
+{
+  chk( 1 ) ;
+  tm_cancel( pop() ) ;
+}
+
+void dottimers() // ( -- )
+{
+  Timer_t *t ;
+  Cell_t s ;
+
+  fmt_out( "-- id\tperiod\truns\tlate\tworst\toverruns\tword\n" ) ;
+  for( s = 0 ; s < sz_TIMERS ; s++ ){
+    t = &Timers[ s ] ;
+    if( t ->tm_id == 0 ){
+      continue ;
+    }
+    fmt_out( "%d\t%u\t%u\t%u\t%u\t%u\t%s\n", t ->tm_id, t ->tm_period, t ->tm_runs,
+      (t ->tm_runs > 0) ? t ->tm_late / t ->tm_runs : 0, t ->tm_late_max, t ->tm_overruns,
+      isNul( t ->tm_xt ) ? "?" : t ->tm_xt ->nfa ) ;
+  }
+}
+
+#endif
+
 #ifdef HOSTED
+#ifdef TIMERS
+// it_set is a periodic timer on the queue now, one per VM ...
+void	it_doit( int signal ) // ( -- ) 
+{
+  Cell_t s = (it_Id - 1) % sz_TIMERS ;
+
+  if( it_Id > 0 && Timers[ s ].tm_id == it_Id )
+  {
+    push( (Cell_t) Timers[ s ].tm_xt ) ;
+    execute() ;
+  }
+}
+
+void	it_reset()	// ( -- ) 
+{
+  push( 0 ) ; 
+  push( 0 ) ; 
+  push( 0 ) ; 
+  it_set() ;
+}
+
+void	it_set()	// ( secs usecs pfa -- )
+{
+  Dict_t *xt ;
+  Cell_t usecs ;
+
+  chk( 3 ) ;
+  xt = (Dict_t *) pop() ;
+  usecs = pop() ;
+  usecs += pop() * 1000000 ;
+  tm_cancel( it_Id ) ;
+  it_Id = 0 ;
+  if( usecs > 0 && !isNul( xt ) )
+  {
+    it_Id = tm_add( usecs, usecs, xt ) ;
+  }
+}
+#else
 Fptr_t it_handler = NULL ;
 void	it_doit( int signal ) // ( -- ) 
 {
@@ -4007,3 +12272,134 @@ void	it_set()	// ( secs usecs pfa -- )
 
 }
 #endif
+#endif
+
+#if defined( IN_MMAP ) || defined( AOT )
+// called once the input stack exists, so that on-load can fix up
+// whatever the image could not (pointers to other C globals) ...
+void img_hook( void )
+{
+  Dict_t *dp ;
+
+  dp = lookup( "on-load" ) ;
+  if( !isNul( dp ) )
+  {
+    push( (Cell_t) dp ) ;
+    execute() ;
+  }
+}
+#endif
+
+#ifdef AOT
+#ifdef NOCHECK
+#define aot_Chk( x )	{}
+#else
+#define aot_Chk( x )	do { if( tos - StartOf( stack ) < (x) ){ throw( err_StackUdr ) ; catch() ; } } while( 0 )
+#endif
+#ifdef HOSTED
+#define aot_N( x )	(Natives[ x ].value)
+#else
+#define aot_N( x )	0
+#endif
+#define aot_Null( x )	do { if( isNul( (Cell_t *) (x) ) ){ throw( err_NullPtr ) ; catch() ; } } while( 0 )
+
+// a cell of an ahead of time compiled word, run as vm_Call would with
+// r after it in the thread, if it moved ip the rest is run threaded
+Wrd_t aot_run( Dict_t *dp, Cell_t *r )
+{
+  Cell_t *ip ;
+
+  rpush( (Cell_t) r ) ;
+  if( !isNul( dp ->pfa ) ){
+    rpush( (Cell_t) dp ->pfa ) ;
+  }
+  (*dp ->cfa)() ;
+  if( error_code ){
+    catch() ;
+  }
+  ip = (Cell_t *) rpop() ;
+  if( ip == r ){
+    return 0 ;
+  }
+  if( !isNul( ip ) ){
+    rpush( (Cell_t) ip ) ;
+    doColon() ;
+  }
+  return 1 ;
+}
+
+#include AOT
+
+// install what compile-c saw, as img_load() does, finding the
+// primitives it used by name so it can be built for another target
+// of the same cell size ...
+void aot_load( void )
+{
+  Byt_t *strings ;
+  Cell_t i, v ;
+
+  strings = (Byt_t *) &flash[ sz_FLASH ] - aot_StrLen ;
+  if( aot_Cell != sizeof( Cell_t ) || aot_Words > sz_ColonDefs || strings < (Byt_t *) &flash[ aot_Here ] ){
+    fmt_out( "-- %s\n", errors[ err_BadImage ] ) ;
+    return ;
+  }
+  for( i = 0 ; i < aot_Prims ; i++ ){
+    aot_P[ i ] = isNul( aot_Names[ i ] ) ? NULL : lookup( aot_Names[ i ] ) ;
+    if( !isNul( aot_Names[ i ] ) && isNul( aot_P[ i ] ) ){
+      fmt_out( "-- Unresolved primitive: %s\n", aot_Names[ i ] ) ;
+      return ;
+    }
+  }
+
+  aot_Delta = (strings - (Byt_t *) flash) - aot_Strings ;
+  String_Data = strings ;
+  str_copy( (Str_t) String_Data, (Str_t) aot_Str, aot_StrLen ) ;
+#ifdef HOSTED
+  for( n_Natives = i = 0 ; i < aot_Natives ; i++ ){
+    native_resolve( aot_Libs[ i ][ 0 ], (aot_Libs[ i ][ 1 ] < 0) ? NULL : (Str_t) aot_F( aot_Libs[ i ][ 1 ] ) ) ;
+  }
+#endif
+
+  for( i = 0 ; i < aot_Here ; i++ ){
+    v = aot_Cells[ i ] ;
+    switch( aot_Tags[ i ] ){
+      case img_Prim:
+        v = (Cell_t) aot_P[ v ] ;
+        break ;
+      case img_Colon:
+        v = (Cell_t) &Colon_Defs[ v ] ;
+        break ;
+      case img_Flash:
+        v = (Cell_t) aot_F( v ) ;
+        break ;
+      case img_Code:
+        v = (Cell_t) aot_P[ v ] ->cfa ;
+        break ;
+      case img_Native:
+        v = aot_N( v ) ;
+        break ;
+    }
+    flash[ i ] = v ;
+  }
+
+  for( i = 0 ; i < aot_Words ; i++ ){
+    Colon_Defs[ i ].cfa = aot_P[ aot_Defs[ i ][ 0 ] ] ->cfa ;
+    Colon_Defs[ i ].nfa = (aot_Defs[ i ][ 1 ] < 0) ? NULL : (Str_t) aot_F( aot_Defs[ i ][ 1 ] ) ;
+    Colon_Defs[ i ].flg = (Flag_t) aot_Defs[ i ][ 2 ] ;
+    Colon_Defs[ i ].pfa = (aot_Defs[ i ][ 3 ] < 0) ? NULL : aot_F( aot_Defs[ i ][ 3 ] ) ;
+    Colon_Defs[ i ].lnk = (Dict_t *) NULL ;
+    Colon_Defs[ i ].op = isNul( aot_Code[ i ] ) ? op_Call : op_Jit ;
+    Colon_Defs[ i ].jit = aot_Code[ i ] ;
+    Colon_Defs[ i ].eff_in = 0 ;
+  }
+
+  Here = flash + aot_Here ;
+  DictPtr = flash + aot_DictPtr ;
+  n_ColonDefs = aot_Words ;
+  Base = aot_Base ;
+  dict_rehash() ;
+  peep_barrier() ;
+}
+#endif
+
+#endif // OFF_API